@@ -0,0 +1,76 @@
+#include <Rcpp.h>
+#include "aa_probe.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+//' @name Allocations_HBV
+//'
+//' @title Output buffer allocation counters
+//'
+//' @description Report the buffers allocated by the model stages (\code{\link{SnowGlacier_HBV}},
+//' \code{\link{Soil_HBV}}, \code{\link{Routing_HBV}}, \code{\link{Glacier_Disch}} and
+//' \code{\link{Pipeline_HBV}}) since the last reset: output matrices, aggregation accumulators
+//' and period index and the chunk buffers of the profiled and pipelined runs. Runs that write
+//' into a preallocated matrix (\code{into} argument) allocate none of them, so the counters tell
+//' whether a calibration loop allocates output series. Only those buffers, whose size grows with
+//' the length of the series, are counted: this is not a heap allocation counter. Small
+//' bookkeeping allocations (the parsed \code{columns}, the column map, the unit hydrograph
+//' weights) and the R objects of the call itself are not included.
+//'
+//' @usage Allocations_HBV(
+//'        reset = FALSE
+//' )
+//'
+//' @param reset logical. When \code{TRUE} the counters are set to zero (after reading them).
+//'
+//' @return Numeric vector with the following values:
+//' \itemize{
+//'   \item \code{buffers}: number of buffers allocated.
+//'   \item \code{bytes}: total size of those buffers.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] )
+//' param   <- c(1.20, 1.00, 0.00, 2.5, 200, 0.8, 1.15, 0.9, 0.01, 0.001, 0.5, 0.01, 1.5)
+//'
+//' ## one output buffer for the whole loop
+//' out <- matrix(0, nrow = nrow(forcing), ncol = 5)
+//'
+//' Allocations_HBV(reset = TRUE)
+//' for(fc in c(150, 200, 250)){
+//'   param[5] <- fc
+//'   Pipeline_HBV(routing = 1, inputData = forcing,
+//'                initCond = c(20, 100, 0, 0, 0), param = param, into = out)
+//' }
+//' Allocations_HBV()
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericVector Allocations_HBV(bool reset = false){
+  AllocCounter &c = alloc_counter();
+
+  NumericVector out = NumericVector::create(
+    Named("buffers") = (double) c.buffers.load(),
+    Named("bytes")   = (double) c.bytes.load() );
+
+  if (reset) {
+    c.buffers = 0;
+    c.bytes   = 0;
+  }
+  return out;
+}
@@ -0,0 +1,191 @@
+#include <Rcpp.h>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "aa_arrow.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// EXPORTACIÓN ARROW
+// Exporta las columnas de una salida (matriz o lista/data.frame) como un
+// struct array de la interfaz C de Arrow. Las columnas apuntan a la memoria
+// del objeto de R (sin copia); el objeto queda protegido hasta que el
+// consumidor llama a release.
+*/
+
+// R_ReleaseObject() sólo puede llamarse desde el hilo de R: los release que
+// llegan desde otro hilo dejan el objeto en esta cola, que se vacía en la
+// próxima llamada a Arrow_HBV()
+static std::mutex release_mtx;
+static std::vector<SEXP> release_queue;
+static std::thread::id r_thread;
+
+static void release_results(void *x){
+  std::unique_lock<std::mutex> lock(release_mtx);
+  if (std::this_thread::get_id() != r_thread) {
+    release_queue.push_back( (SEXP) x );
+    return;
+  }
+  lock.unlock();
+  R_ReleaseObject( (SEXP) x );
+}
+
+// libera (en el hilo de R) los objetos encolados
+static void release_pending(){
+  std::vector<SEXP> pending;
+  {
+    std::lock_guard<std::mutex> lock(release_mtx);
+    r_thread = std::this_thread::get_id();
+    pending.swap(release_queue);
+  }
+  for (size_t k = 0; k < pending.size(); ++k) {
+    R_ReleaseObject(pending[k]);
+  }
+}
+
+// dirección de una estructura Arrow: puntero externo, numérico o texto
+static void* arrow_address(SEXP x, const char *what){
+  void *out = 0;
+  if (TYPEOF(x) == EXTPTRSXP) {
+    out = R_ExternalPtrAddr(x);
+  } else if (TYPEOF(x) == REALSXP && Rf_xlength(x) == 1) {
+    out = (void*) (uintptr_t) REAL(x)[0];
+  } else if (TYPEOF(x) == STRSXP && Rf_xlength(x) == 1) {
+    out = (void*) (uintptr_t) std::strtoull(CHAR(STRING_ELT(x, 0)), 0, 10);
+  }
+  if (out == 0) {
+    stop(std::string(what) + " must be the address of an allocated Arrow C structure");
+  }
+  return out;
+}
+
+//' @name Arrow_HBV
+//'
+//' @title Export results through the Arrow C data interface
+//'
+//' @description Exports the columns of a model output (e.g.: the matrix returned by
+//' \code{\link{SnowGlacier_HBV}} or a \code{data.frame} with ensemble or \code{\link{Calibrate_HBV}}
+//' results) as an Arrow struct array. The exported buffers point to the memory of
+//' \code{results}, so another in-process consumer (e.g.: the \code{arrow} or
+//' \code{nanoarrow} packages) reads them without any copy.
+//'
+//' @usage Arrow_HBV(
+//'        results,
+//'        array,
+//'        schema
+//' )
+//'
+//' @param results numeric (or integer) matrix, or a list/\code{data.frame} of numeric (or
+//' integer) vectors of the same length. Column names are used as field names.
+//'
+//' @param array address of an allocated \code{struct ArrowArray} (external pointer, numeric
+//' or string).
+//'
+//' @param schema address of an allocated \code{struct ArrowSchema} (external pointer, numeric
+//' or string).
+//'
+//' @return \code{NULL} (invisible). \code{results} is protected from the garbage collector until
+//' the consumer releases the array. The release can come from any thread: when it does not come
+//' from the R thread, \code{results} is only unprotected on the next call to \code{Arrow_HBV},
+//' since the R API can not be used from other threads. Missing values are exported as \code{NaN}
+//' (doubles) or \code{INT32_MIN} (integers) without a validity bitmap.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' \dontrun{
+//' library(arrow)
+//'
+//' data("lumped_hbv")
+//'
+//' snow <- SnowGlacier_HBV(model = 1,
+//'                         inputData = as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)')] ),
+//'                         initCond = c(20, 2), param = c(1.20, 1.00, 0.00, 2.5))
+//' colnames(snow) <- c("Prain", "Psnow", "SWE", "Msnow", "Total")
+//'
+//' array  <- allocate_arrow_array()
+//' schema <- allocate_arrow_schema()
+//' Arrow_HBV(results = snow, array = array, schema = schema)
+//'
+//' batch <- RecordBatch$import_from_c(array, schema)
+//' }
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+void Arrow_HBV(SEXP results,
+               SEXP array,
+               SEXP schema){
+  release_pending();
+
+  // *********************
+  //  conditionals
+  // *********************
+  struct ArrowArray  *out_array  = (struct ArrowArray*)  arrow_address(array, "array");
+  struct ArrowSchema *out_schema = (struct ArrowSchema*) arrow_address(schema, "schema");
+
+  std::vector<ArrowColumn> columns;
+  int64_t length = 0;
+
+  if (Rf_isMatrix(results) && (TYPEOF(results) == REALSXP || TYPEOF(results) == INTSXP)) {
+    bool int32 = (TYPEOF(results) == INTSXP);
+    int nr = Rf_nrows(results), nc = Rf_ncols(results);
+    SEXP dn = Rf_getAttrib(results, R_DimNamesSymbol);
+    SEXP cn = Rf_isNull(dn) ? R_NilValue : VECTOR_ELT(dn, 1);
+
+    for (int j = 0; j < nc; ++j) {
+      ArrowColumn col;
+      col.name  = Rf_isNull(cn) ? "V" + std::to_string(j + 1) : CHAR(STRING_ELT(cn, j));
+      col.int32 = int32;
+      col.data  = int32 ? (const void*) (INTEGER(results) + (R_xlen_t) j * nr) :
+                          (const void*) (REAL(results) + (R_xlen_t) j * nr);
+      columns.push_back(col);
+    }
+    length = nr;
+
+  } else if (TYPEOF(results) == VECSXP) {
+    SEXP nm = Rf_getAttrib(results, R_NamesSymbol);
+
+    for (R_xlen_t j = 0; j < Rf_xlength(results); ++j) {
+      SEXP x = VECTOR_ELT(results, j);
+      if (TYPEOF(x) != REALSXP && TYPEOF(x) != INTSXP) {
+        stop("results columns must be numeric or integer vectors");
+      }
+      if (j == 0) {
+        length = Rf_xlength(x);
+      } else if (Rf_xlength(x) != length) {
+        stop("results columns must have the same length");
+      }
+
+      ArrowColumn col;
+      col.name  = Rf_isNull(nm) ? "V" + std::to_string(j + 1) : CHAR(STRING_ELT(nm, j));
+      col.int32 = (TYPEOF(x) == INTSXP);
+      col.data  = col.int32 ? (const void*) INTEGER(x) : (const void*) REAL(x);
+      columns.push_back(col);
+    }
+
+  } else {
+    stop("results must be a numeric matrix or a list of numeric vectors");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  R_PreserveObject(results);
+  std::shared_ptr<void> owner( (void*) results, release_results );
+
+  arrow_export(columns, length, owner, out_array, out_schema);
+
+}
@@ -0,0 +1,570 @@
+#include <Rcpp.h>
+#include <cstdio>
+#include <chrono>
+#include "aa_bands.h"
+#include "aa_ensemble.h"
+#include "aa_handle.h"
+#include "aa_cache.h"
+#include "aa_archive.h"
+#include "aa_stage.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// FORZANTES POR BANDA DE ELEVACIÓN
+// Aplica Temp_model y Precip_model a todas las bandas una sola vez y guarda
+// las series (contiguas por banda) en un cache en memoria y, si se da un
+// directorio, en disco. La clave son los modelos, los gradientes, las alturas
+// de las bandas y una huella de las series de la estación.
+
+// DATOS DE ENTRADA - inputData
+// #1# airT  : serie de temperatura [°C/deltaT]
+// #2# precip: serie de precipitación [mm/deltaT]
+
+// ALTURAS - zmeteo, ztopo
+// zmeteo: sensor de temperatura y pluviómetro [msnm]
+// ztopo : altura media de cada banda [msnm]
+*/
+
+typedef std::shared_ptr<const BandForcing> BandHandle;
+
+// parámetros por modelo (ver Temp_model y Precip_model)
+static std::vector<double> band_param(int model, NumericVector param, const char *what){
+  if (model != 1 && model != 2) {
+    stop(std::string(what) + ": Model not available");
+  }
+  if (param.size() < model) {
+    stop(std::string(what) + ": Please verify the parameter vector");
+  }
+  return std::vector<double>(param.begin(), param.begin() + model);
+}
+
+// series de las bandas guardadas en 'file' con la clave 'key'; false si el
+// archivo no existe, está dañado o es de otra clave
+static bool load_bands(const std::string &file,
+                       const std::string &key,
+                       int n,
+                       int nband,
+                       BandForcing &out){
+  FILE *probe = std::fopen(file.c_str(), "rb");
+  if (probe == 0) return false;
+  std::fclose(probe);
+
+  try {
+    ArchiveReader reader(file);
+    const ArchiveHeader &hdr = reader.header();
+    if (hdr.tag != key || hdr.ntime != (uint64_t) n || hdr.nmember != (uint64_t) nband ||
+        reader.variable("airT") != 0 || reader.variable("precip") != 1) {
+      return false;
+    }
+
+    std::vector<uint64_t> rows(n), cols(nband);
+    for (int i = 0; i < n; ++i) rows[i] = i;
+    for (int b = 0; b < nband; ++b) cols[b] = b;
+
+    out.n     = n;
+    out.nband = nband;
+    out.airT.resize( (size_t) n * nband );
+    out.precip.resize( (size_t) n * nband );
+    reader.read(0, rows, cols, out.airT.data());
+    reader.read(1, rows, cols, out.precip.data());
+  } catch (std::exception &) {
+    return false;
+  }
+  return true;
+}
+
+// escribe un archivo temporal y lo renombra, así una escritura cortada nunca
+// deja un archivo a medias con el nombre final
+static void save_bands(const std::string &file,
+                       const std::string &key,
+                       const BandForcing &bands){
+  ArchiveHeader hdr;
+  hdr.names.push_back("airT");
+  hdr.names.push_back("precip");
+  hdr.ntime        = bands.n;
+  hdr.nmember      = bands.nband;
+  hdr.chunk_time   = bands.n;
+  hdr.chunk_member = 1;
+  hdr.compress     = 1;
+  hdr.tag          = key;
+
+  std::string tmp = file + ".tmp" +
+    std::to_string( (unsigned long long) std::chrono::steady_clock::now().time_since_epoch().count() );
+
+  try {
+    ArchiveWriter writer(tmp, hdr);
+    std::vector<const double*> data(2);
+    for (int b = 0; b < bands.nband; ++b) {
+      data[0] = bands.temp(b);
+      data[1] = bands.prec(b);
+      writer.write_members(b, 1, data, bands.n);
+    }
+    writer.close();
+  } catch (...) {
+    std::remove(tmp.c_str());
+    throw;
+  }
+
+  // en Windows rename() no reemplaza un archivo existente
+  if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+    std::remove(file.c_str());
+    if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+      std::remove(tmp.c_str());
+      throw std::runtime_error("cannot write " + file);
+    }
+  }
+}
+
+//' @name Bands_HBV
+//'
+//' @title Elevation band forcing
+//'
+//' @description Applies \code{\link{Temp_model}} and \code{\link{Precip_model}} to every
+//' elevation band at once and keeps the band series (contiguous per band) in memory, keyed
+//' by the models, their gradients, the band elevations and a fingerprint of the station
+//' series. When the lapse rates are not calibrated the bands are built once and every
+//' \code{\link{SnowBands_HBV}} run reads them directly. See \code{\link{Cache_HBV}}.
+//'
+//' @usage Bands_HBV(
+//'        inputData,
+//'        zmeteo,
+//'        ztopo,
+//'        tmodel,
+//'        tparam,
+//'        pmodel,
+//'        pparam,
+//'        dir = ""
+//' )
+//'
+//' @param inputData numeric matrix with the following columns:
+//' \itemize{
+//' \item \code{column_1}: air temperature series at the station \eqn{[°C/\Delta t]}.
+//' \item \code{column_2}: precipitation series at the gauge \eqn{[mm/\Delta t]}.
+//' }
+//'
+//' @param zmeteo numeric vector with the altitude of the temperature sensor and of the
+//' precipitation gauge \eqn{[masl]}. A single value is used for both.
+//'
+//' @param ztopo numeric vector with the elevation of each band \eqn{[masl]}.
+//'
+//' @param tmodel numeric integer with the \code{\link{Temp_model}} option.
+//'
+//' @param tparam numeric vector with the \code{\link{Temp_model}} parameters.
+//'
+//' @param pmodel numeric integer with the \code{\link{Precip_model}} option.
+//'
+//' @param pparam numeric vector with the \code{\link{Precip_model}} parameters.
+//'
+//' @param dir string with a directory where the bands are also cached on disk (see
+//' \code{\link{Write_HBV}}), so they survive the R session. Every file stores its full key and
+//' is only used when the key matches; a missing, damaged or foreign file is recomputed (and
+//' replaced). Files are written under a temporary name and renamed, so an interrupted write
+//' never leaves a partial cache file. An empty string (default) keeps them in memory only.
+//'
+//' @return External pointer of class \code{HBV_bands} with the \code{size} (time steps,
+//' bands) attribute.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' station <- cbind(runif(730, max = 25, min = -10),
+//'                  rbinom(730, 1, 0.3) * rexp(730, rate = 0.1))
+//'
+//' bands <- Bands_HBV(inputData = station, zmeteo = 2000,
+//'                    ztopo = seq(2500, 5000, 250),
+//'                    tmodel = 1, tparam = -6.5,
+//'                    pmodel = 1, pparam = 0.05)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Bands_HBV(NumericMatrix inputData,
+               NumericVector zmeteo,
+               NumericVector ztopo,
+               int tmodel,
+               NumericVector tparam,
+               int pmodel,
+               NumericVector pparam,
+               std::string dir = ""){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // elevations
+  int chk_2 = sum( is_na(zmeteo) ) + sum( is_na(ztopo) );
+  if(chk_2 != 0){
+
+    stop("zmeteo and ztopo arguments should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(tparam) ) + sum( is_na(pparam) );
+  if(chk_3 != 0){
+
+    stop("tparam and pparam arguments should not contain NA values!");
+
+  }
+
+  if (inputData.ncol() < 2) {
+    stop("Please verify the input matrix");
+  }
+  if (zmeteo.size() < 1 || ztopo.size() < 1) {
+    stop("Please verify the zmeteo and ztopo vectors");
+  }
+
+  BandModel m;
+  m.tmodel    = tmodel;
+  m.pmodel    = pmodel;
+  m.tparam    = band_param(tmodel, tparam, "Temp_model");
+  m.pparam    = band_param(pmodel, pparam, "Precip_model");
+  m.zmeteo[0] = zmeteo[0];
+  m.zmeteo[1] = (zmeteo.size() > 1) ? zmeteo[1] : zmeteo[0];
+
+  // *********************
+  //  function
+  // *********************
+  int n     = inputData.nrow();
+  int nband = ztopo.size();
+  const double *airT   = inputData.begin();
+  const double *precip = inputData.begin() + n;
+
+  std::string key = band_key(m, airT, precip, n, ztopo.begin(), nband);
+  BandHandle bands = band_cache().find(key);
+
+  if (!bands) {
+    std::shared_ptr<BandForcing> fresh = std::make_shared<BandForcing>();
+
+    std::string file;
+    if (!dir.empty()) {
+      char name[32];
+      std::snprintf(name, sizeof(name), "bands_%016llx.hbv", (unsigned long long) key_hash(key));
+      file = dir + "/" + name;
+    }
+
+    // un archivo ilegible o de otra clave es un fallo del cache
+    bool loaded = !file.empty() && load_bands(file, key, n, nband, *fresh);
+
+    if (!loaded) {
+      band_forcing(m, airT, precip, n, ztopo.begin(), nband, *fresh);
+
+      if (!file.empty()) {
+        save_bands(file, key, *fresh);
+      }
+    }
+
+    bands = fresh;
+    band_cache().insert(key, bands);
+  }
+
+  XPtr<BandHandle> out(new BandHandle(bands), true);
+  out.attr("class") = "HBV_bands";
+  out.attr("size")  = IntegerVector::create(n, nband);
+
+  return out;
+
+}
+
+//' @name SnowBands_HBV
+//'
+//' @title Snow routine over elevation bands
+//'
+//' @description Runs \code{\link{SnowGlacier_HBV}} model 1 over soil (temperature index) in
+//' every band of a \code{\link{Bands_HBV}} handle, reading the band series in place.
+//'
+//' @usage SnowBands_HBV(
+//'        bands,
+//'        initCond,
+//'        param,
+//'        profile = FALSE
+//' )
+//'
+//' @param bands handle from \code{\link{Bands_HBV}}.
+//'
+//' @param initCond numeric vector with the initial snow water equivalent of each band
+//' \eqn{[mm]}. A single value is used for all of them.
+//'
+//' @param param numeric vector with \code{SFCF}, \code{Tr}, \code{Tt} and \code{fm} (see
+//' \code{\link{SnowGlacier_HBV}}).
+//'
+//' @param profile logical. When \code{TRUE} every band also records its wall time and the
+//' number of time steps with (\code{melt}) and without (\code{nomelt}) snowmelt.
+//'
+//' @return List with the \code{Total} (rainfall plus snowmelt) and \code{SWE} matrices (time
+//' steps x bands). With \code{profile = TRUE} the list carries a \code{"profile"} attribute:
+//' a data frame with one row per band and the columns \code{band}, \code{seconds},
+//' \code{steps}, \code{melt}, \code{nomelt}, \code{overflow}, \code{uzl} and \code{perc}
+//' (the last three are always zero here, see \code{\link{Pipeline_HBV}}).
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' station <- cbind(runif(730, max = 25, min = -10),
+//'                  rbinom(730, 1, 0.3) * rexp(730, rate = 0.1))
+//'
+//' bands <- Bands_HBV(inputData = station, zmeteo = 2000,
+//'                    ztopo = seq(2500, 5000, 250),
+//'                    tmodel = 1, tparam = -6.5,
+//'                    pmodel = 1, pparam = 0.05)
+//'
+//' snow <- SnowBands_HBV(bands = bands, initCond = 0, param = c(1.1, 0, 0, 2.5))
+//'
+//' ## time and melt events of every band
+//' prof <- attr(SnowBands_HBV(bands = bands, initCond = 0, param = c(1.1, 0, 0, 2.5),
+//'                            profile = TRUE), "profile")
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+List SnowBands_HBV(SEXP bands,
+                   NumericVector initCond,
+                   NumericVector param,
+                   bool profile = false){
+  // *********************
+  //  conditionals
+  // *********************
+  if ( !Rf_inherits(bands, "HBV_bands") ) {
+    stop("bands must be a Bands_HBV handle");
+  }
+  XPtr<BandHandle> handle(bands);
+  if (handle.get() == 0) {
+    stop("invalid bands handle (was the session restored?)");
+  }
+  const BandForcing &f = **handle;
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if (initCond.size() != 1 && initCond.size() != f.nband) {
+    stop("Please verify the initCond argument");
+  }
+  if (param.size() < 4){
+    stop("Please verify the parameter vector");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  std::vector<double> SWE0(f.nband, initCond[0]);
+  if (initCond.size() == f.nband) {
+    SWE0.assign(initCond.begin(), initCond.end());
+  }
+
+  NumericMatrix total(f.n, f.nband), swe(f.n, f.nband);
+  if (!profile) {
+    snow_bands(f, SWE0.data(), param.begin(), total.begin(), swe.begin());
+
+    return List::create(Named("Total") = total,
+                        Named("SWE")   = swe);
+  }
+
+  // un registro por banda
+  std::vector<StageProfile> prof;
+  for (int b = 0; b < f.nband; ++b) {
+    prof.push_back( StageProfile( std::to_string(b + 1) ) );
+  }
+  snow_bands(f, SWE0.data(), param.begin(), total.begin(), swe.begin(), prof.data());
+
+  List out = List::create(Named("Total") = total,
+                          Named("SWE")   = swe);
+  out.attr("profile") = profile_frame(prof, "band");
+  return out;
+
+}
+
+//' @name Ensemble_HBV
+//'
+//' @title Snow and glacier ensembles over elevation bands
+//'
+//' @description Runs \code{\link{SnowGlacier_HBV}} model 1 in every band of a
+//' \code{\link{Bands_HBV}} handle for every parameter set (member) and returns the area
+//' weighted \code{Total} of the basin. Each band and member pair is one task on the shared pool
+//' (see \code{\link{Threads_HBV}}). Tasks are weighted by their surface type (glacier bands
+//' cost about twice as much as soil bands), dealt most expensive first to the least loaded
+//' worker and idle workers steal the cheapest pending tasks, so the load stays balanced. The
+//' bands of a member are added in band order, so the result does not depend on the schedule.
+//'
+//' @usage Ensemble_HBV(
+//'        bands,
+//'        surface,
+//'        area,
+//'        initCond,
+//'        param,
+//'        async = FALSE
+//' )
+//'
+//' @param bands handle from \code{\link{Bands_HBV}}.
+//'
+//' @param surface numeric integer vector with the surface of each band: \code{1} (clean ice),
+//' \code{2} (soil) or \code{3} (debris-covered ice).
+//'
+//' @param area numeric vector with the relative area of each band.
+//'
+//' @param initCond numeric vector with the initial snow water equivalent of each band
+//' \eqn{[mm]}. A single value is used for all of them.
+//'
+//' @param param numeric matrix with one row per member and the following columns:
+//' \code{SFCF}, \code{Tr}, \code{Tt}, \code{fm}, \code{fi} and \code{fic} (see
+//' \code{\link{SnowGlacier_HBV}}). The ice melt factors are compulsory but only used by the
+//' glacier bands.
+//'
+//' @param async logical. When \code{TRUE} the ensemble runs in the background and a job handle
+//' is returned at once (see \code{\link{JobStatus_HBV}}, \code{\link{JobCancel_HBV}} and
+//' \code{\link{JobCollect_HBV}}). After a cancellation the members that did not finish are
+//' \code{NA}. The job runs on the pool of background jobs (see \code{\link{Threads_HBV}}).
+//'
+//' @return Numeric matrix (time steps x members) with the area weighted sum of rainfall, snow
+//' melt and ice melt (or, with \code{async = TRUE}, a job handle that returns it).
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' station <- cbind(runif(730, max = 25, min = -10),
+//'                  rbinom(730, 1, 0.3) * rexp(730, rate = 0.1))
+//'
+//' bands <- Bands_HBV(inputData = station, zmeteo = 2000,
+//'                    ztopo = seq(2500, 5000, 250),
+//'                    tmodel = 1, tparam = -6.5,
+//'                    pmodel = 1, pparam = 0.05)
+//'
+//' members <- cbind(runif(50, 1, 1.3), 0, 0, runif(50, 1, 5), runif(50, 4, 8), 1)
+//'
+//' ens <- Ensemble_HBV(bands = bands, surface = c(rep(2, 6), rep(1, 5)),
+//'                     area = rep(1 / 11, 11), initCond = 0, param = members)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Ensemble_HBV(SEXP bands,
+                  IntegerVector surface,
+                  NumericVector area,
+                  NumericVector initCond,
+                  NumericMatrix param,
+                  bool async = false){
+  // *********************
+  //  conditionals
+  // *********************
+  if ( !Rf_inherits(bands, "HBV_bands") ) {
+    stop("bands must be a Bands_HBV handle");
+  }
+  XPtr<BandHandle> handle(bands);
+  if (handle.get() == 0) {
+    stop("invalid bands handle (was the session restored?)");
+  }
+  const BandForcing &f = **handle;
+
+  // area
+  int chk_1 = sum( is_na(area) );
+  if(chk_1 != 0){
+
+    stop("area argument should not contain NA values!");
+
+  }
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if (surface.size() != f.nband) {
+    stop("surface must have one value per band");
+  }
+  for (int b = 0; b < f.nband; ++b) {
+    if (surface[b] != SURFACE_GLACIER && surface[b] != SURFACE_SOIL &&
+        surface[b] != SURFACE_DEBRIS) {
+      stop("surface values must be 1, 2 or 3");
+    }
+  }
+  if (area.size() != f.nband) {
+    stop("area must have one value per band");
+  }
+  if (initCond.size() != 1 && initCond.size() != f.nband) {
+    stop("Please verify the initCond argument");
+  }
+  if (param.ncol() != 6){
+    stop("Please verify the parameter matrix");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  EnsembleBands e;
+  e.forcing = &f;
+  e.surface.assign(surface.begin(), surface.end());
+  e.area.assign(area.begin(), area.end());
+  e.SWE0.assign(f.nband, initCond[0]);
+  if (initCond.size() == f.nband) {
+    e.SWE0.assign(initCond.begin(), initCond.end());
+  }
+
+  if (async) {
+    std::shared_ptr<EnsembleJob> job =
+      std::make_shared<EnsembleJob>(e, *handle, param.begin(), param.nrow());
+    ensemble_start(job, job_pool());
+
+    return job_handle(job, "ensemble", [job](){
+      int n = job->e.forcing->n;
+      NumericMatrix out(n, job->nmember);
+      for (int m = 0; m < job->nmember; ++m) {
+        // miembros sin terminar (cancelación)
+        bool ok = job->complete(m);
+        for (int i = 0; i < n; ++i) {
+          out(i, m) = ok ? job->out[i + (size_t) m * n] : NA_REAL;
+        }
+      }
+      return (SEXP) out;
+    });
+  }
+
+  NumericMatrix out(f.n, param.nrow());
+  ensemble_bands(e, param.begin(), param.nrow(), out.begin());
+
+  return out;
+
+}
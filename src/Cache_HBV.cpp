@@ -0,0 +1,126 @@
+#include <Rcpp.h>
+#include "aa_cache.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+//' @name Cache_HBV
+//'
+//' @title Evaluation cache statistics
+//'
+//' @description Query, resize or clear the least recently used caches that sit in front of
+//' \code{\link{Objective_HBV}}. Optimization algorithms (e.g.: SCE-UA or DDS) often evaluate
+//' the same (or a bound-clipped) parameter vector more than once; those evaluations are
+//' answered from the \emph{objective} cache. The \emph{snow} and \emph{soil} caches keep the
+//' \code{\link{SnowGlacier_HBV}} and \code{\link{Soil_HBV}} output series per upstream
+//' parameter set, so coordinate-wise search methods (e.g.: DDS or Morris screening) skip
+//' those stages when only downstream parameters change. The \emph{bands} cache keeps the
+//' elevation band forcing built by \code{\link{Bands_HBV}}.
+//'
+//' @usage Cache_HBV(
+//'        capacity = -1,
+//'        stages = -1,
+//'        clear = FALSE,
+//'        bands = -1
+//' )
+//'
+//' @param capacity numeric integer with the maximum number of cached evaluations. Negative
+//' values keep the current capacity and zero disables the cache.
+//'
+//' @param stages numeric integer with the maximum number of series kept by each stage cache.
+//' Every entry holds a whole series, so keep it small for long runs. Negative values keep the
+//' current capacity and zero disables the stage caches.
+//'
+//' @param clear logical. When \code{TRUE} all the entries and counters are removed.
+//'
+//' @param bands numeric integer with the maximum number of band forcing sets kept in memory.
+//' Negative values keep the current capacity and zero disables the cache.
+//'
+//' @return Numeric matrix with one row per cache and the following columns:
+//' \itemize{
+//'   \item \code{hits}: number of evaluations answered from the cache.
+//'   \item \code{misses}: number of evaluations that run the model.
+//'   \item \code{size}: current number of entries.
+//'   \item \code{capacity}: maximum number of entries.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' Cache_HBV(clear = TRUE)
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] )
+//' param   <- c(1.20, 1.00, 0.00, 2.5, 200, 0.8, 1.15, 0.9, 0.01, 0.001, 0.5, 0.01, 1.5)
+//'
+//' for(i in 1:2){
+//'   Objective_HBV(routing = 1, inputData = forcing, obs = lumped_hbv$`qout(mm/d)`,
+//'                 initCond = c(20, 100, 0, 0, 0), param = param)
+//' }
+//'
+//' Cache_HBV()
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix Cache_HBV(int capacity = -1,
+                        int stages = -1,
+                        bool clear = false,
+                        int bands = -1){
+  EvalCache &cache  = objective_cache();
+  StageCache &snow  = snow_cache();
+  StageCache &soil  = soil_cache();
+  BandCache &band   = band_cache();
+
+  if (clear) {
+    cache.clear();
+    snow.clear();
+    soil.clear();
+    band.clear();
+  }
+  if (capacity >= 0) {
+    cache.resize(capacity);
+  }
+  if (stages >= 0) {
+    snow.resize(stages);
+    soil.resize(stages);
+  }
+  if (bands >= 0) {
+    band.resize(bands);
+  }
+
+  NumericMatrix out(4, 4);
+  out(0, 0) = cache.hits();
+  out(0, 1) = cache.misses();
+  out(0, 2) = cache.size();
+  out(0, 3) = cache.capacity();
+
+  out(1, 0) = snow.hits();
+  out(1, 1) = snow.misses();
+  out(1, 2) = snow.size();
+  out(1, 3) = snow.capacity();
+
+  out(2, 0) = soil.hits();
+  out(2, 1) = soil.misses();
+  out(2, 2) = soil.size();
+  out(2, 3) = soil.capacity();
+
+  out(3, 0) = band.hits();
+  out(3, 1) = band.misses();
+  out(3, 2) = band.size();
+  out(3, 3) = band.capacity();
+
+  rownames(out) = CharacterVector::create("objective", "snow", "soil", "bands");
+  colnames(out) = CharacterVector::create("hits", "misses", "size", "capacity");
+  return out;
+}
@@ -0,0 +1,244 @@
+#include <Rcpp.h>
+#include "aa_calibrate.h"
+#include "aa_handle.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// CALIBRACIÓN DE VARIAS CUENCAS
+// Cada cuenca se calibra con DDS (Tolson & Shoemaker, 2007) sobre el modelo
+// agregado de Objective_HBV. Las cuencas se reparten entre hilos (las más
+// largas primero) y cada resultado se escribe en el archivo apenas termina.
+// Los argumentos se verifican acá, en el hilo principal de R.
+
+// CUENCAS - basins
+// lista de listas con: forcing (Forcing_HBV), routing, initCond, lower, upper,
+// maxEval y seed
+
+// ASINCRÓNICO - async
+// con async = TRUE la calibración corre en el pool compartido y se devuelve
+// un manejador (ver JobStatus_HBV, JobCancel_HBV y JobCollect_HBV)
+*/
+
+// lista de resultados (hilo principal de R)
+static List calibration_list(const std::vector<BasinConfig> &configs,
+                             const std::vector<BasinResult> &results){
+  int nb = configs.size();
+
+  CharacterVector names(nb);
+  List out(nb);
+  for (int b = 0; b < nb; ++b) {
+    const BasinResult &res = results[b];
+    names[b] = configs[b].name;
+
+    if ( !res.error.empty() ) {
+      warning("basin " + configs[b].name + ": " + res.error);
+    }
+
+    out[b] = List::create(Named("param")       = wrap(res.param),
+                          Named("SSE")         = res.error.empty() ? res.sse : NA_REAL,
+                          Named("evaluations") = res.evaluations,
+                          Named("pruned")      = res.pruned,
+                          Named("seconds")     = res.seconds,
+                          Named("cancelled")   = res.cancelled);
+  }
+  out.attr("names") = names;
+
+  return out;
+}
+
+//' @name Calibrate_HBV
+//'
+//' @title Batch calibration of lumped models
+//'
+//' @description Calibrates the lumped model of \code{\link{Objective_HBV}} in many catchments
+//' at once with the Dynamically Dimensioned Search algorithm (DDS, Tolson & Shoemaker, 2007).
+//' The catchments are scheduled (longest jobs first) on the shared pool of native threads
+//' (see \code{\link{Threads_HBV}})
+//' and every result is appended to \code{file} as soon as its catchment finishes, so a long
+//' batch can be monitored or recovered. Each candidate is pruned with the best value found so
+//' far (see \code{bound} in \code{\link{Objective_HBV}}).
+//'
+//' @usage Calibrate_HBV(
+//'        basins,
+//'        file = "",
+//'        threads = 0,
+//'        async = FALSE
+//' )
+//'
+//' @param basins named list. Each element is a list with:
+//' \itemize{
+//'   \item \code{forcing}: catchment handle from \code{\link{Forcing_HBV}}. The same handle can
+//'   be used by several elements (e.g.: to compare routing models).
+//'   \item \code{routing}: numeric integer with the \code{\link{Routing_HBV}} model (1 to 5).
+//'   \item \code{initCond}: numeric vector with the initial conditions (see \code{\link{Objective_HBV}}).
+//'   \item \code{lower}, \code{upper}: numeric vectors with the parameter bounds (see
+//'   \code{param} in \code{\link{Objective_HBV}}). Set both to the same value to fix a parameter.
+//'   \item \code{maxEval}: numeric integer with the number of model runs.
+//'   \item \code{seed}: (optional) non-negative numeric integer with the random number generator
+//'   seed.
+//' }
+//'
+//' @param file string with the path of the csv file where the results are written. An empty
+//' string (default) disables the output file. It has one row per catchment and the parameter
+//' columns \code{p1, p2, ...} of the longest parameter vector (\code{NA} for the catchments
+//' with fewer parameters). A file that can not be opened is an error.
+//'
+//' @param threads numeric integer with the maximum number of catchments calibrated at the same
+//' time. Zero or negative values use every thread of the shared pool.
+//'
+//' @param async logical. When \code{TRUE} the calibration runs in the background and a job
+//' handle is returned at once (see \code{\link{JobStatus_HBV}}, \code{\link{JobCancel_HBV}} and
+//' \code{\link{JobCollect_HBV}}). Keep the handle: a discarded handle cancels its job. The job
+//' runs on the pool of background jobs (see \code{\link{Threads_HBV}}).
+//'
+//' @return Named list with one element per catchment (or, with \code{async = TRUE}, a job
+//' handle that returns it):
+//' \itemize{
+//'   \item \code{param}: best parameter set.
+//'   \item \code{SSE}: its sum of squared errors.
+//'   \item \code{evaluations}: number of model runs.
+//'   \item \code{pruned}: number of runs stopped before the end of the series.
+//'   \item \code{seconds}: elapsed time.
+//'   \item \code{cancelled}: \code{TRUE} when the job was cancelled before the catchment
+//'   finished. The best parameter set found so far is returned (empty when the catchment
+//'   was never started).
+//' }
+//'
+//' @references
+//' Tolson, B. A., & Shoemaker, C. A. (2007). Dynamically dimensioned search algorithm for
+//' computationally efficient watershed model calibration. Water Resources Research, 43(1).
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- Forcing_HBV(
+//'   inputData = as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] ),
+//'   obs = lumped_hbv$`qout(mm/d)` )
+//'
+//' lower <- c(1, -1, -1, 1, 50, 0.5, 1, 0.1, 0.01, 0.001, 0, 0, 1)
+//' upper <- c(1.5, 2, 2, 6, 400, 1, 4, 0.9, 0.09, 0.009, 50, 40, 4)
+//'
+//' basins <- list(
+//'   route_1 = list(forcing = forcing, routing = 1, initCond = c(20, 100, 0, 0, 0),
+//'                  lower = lower, upper = upper, maxEval = 200, seed = 1),
+//'   route_3 = list(forcing = forcing, routing = 3, initCond = c(20, 100, 0, 0),
+//'                  lower = lower, upper = upper, maxEval = 200, seed = 1)
+//' )
+//'
+//' fit <- Calibrate_HBV(basins = basins, threads = 2)
+//'
+//' # in the background
+//' job <- Calibrate_HBV(basins = basins, threads = 2, async = TRUE)
+//' JobStatus_HBV(job)
+//' fit <- JobCollect_HBV(job)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Calibrate_HBV(List basins,
+                   std::string file = "",
+                   int threads = 0,
+                   bool async = false){
+  // *********************
+  //  conditionals
+  // *********************
+  int nb = basins.size();
+
+  CharacterVector names(nb);
+  if ( !Rf_isNull(basins.names()) ) {
+    names = basins.names();
+  }
+
+  std::vector<BasinConfig> configs(nb);
+  for (int b = 0; b < nb; ++b) {
+    List basin = basins[b];
+    BasinConfig &cfg = configs[b];
+
+    if (names[b] == NA_STRING || std::string(names[b]).empty()) {
+      names[b] = std::to_string(b + 1);
+    }
+    cfg.name = std::string(names[b]);
+
+    if ( !basin.containsElementNamed("forcing") ||
+         !Rf_inherits(basin["forcing"], "HBV_forcing") ) {
+      stop("basin " + cfg.name + ": forcing must be a Forcing_HBV handle");
+    }
+    XPtr<ForcingHandle> handle(as<SEXP>(basin["forcing"]));
+    if (handle.get() == 0) {
+      stop("basin " + cfg.name + ": invalid forcing handle (was the session restored?)");
+    }
+    cfg.forcing = *handle;
+
+    cfg.routing = as<int>(basin["routing"]);
+    if ( (cfg.routing < 1) || (cfg.routing > 5) ) {
+      stop("basin " + cfg.name + ": Routing model not available");
+    }
+
+    NumericVector initCond = basin["initCond"];
+    NumericVector lower    = basin["lower"];
+    NumericVector upper    = basin["upper"];
+
+    if ( sum( is_na(initCond) ) != 0 || sum( is_na(lower) ) != 0 || sum( is_na(upper) ) != 0 ) {
+      stop("basin " + cfg.name + ": initCond, lower and upper should not contain NA values!");
+    }
+    if (initCond.size() != pipeline_ninit(cfg.routing)) {
+      stop("basin " + cfg.name + ": Please verify the initCond vector");
+    }
+    if (lower.size() != pipeline_nparam(cfg.routing) || upper.size() != lower.size()) {
+      stop("basin " + cfg.name + ": Please verify the lower and upper vectors");
+    }
+    if ( is_true( any(upper < lower) ) ) {
+      stop("basin " + cfg.name + ": lower must be <= upper");
+    }
+
+    cfg.initCond.assign(initCond.begin(), initCond.end());
+    cfg.lower.assign(lower.begin(), lower.end());
+    cfg.upper.assign(upper.begin(), upper.end());
+
+    cfg.maxEval = as<int>(basin["maxEval"]);
+    if (cfg.maxEval < 1) {
+      stop("basin " + cfg.name + ": maxEval must be >= 1");
+    }
+
+    cfg.seed = b + 1;
+    if (basin.containsElementNamed("seed")) {
+      double seed = as<double>(basin["seed"]);
+      // la conversión a uint64_t sólo está definida para enteros no negativos
+      if ( !R_finite(seed) || (seed < 0) || (seed != std::floor(seed)) || (seed >= 9007199254740992.0) ) {
+        stop("basin " + cfg.name + ": seed must be a non-negative integer");
+      }
+      cfg.seed = (uint64_t) seed;
+    }
+  }
+
+  // *********************
+  //  function
+  // *********************
+  if (async) {
+    std::shared_ptr<CalibrationJob> job = std::make_shared<CalibrationJob>(configs);
+    calibrate_start(job, job_pool(), threads, file);
+
+    return job_handle(job, "calibration", [job](){
+      return (SEXP) calibration_list(job->basins, job->results);
+    });
+  }
+
+  std::vector<BasinResult> results;
+  calibrate_batch(configs, threads, file, results);
+
+  return calibration_list(configs, results);
+
+}
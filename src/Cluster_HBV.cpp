@@ -0,0 +1,338 @@
+#include <Rcpp.h>
+#include <cmath>
+#include "aa_cluster.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// ENSAMBLES EN VARIOS PROCESOS
+// El coordinador (esta sesión de R) escucha en un puerto TCP, lanza los
+// trabajadores (Rscript ... Worker_HBV) y les reparte los juegos de
+// parámetros en tramos. Cada trabajador recibe el forzante una sola vez y
+// devuelve las SSE de cada tramo apenas lo termina. Todo funciona en
+// localhost; trabajadores de otros equipos pueden unirse con Worker_HBV.
+*/
+
+// manejador válido
+static Cluster& cluster_get(SEXP cluster){
+  if ( !Rf_inherits(cluster, "HBV_cluster") ) {
+    stop("cluster must be a Cluster_HBV handle");
+  }
+  XPtr<Cluster> handle(cluster);
+  if (handle.get() == 0) {
+    stop("invalid cluster handle (was the session restored?)");
+  }
+  return *handle;
+}
+
+//' @name Cluster_HBV
+//'
+//' @title Worker processes for distributed ensembles
+//'
+//' @description Starts a coordinator that listens on a TCP port and (optionally) launches
+//' \code{workers} R processes running \code{\link{Worker_HBV}} on this machine. The cluster is
+//' used by \code{\link{Distribute_HBV}} to spread large ensembles beyond the cores of one
+//' process. Workers started by hand (e.g.: on other machines, with \code{host = "0.0.0.0"})
+//' can join at any time.
+//'
+//' @usage Cluster_HBV(
+//'        workers = 2,
+//'        spawn = TRUE,
+//'        port = 0,
+//'        host = "127.0.0.1",
+//'        timeout = 60
+//' )
+//'
+//' @param workers numeric integer with the number of workers to wait for.
+//'
+//' @param spawn logical. When \code{TRUE} the workers are launched with \code{Rscript}.
+//'
+//' @param port numeric integer with the TCP port. Zero picks any free port.
+//'
+//' @param host string with the address to listen on. The default only accepts local workers.
+//'
+//' @param timeout numeric value with the maximum waiting time \eqn{[s]} for the workers.
+//'
+//' @return A cluster handle (external pointer) with the \code{port} and the number of
+//' \code{workers} as attributes. The workers are sent away with \code{\link{ClusterStop_HBV}}
+//' or when the handle is garbage collected.
+//'
+//' @examples
+//' \dontrun{
+//' cl <- Cluster_HBV(workers = 2)
+//' }
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Cluster_HBV(int workers = 2,
+                 bool spawn = true,
+                 int port = 0,
+                 std::string host = "127.0.0.1",
+                 double timeout = 60){
+  // *********************
+  //  conditionals
+  // *********************
+  if (workers < 1) {
+    stop("workers must be >= 1");
+  }
+  if (port < 0 || port > 65535) {
+    stop("Please verify the port argument");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  XPtr<Cluster> out(new Cluster(host, port), true);
+  int p = out->port();
+
+  if (spawn) {
+    Environment base = Environment::namespace_env("base");
+    Function system2 = base["system2"];
+    Function rhome   = base["R.home"];
+
+    std::string rscript = std::string( as<CharacterVector>(rhome("bin"))[0] ) + "/Rscript";
+    std::string target  = (host == "0.0.0.0") ? "127.0.0.1" : host;
+    std::string expr    = "\"HBV.IANIGLA::Worker_HBV(port = " + std::to_string(p) +
+                          ", host = '" + target + "')\"";
+
+    for (int w = 0; w < workers; ++w) {
+      system2(rscript, CharacterVector::create("-e", expr),
+              Named("wait") = false, Named("stdout") = false, Named("stderr") = false);
+    }
+  }
+
+  if (!out->accept(workers, timeout)) {
+    stop("only " + std::to_string(out->size()) + " of " + std::to_string(workers) +
+         " workers connected in " + std::to_string((int) timeout) + " s");
+  }
+
+  out.attr("class")   = "HBV_cluster";
+  out.attr("port")    = p;
+  out.attr("workers") = out->size();
+
+  return out;
+
+}
+
+//' @name Distribute_HBV
+//'
+//' @title Distributed ensemble of lumped models
+//'
+//' @description Computes the sum of squared errors of the lumped model of
+//' \code{\link{Objective_HBV}} for many parameter sets on the workers of a
+//' \code{\link{Cluster_HBV}}. The sets are sent in chunks (at most two pending chunks per
+//' worker, so faster workers take more of them) and the scores come back as soon as each chunk
+//' finishes. The forcing is shipped once per worker and reused by later calls with the same
+//' \code{\link{Forcing_HBV}} handle. Chunks of a worker that disconnects are sent again to the
+//' others.
+//'
+//' @usage Distribute_HBV(
+//'        cluster,
+//'        forcing,
+//'        routing,
+//'        initCond,
+//'        param,
+//'        chunk = 100,
+//'        timeout = 600
+//' )
+//'
+//' @param cluster handle from \code{\link{Cluster_HBV}}.
+//'
+//' @param forcing catchment handle from \code{\link{Forcing_HBV}}.
+//'
+//' @param routing numeric integer with the \code{\link{Routing_HBV}} model (1 to 5).
+//'
+//' @param initCond numeric vector with the initial conditions (see \code{\link{Objective_HBV}}).
+//'
+//' @param param numeric matrix with one parameter set (see \code{\link{Objective_HBV}}) per row.
+//'
+//' @param chunk numeric integer with the number of parameter sets per message.
+//'
+//' @param timeout numeric value with the maximum time \eqn{[s]} without news from the workers.
+//' When it is exceeded (or a worker fails) the workers are sent away and an error is raised. The
+//' call can be interrupted (e.g.: Ctrl-C), which also sends the workers away.
+//'
+//' @return Numeric vector with the sum of squared errors of every parameter set (\code{NA} for
+//' sets that violate the model constraints).
+//'
+//' @examples
+//' \dontrun{
+//' data("lumped_hbv")
+//'
+//' forcing <- Forcing_HBV(
+//'   inputData = as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] ),
+//'   obs = lumped_hbv$`qout(mm/d)` )
+//'
+//' lower <- c(1, -1, -1, 1, 50, 0.5, 1, 0.1, 0.01, 0.001, 0, 0, 1)
+//' upper <- c(1.5, 2, 2, 6, 400, 1, 4, 0.9, 0.09, 0.009, 50, 40, 4)
+//' sets  <- t( replicate(1000, runif(13, lower, upper)) )
+//'
+//' cl  <- Cluster_HBV(workers = 2)
+//' sse <- Distribute_HBV(cluster = cl, forcing = forcing, routing = 1,
+//'                       initCond = c(20, 100, 0, 0, 0), param = sets)
+//' ClusterStop_HBV(cl)
+//' }
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericVector Distribute_HBV(SEXP cluster,
+                             SEXP forcing,
+                             int routing,
+                             NumericVector initCond,
+                             NumericMatrix param,
+                             int chunk = 100,
+                             double timeout = 600){
+  // *********************
+  //  conditionals
+  // *********************
+  Cluster &cl = cluster_get(cluster);
+
+  if ( !Rf_inherits(forcing, "HBV_forcing") ) {
+    stop("forcing must be a Forcing_HBV handle");
+  }
+  XPtr<ForcingHandle> handle(forcing);
+  if (handle.get() == 0) {
+    stop("invalid forcing handle (was the session restored?)");
+  }
+
+  // initCond
+  int chk_1 = sum( is_na(initCond) );
+  if(chk_1 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_2 = sum( is_na(param) );
+  if(chk_2 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if ( (routing < 1) || (routing > 5) ) {
+    stop("Routing model not available");
+  }
+  if (initCond.size() != pipeline_ninit(routing)) {
+    stop("Please verify the initCond vector");
+  }
+  if (param.ncol() != pipeline_nparam(routing)) {
+    stop("Please verify the parameter matrix");
+  }
+  if (chunk < 1) {
+    stop("chunk must be >= 1");
+  }
+  if (cl.size() == 0) {
+    stop("the cluster has no workers (see ClusterStop_HBV)");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  int nset = param.nrow();
+  std::vector<double> init(initCond.begin(), initCond.end());
+
+  NumericVector out(nset);
+  cl.evaluate(*handle, routing, init, param.begin(), nset, param.ncol(), chunk, timeout,
+              out.begin());
+
+  // juegos inválidos
+  for (int s = 0; s < nset; ++s) {
+    if (std::isnan(out[s])) out[s] = NA_REAL;
+  }
+
+  return out;
+
+}
+
+//' @name Worker_HBV
+//'
+//' @title Worker process of a distributed ensemble
+//'
+//' @description Connects to a \code{\link{Cluster_HBV}} coordinator and evaluates the parameter
+//' sets it sends until the coordinator stops it. \code{\link{Cluster_HBV}} launches it with
+//' \code{Rscript}; call it by hand to add workers from other sessions or machines.
+//'
+//' @usage Worker_HBV(
+//'        port,
+//'        host = "127.0.0.1",
+//'        timeout = 60
+//' )
+//'
+//' @param port numeric integer with the TCP port of the coordinator.
+//'
+//' @param host string with the address of the coordinator.
+//'
+//' @param timeout numeric value with the maximum time \eqn{[s]} to wait for the coordinator.
+//'
+//' @return Number of parameter sets evaluated by this worker.
+//'
+//' @examples
+//' \dontrun{
+//' # in another R session
+//' Worker_HBV(port = attr(cl, "port"))
+//' }
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+double Worker_HBV(int port,
+                  std::string host = "127.0.0.1",
+                  double timeout = 60){
+  // *********************
+  //  conditionals
+  // *********************
+  if (port < 1 || port > 65535) {
+    stop("Please verify the port argument");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  return worker_serve(host, port, timeout);
+
+}
+
+//' @name ClusterStop_HBV
+//'
+//' @title Stop the worker processes
+//'
+//' @description Sends away the workers of a \code{\link{Cluster_HBV}}. The worker processes
+//' launched by \code{\link{Cluster_HBV}} end after it.
+//'
+//' @usage ClusterStop_HBV(
+//'        cluster
+//' )
+//'
+//' @param cluster handle from \code{\link{Cluster_HBV}}.
+//'
+//' @return Number of workers that were connected.
+//'
+//' @examples
+//' \dontrun{
+//' ClusterStop_HBV(cl)
+//' }
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+int ClusterStop_HBV(SEXP cluster){
+  Cluster &cl = cluster_get(cluster);
+
+  int n = cl.size();
+  cl.shutdown();
+
+  return n;
+}
@@ -1,4 +1,5 @@
 #include <Rcpp.h>
+#include "aa_pet.h"
 using namespace Rcpp;
 
 // **********************************************************
@@ -159,81 +160,134 @@ NumericVector PET(int model,
 
   if (model == 1) {
     // SINUSOIDAL - Calder et al. (1983)
+    // el hemisferio es un desfasaje del término estacional (tabulado por día)
 
-    if (hemis == 1) {
-      // Hemisferio Sur
-      int n = inputData.size();
+    if (hemis != 1 && hemis != 2) {
 
-      // Declaro variables
-      double zref, ztopo;
-      double EP, gradPET;
-      NumericVector out(n);
-
-      // Asigno valores a variables
-      zref  = elev[0];
-      ztopo = elev[1];
-
-      EP      = param[0];
-      gradPET = param[1];
-
-      // Corro modelo
-      for (int i = 0; i < n; ++i) {
-        if (inputData(i, 0) == 0.0) { // PET igual a cero
-          out[i] = 0.0;
+      stop("Hemisphere must be 1 or 2");
 
-        } else {
+    }
 
-          out[i] = std::max(EP * ( 1 + std::sin( (360 * inputData[i] / 366 + 90) * M_PI / 180 ) ) +
-            (ztopo -  zref) * (gradPET / 100), 0.0);
+    int n = inputData.nrow();
+    NumericVector out(n);
 
-        }
+    // zref, ztopo, PET, gradPET
+    pet_bands(hemis, inputData.begin(), n, elev[0], elev.begin() + 1, 1,
+              param[0], param[1], out.begin());
 
-      }
+    return out;
 
-      return out;
+  } else {
 
+    stop("Model not available");
 
-    } else if (hemis == 2) {
-      // Hemisferio Norte
-      int n = inputData.size();
+  }
+} // cierre función
 
-      // Declaro variables
-      double zref, ztopo;
-      double EP, gradPET;
-      NumericVector out(n);
+//' @name PETBands
+//'
+//' @title Potential Evapotranspiration over many elevation bands
+//'
+//' @description Same as \code{\link{PET}} but for a vector of target heights. The seasonal
+//' term is computed once per day of year and shared by all the bands, which are returned as
+//' the columns of a matrix (one pass instead of one \code{PET} call per band).
+//'
+//' @usage PETBands(
+//'   model,
+//'   hemis,
+//'   inputData,
+//'   elev,
+//'   param
+//'   )
+//'
+//' @param model numeric value with model option (see \code{\link{PET}}).
+//'
+//' @param hemis numeric value indicating the hemisphere:
+//' \itemize{
+//'   \item 1: southern hemisphere.
+//'   \item 2: northern hemisphere.
+//' }
+//'
+//' @param inputData numeric matrix with the julian dates in the first column, e.g:
+//' \code{as.matrix( c(1:365) )}.
+//'
+//' @param elev numeric vector with the reference height (\code{zref}) followed by the target
+//' heights of the bands \eqn{[masl]}.
+//'
+//' @param param numeric vector with \code{PET} [mm] and \code{gradPET} [mm/100 m] (see
+//' \code{\link{PET}}).
+//'
+//' @return Numeric matrix (time steps x bands) with the potential evapotranspiration series.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' potEvap <- PETBands(model = 1, hemis = 1,
+//'                     inputData = as.matrix( rep(1:365, 2) ),
+//'                     elev = c(1000, 1500, 2500, 3500),
+//'                     param = c(4, 0.5))
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix PETBands(int model,
+                       int hemis,
+                       NumericMatrix inputData,
+                       NumericVector elev,
+                       NumericVector param) {
+  // *********************
+  //  conditionals
+  // *********************
 
-      // Asigno valores a variables
-      zref  = elev[0];
-      ztopo = elev[1];
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
 
-      EP      = param[0];
-      gradPET = param[1];
+    stop("inputData argument should not contain NA values!");
 
-      // Corro modelo
-      for (int i = 0; i < n; ++i) {
-        if (inputData(i, 0) == 0.0) { // PET igual a cero
-          out[i] = 0.0;
+  }
 
-        } else {
+  // elev
+  int chk_2 = sum( is_na(elev) );
+  if(chk_2 != 0){
 
-          out[i] = std::max(EP * ( 1 + std::sin( (360 * inputData[i] / 366 - 90) * M_PI / 180 ) ) +
-            (ztopo -  zref) * (gradPET / 100), 0.0);
+    stop("elev argument should not contain NA values!");
 
-        }
+  }
 
-      }
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
 
-      return out;
+    stop("param argument should not contain NA values!");
 
-    } else {
+  }
 
-      stop("Hemisphere must be 1 or 2");
+  if (model != 1) {
+    stop("Model not available");
+  }
+  if (hemis != 1 && hemis != 2) {
+    stop("Hemisphere must be 1 or 2");
+  }
+  if (elev.size() < 2) {
+    stop("Please verify the elev vector");
+  }
+  if (param.size() < 2) {
+    stop("Please verify the param vector");
+  }
 
-    }
+  // *********************
+  //  function
+  // *********************
+  int n     = inputData.nrow();
+  int nband = elev.size() - 1;
 
-  } else {
+  NumericMatrix out(n, nband);
+  pet_bands(hemis, inputData.begin(), n, elev[0], elev.begin() + 1, nband,
+            param[0], param[1], out.begin());
 
-    stop("Model not available");
+  return out;
 
-  }
-} // cierre función
+}
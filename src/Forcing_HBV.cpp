@@ -0,0 +1,108 @@
+#include <Rcpp.h>
+#include "aa_cache.h"
+#include "aa_calibrate.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// FORZANTES DE UNA CUENCA
+// Copia las series de forzantes y caudal observado a memoria nativa (una sola
+// vez) y devuelve un puntero externo. Así Calibrate_HBV puede repartir las
+// cuencas entre hilos sin tocar objetos de R.
+
+// DATOS DE ENTRADA - inputData
+// #1# airT  : serie de temperatura [°C/deltaT]
+// #2# precip: serie de precipitación [mm/deltaT]
+// #3# PET   : evapotranspiración potencial [mm/deltaT]
+*/
+
+//' @name Forcing_HBV
+//'
+//' @title Forcing handle for batch calibration
+//'
+//' @description Copies the forcing series and the observed discharge of a catchment to
+//' native memory once and returns a handle to them. The handle is shared by every
+//' \code{\link{Calibrate_HBV}} job that uses the catchment, so the series are neither copied
+//' nor checked again. The fingerprint of the series is also computed here, once, so
+//' \code{\link{Objective_HBV}} calls on the handle do not hash them again.
+//'
+//' @usage Forcing_HBV(
+//'        inputData,
+//'        obs
+//' )
+//'
+//' @param inputData numeric matrix with the following columns:
+//' \itemize{
+//' \item \code{column_1}: air temperature series \eqn{[°C/\Delta t]}.
+//' \item \code{column_2}: precipitation series \eqn{[mm/\Delta t]}.
+//' \item \code{column_3}: potential evapotranspiration series \eqn{[mm/\Delta t]}.
+//' }
+//'
+//' @param obs numeric vector with the observed discharge \eqn{[mm/\Delta t]}. \code{NA_real_}
+//' values are skipped.
+//'
+//' @return External pointer of class \code{HBV_forcing}.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- Forcing_HBV(
+//'   inputData = as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] ),
+//'   obs = lumped_hbv$`qout(mm/d)` )
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Forcing_HBV(NumericMatrix inputData,
+                 NumericVector obs){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  if (inputData.ncol() < 3) {
+    stop("Please verify the inputData matrix");
+  }
+  if (obs.size() != inputData.nrow()) {
+    stop("obs must have the same length as inputData rows");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  int n = inputData.nrow();
+
+  std::shared_ptr<ForcingData> data = std::make_shared<ForcingData>();
+  data->airT.assign(inputData.begin(), inputData.begin() + n);
+  data->precip.assign(inputData.begin() + n, inputData.begin() + 2 * n);
+  data->pet.assign(inputData.begin() + 2 * n, inputData.begin() + 3 * n);
+  data->obs.assign(obs.begin(), obs.end());
+  data->fingerprint = forcing_fingerprint(data->view());
+
+  XPtr<ForcingHandle> out(new ForcingHandle(data), true);
+  out.attr("class") = "HBV_forcing";
+  out.attr("n")     = n;
+
+  return out;
+
+}
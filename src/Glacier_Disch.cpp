@@ -1,4 +1,7 @@
 #include <Rcpp.h>
+#include "aa_altrep.h"
+#include "aa_stage.h"
+#include "aa_glacier.h"
 using namespace Rcpp;
 
 // **********************************************************
@@ -48,7 +51,13 @@ using namespace Rcpp;
 //'        model,
 //'        inputData,
 //'        initCond,
-//'        param
+//'        param,
+//'        lazy = FALSE,
+//'        aggregate = NULL,
+//'        stride = 1,
+//'        columns = NULL,
+//'        audit = FALSE,
+//'        into = NULL
 //'        )
 //'
 //' @param model numeric integer with the model's choice. The current HBV.IANIGLA version
@@ -82,6 +91,40 @@ using namespace Rcpp;
 //'  \item \code{AG}: scale factor \eqn{[mm]}.
 //'  }
 //'
+//' @param lazy logical. When \code{TRUE} the function returns at once a \code{data.frame} whose
+//' columns are computed on first access (ALTREP). Each column runs the model the first time it is
+//' touched and only that column is stored, so the columns nobody touches take no memory (when a
+//' second column is touched the model runs once more with every column, so touching all of them
+//' costs two runs).
+//'
+//' @param aggregate optional numeric integer. Either the length of the aggregation period in time
+//' steps (e.g.: \code{24} for daily values of an hourly run) or a vector with the period number
+//' (\code{1, 2, ...}) of every time step. The outputs are accumulated per period inside the time
+//' loop and the function returns a list with the \code{sum}, \code{mean}, \code{min} and
+//' \code{max} matrices (one row per period, same columns as below) and \code{n}, the number of
+//' time steps of every period. It can not be combined with \code{lazy}.
+//'
+//' @param stride numeric integer. Only every \code{stride}-th time step (rows \code{1, 1 + stride, ...})
+//' is stored while the model still runs every time step (e.g.: state snapshots of long runs).
+//' It can not be combined with \code{aggregate}.
+//'
+//' @param columns optional character vector with the names of the output columns to keep (e.g.:
+//' \code{c('SWE', 'SM')}). The other columns are never stored.
+//'
+//' @param audit logical. When \code{TRUE} the time loop also accumulates the mass balance of the
+//' glacier reservoir. It can not be combined with \code{lazy} or \code{into}.
+//'
+//' @param into optional numeric (double) matrix with the dimensions of the output (rows: time
+//' steps, or every \code{stride}-th one; columns: the kept ones). The output is written into it in
+//' place and the same matrix is returned (only its values: its attributes, e.g. the column names,
+//' are left untouched), so repeated runs (e.g.: calibration loops) reuse a single buffer,
+//' allocated once with \code{matrix(0, nrow, ncol)}. It can not be combined with \code{aggregate},
+//' \code{lazy} or \code{audit}. \strong{Warning}: the matrix is modified in place, outside R's
+//' copy-on-modify semantics. It is not copied when other variables refer to it, so every variable
+//' assigned from it (e.g.: \code{kept <- out} after a previous run) and every list holding it see
+//' the new values too. Use a matrix created only for this purpose and keep earlier results with an
+//' explicit copy (e.g.: \code{kept <- out + 0}).
+//'
 //' @return Numeric matrix with the following columns:
 //'
 //' \strong{Model 1 (S08)}
@@ -90,6 +133,13 @@ using namespace Rcpp;
 //'   \item \code{SG}: glacier's bucket water storage content series \eqn{[1/\Delta t]}.
 //' }
 //'
+//' With \code{audit = TRUE} the output carries a \code{"balance"} attribute: a data frame with
+//' the \code{input} (sum of \code{column_2}), \code{output} (sum of \code{Q}), \code{initial}
+//' and \code{final} storage (\code{SG} minus the last \code{Q}) and the closure \code{error}
+//' (input - output - storage change) of the reservoir \eqn{[mm]}.
+//'
+//' With \code{into} the output is that matrix (the column names are set on the first call).
+//'
 //' @references
 //' Jansson, P., Hock, R., Schneider, T., 2003. The concept of glacier storage: a review.
 //' J. Hydrol., Mountain Hydrology and Water Resources 282, 116–129.
@@ -116,10 +166,34 @@ using namespace Rcpp;
 //'
 //'
 // [[Rcpp::export]]
-NumericMatrix Glacier_Disch(int model,
-                            NumericMatrix inputData,
-                            double initCond,
-                            NumericVector param){
+SEXP Glacier_Disch(int model,
+                   NumericMatrix inputData,
+                   double initCond,
+                   NumericVector param,
+                   bool lazy = false,
+                   Nullable<IntegerVector> aggregate = R_NilValue,
+                   int stride = 1,
+                   Nullable<CharacterVector> columns = R_NilValue,
+                   bool audit = false,
+                   SEXP into = R_NilValue){
+  if (lazy && (aggregate.isNotNull() || stride != 1 || columns.isNotNull() || audit ||
+               into != R_NilValue)) {
+    stop("lazy option can not be combined with aggregate, stride, columns, audit or into");
+  }
+  // el balance va como atributo: no se tocan los de una matriz ajena
+  if (audit && (into != R_NilValue)) {
+    stop("into option can not be combined with audit");
+  }
+  if (lazy) {
+    // salida diferida: el módulo corre recién al tocar una columna
+    freeze(inputData);
+    freeze(param);
+    return lazy_stage(inputData.nrow(), [=](int rows, SEXP cols) -> SEXP {
+      return Glacier_Disch(model, head_rows(inputData, rows), initCond, param, false,
+                           R_NilValue, 1, cols);
+    });
+  }
+
   // *********************
   //  conditionals
   // *********************
@@ -141,6 +215,9 @@ NumericMatrix Glacier_Disch(int model,
 
   }
 
+  // agregación temporal o submuestreo de las salidas
+  OutputSpec spec = output_spec(aggregate, stride, columns, inputData.nrow(), into);
+
   // *********************
   //  models
   // *********************
@@ -157,32 +234,24 @@ NumericMatrix Glacier_Disch(int model,
 
     int n = inputData.nrow(); // número de filas
     int m = 2;                // número de columnas
-    NumericMatrix out(n, m);
-
-    double KGmin, dKG, AG;
-    double Q, KG, SG;
-
-    // Asigno parámetros
-    KGmin = param[0];
-    dKG   = param[1];
-    AG    = param[2];
-
-    for (int i = 0; i < n; ++i) {
-      KG = std::min( KGmin + dKG * exp(-inputData(i, 0) / AG), 1.0);
-      if (i == 0){
-        SG = inputData(i, 1) + initCond;
-      } else {
-        SG = std::max( (inputData(i, 1) - Q) + SG, 0.0);
-      }
-      Q = KG * SG;
-
-      // Relleno matriz de salida
-      out(i, 0) = Q;
-      out(i, 1) = SG;
+    StageOutput out(n, m, spec,
+                    {"Q", "SG"});
+
+    // KG de toda la serie (vectorizado) y luego la recurrencia de SG
+    if (!audit) {
+      glacier_run(inputData.begin(), inputData.begin() + n, n,
+                  initCond, param.begin(), out);
+
+      return out.result();
     }
 
-    colnames(out) = CharacterVector::create("Q", "SG");
-    return out;
+    std::vector<StoreBalance> bal(1);
+    glacier_run(inputData.begin(), inputData.begin() + n, n,
+                initCond, param.begin(), out, &bal[0]);
+
+    RObject res = out.result();
+    res.attr("balance") = balance_frame(bal);
+    return res;
 
   } else {
     stop("Model not available");
@@ -190,3 +259,110 @@ NumericMatrix Glacier_Disch(int model,
   }
 
 }
+
+//' @name GlacierBatch_HBV
+//'
+//' @title Glacier discharge of many parameter sets
+//'
+//' @description Run the \strong{S08} glacier storage and release model (\link{Glacier_Disch}
+//' model 1) for many parameter sets over the same input series (e.g.: Monte Carlo sampling or
+//' calibration of \code{KGmin}, \code{dKG} and \code{AG}). The outflow rates of every set are
+//' computed first for the whole series with vectorized code; then the reservoir recurrences of
+//' neighbouring sets run interleaved and blocks of sets are spread over the shared thread pool
+//' (see \code{\link{Threads_HBV}}).
+//'
+//' @usage GlacierBatch_HBV(
+//'        inputData,
+//'        initCond,
+//'        param
+//'        )
+//'
+//' @param inputData numeric matrix with two columns: snow water equivalent above the glacier
+//' and melted snow + melted ice + rainfall \eqn{[mm/\Delta t]} (see \link{Glacier_Disch}).
+//'
+//' @param initCond numeric vector with the initial glacier reservoir water content
+//' \strong{\code{SG}} \eqn{[mm]}. Either a single value for every set or one value per set.
+//'
+//' @param param numeric matrix with three columns (\code{KGmin}, \code{dKG} and \code{AG}) and
+//' one row per parameter set.
+//'
+//' @return Numeric matrix with the glacier discharge \eqn{[mm/\Delta t]} of every parameter set
+//' (one column per row of \code{param}). Every column is equal to the \code{Q} column of
+//' \link{Glacier_Disch} with the same parameters.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' DataMatrix <- cbind(
+//'                     runif(n = 100, min = 0, max = 50),
+//'                     runif(n = 100, min = 0, max = 200)
+//'                     )
+//'
+//' sets <- cbind(runif(50, 0.01, 0.1), runif(50, 0.5, 0.9), runif(50, 5, 50))
+//'
+//' dischGl <- GlacierBatch_HBV(inputData = DataMatrix, initCond = 100, param = sets)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix GlacierBatch_HBV(NumericMatrix inputData,
+                               NumericVector initCond,
+                               NumericMatrix param){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if (inputData.ncol() < 2) {
+    stop("Please verify inputData matrix");
+  }
+  if (param.ncol() != 3) {
+    stop("param should have three columns: KGmin, dKG and AG");
+  }
+
+  int n    = inputData.nrow();
+  int nset = param.nrow();
+
+  if (initCond.size() != 1 && initCond.size() != nset) {
+    stop("initCond should have one value or one value per parameter set");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  std::vector<double> SG0(initCond.begin(), initCond.end());
+  if (initCond.size() == 1) {
+    SG0.assign(nset, initCond[0]);
+  }
+
+  NumericMatrix Q(n, nset);
+  glacier_batch(inputData.begin(), inputData.begin() + n, n,
+                SG0.data(), param.begin(), nset, Q.begin());
+
+  return Q;
+}
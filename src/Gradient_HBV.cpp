@@ -0,0 +1,175 @@
+#include <Rcpp.h>
+#include "aa_pipeline.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// FUNCIÓN OBJETIVO SUAVIZADA Y SU GRADIENTE
+// Mismo modelo agregado que Objective_HBV pero con los umbrales reemplazados
+// por transiciones suaves (sigmoide/softplus) de pendiente 'sharpness'. El
+// gradiente se calcula en la misma pasada con números duales (modo directo).
+*/
+
+//' @name Gradient_HBV
+//'
+//' @title Smooth objective function and its gradient
+//'
+//' @description Evaluates a smoothed version of the lumped model used by
+//' \code{\link{Objective_HBV}} and returns the sum of squared errors together with its
+//' gradient with respect to every parameter, computed in the same pass with forward-mode
+//' dual numbers. The thresholds of the original modules (rainfall/snowfall partition, melt
+//' temperature, snow presence, soil moisture limits and reservoir switches) are replaced
+//' by sigmoid and softplus transitions, so gradient-based optimizers (e.g.:
+//' \code{optim(method = "L-BFGS-B")}) can be used. The original model is recovered as
+//' \code{sharpness} grows.
+//'
+//' @usage Gradient_HBV(
+//'        routing,
+//'        inputData,
+//'        obs,
+//'        initCond,
+//'        param,
+//'        sharpness = 10
+//' )
+//'
+//' @param routing numeric integer with the \code{\link{Routing_HBV}} model (1 to 5).
+//'
+//' @param inputData numeric matrix with air temperature, precipitation and potential
+//' evapotranspiration series (as in \code{\link{Objective_HBV}}).
+//'
+//' @param obs numeric vector with the observed discharge \eqn{[mm/\Delta t]}. \code{NA_real_}
+//' values are skipped.
+//'
+//' @param initCond numeric vector with \code{SWE0}, \code{SM0} and the initial conditions of the
+//' selected \code{\link{Routing_HBV}} model.
+//'
+//' @param param numeric vector with the model parameters (as in \code{\link{Objective_HBV}}).
+//'
+//' @param sharpness numeric value with the slope of the smooth transitions \eqn{[1/°C]} or
+//' \eqn{[1/mm]}. Near every threshold the smooth states differ from the original ones by about
+//' 1/sharpness: e.g. the snow water equivalent may fall slightly below zero on snow-free steps,
+//' while melt and runoff stay non-negative.
+//'
+//' @return List with the following elements:
+//' \itemize{
+//'   \item \code{SSE}: sum of squared errors of the smooth model.
+//'   \item \code{gradient}: numeric vector with the partial derivatives of \code{SSE}
+//'   with respect to \code{param}.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] )
+//' qobs    <- lumped_hbv$`qout(mm/d)`
+//' init    <- c(20, 100, 0, 0, 0)
+//'
+//' fn <- function(x){
+//'   Gradient_HBV(routing = 1, inputData = forcing, obs = qobs,
+//'                initCond = init, param = x)$SSE
+//' }
+//' gr <- function(x){
+//'   Gradient_HBV(routing = 1, inputData = forcing, obs = qobs,
+//'                initCond = init, param = x)$gradient
+//' }
+//'
+//' lower <- c(1.2, 1, 0, 2.5, 200, 0.8, 1.15, 0.50, 0.005, 0.0001, 10, 0.1, 1)
+//' upper <- c(1.2, 1, 0, 2.5, 200, 0.8, 1.15, 0.95, 0.100, 0.0050, 50, 5.0, 3)
+//'
+//' fit <- optim(par = (lower + upper) / 2, fn = fn, gr = gr, method = "L-BFGS-B",
+//'              lower = lower, upper = upper, control = list(maxit = 20))
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+List Gradient_HBV(int routing,
+                  NumericMatrix inputData,
+                  NumericVector obs,
+                  NumericVector initCond,
+                  NumericVector param,
+                  double sharpness = 10){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if ( (routing < 1) || (routing > 5) ) {
+    stop("Routing model not available");
+  }
+  if (inputData.ncol() < 3) {
+    stop("Please verify the inputData matrix");
+  }
+  if (obs.size() != inputData.nrow()) {
+    stop("obs must have the same length as inputData rows");
+  }
+  if (initCond.size() != pipeline_ninit(routing)) {
+    stop("Please verify the initCond vector");
+  }
+  if (param.size() != pipeline_nparam(routing)) {
+    stop("Please verify the param vector");
+  }
+  if (sharpness <= 0) {
+    stop("Verify: sharpness > 0");
+  }
+
+  const char *msg = pipeline_check(routing, param.begin());
+  if (msg != 0) {
+    stop(msg);
+  }
+
+  // *********************
+  //  function
+  // *********************
+  int n = inputData.nrow();
+
+  Forcing f;
+  f.n      = n;
+  f.airT   = inputData.begin();
+  f.precip = inputData.begin() + n;
+  f.pet    = inputData.begin() + 2 * n;
+  f.obs    = obs.begin();
+
+  double sse;
+  NumericVector grad(param.size());
+  pipeline_sse_grad(routing, f, initCond.begin(), param.begin(), sharpness, sse, grad.begin());
+
+  return List::create(Named("SSE")      = sse,
+                      Named("gradient") = grad);
+
+}
@@ -0,0 +1,205 @@
+#include <Rcpp.h>
+#include "aa_handle.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// TRABAJOS EN SEGUNDO PLANO
+// Calibrate_HBV y Ensemble_HBV con async = TRUE devuelven un manejador apenas
+// envían sus tareas al pool de trabajos (job_pool), así las funciones que
+// esperan su resultado siguen teniendo el pool compartido. Desde R se consulta
+// el avance, se pide la cancelación (las tareas la revisan entre corridas del
+// modelo o entre bandas) y se recogen los resultados.
+*/
+
+// Ctrl-C durante las esperas del pool (TaskGroup::wait). R_ToplevelExec evita
+// que la interrupción salte por encima de los marcos de C++; la biblioteca se
+// carga desde el hilo de R, que es el que queda registrado.
+static void interrupt_fn(void *){
+  R_CheckUserInterrupt();
+}
+
+static bool r_interrupted(){
+  return R_ToplevelExec(interrupt_fn, NULL) == FALSE;
+}
+
+static const bool interrupt_hook = (set_interrupt_check(r_interrupted), true);
+
+// manejador válido
+static JobHandle& job_get(SEXP job){
+  if ( !Rf_inherits(job, "HBV_job") ) {
+    stop("job must be a handle from Calibrate_HBV or Ensemble_HBV (async = TRUE)");
+  }
+  XPtr<JobHandle> handle(job);
+  if (handle.get() == 0) {
+    stop("invalid job handle (was the session restored?)");
+  }
+  return *handle;
+}
+
+//' @name JobStatus_HBV
+//'
+//' @title Progress of a background job
+//'
+//' @description Reports the progress of a job started with \code{async = TRUE} (see
+//' \code{\link{Calibrate_HBV}} and \code{\link{Ensemble_HBV}}) without waiting for it.
+//'
+//' @usage JobStatus_HBV(
+//'        job
+//' )
+//'
+//' @param job handle returned by \code{\link{Calibrate_HBV}} or \code{\link{Ensemble_HBV}}.
+//'
+//' @return List with the following elements:
+//' \itemize{
+//'   \item \code{state}: \code{"running"}, \code{"cancelling"}, \code{"finished"} or
+//'   \code{"cancelled"}.
+//'   \item \code{kind}: \code{"calibration"} or \code{"ensemble"}.
+//'   \item \code{evaluations}: model runs done (calibration) or members finished (ensemble).
+//'   \item \code{planned}: model runs (\code{maxEval}) or members requested.
+//'   \item \code{done}: catchments or members finished.
+//'   \item \code{units}: number of catchments or members.
+//'   \item \code{best}: best SSE found so far in each catchment (\code{NA} for ensembles and
+//'   catchments not started yet).
+//'   \item \code{seconds}: elapsed time since the job was submitted, up to the moment it
+//'   finished (or stopped after a cancellation).
+//'   \item \code{rate}: evaluations per second over that time.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- Forcing_HBV(
+//'   inputData = as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] ),
+//'   obs = lumped_hbv$`qout(mm/d)` )
+//'
+//' lower <- c(1, -1, -1, 1, 50, 0.5, 1, 0.1, 0.01, 0.001, 0, 0, 1)
+//' upper <- c(1.5, 2, 2, 6, 400, 1, 4, 0.9, 0.09, 0.009, 50, 40, 4)
+//'
+//' basins <- list(
+//'   route_1 = list(forcing = forcing, routing = 1, initCond = c(20, 100, 0, 0, 0),
+//'                  lower = lower, upper = upper, maxEval = 2000, seed = 1)
+//' )
+//'
+//' job <- Calibrate_HBV(basins = basins, async = TRUE)
+//' JobStatus_HBV(job)
+//'
+//' JobCancel_HBV(job)
+//' fit <- JobCollect_HBV(job)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+List JobStatus_HBV(SEXP job){
+  JobHandle &h = job_get(job);
+  JobControl &c = h.job->control;
+
+  std::chrono::steady_clock::time_point end;
+  bool finished  = h.job->group.finished(end);
+  bool cancelled = c.cancelled();
+
+  std::string state = finished ? (cancelled ? "cancelled" : "finished") :
+                                 (cancelled ? "cancelling" : "running");
+
+  // el reloj se detiene al terminar la última tarea del trabajo
+  double seconds = finished ? c.seconds(end) : c.seconds();
+  double evals   = c.evaluations();
+
+  return List::create(Named("state")       = state,
+                      Named("kind")        = h.kind,
+                      Named("evaluations") = evals,
+                      Named("planned")     = c.planned(),
+                      Named("done")        = c.finished(),
+                      Named("units")       = c.units(),
+                      Named("best")        = wrap( c.best() ),
+                      Named("seconds")     = seconds,
+                      Named("rate")        = (seconds > 0.0) ? evals / seconds : 0.0);
+}
+
+//' @name JobCancel_HBV
+//'
+//' @title Cancel a background job
+//'
+//' @description Asks a job started with \code{async = TRUE} to stop. The workers check the
+//' request between model runs (\code{\link{Calibrate_HBV}}) or between band tasks
+//' (\code{\link{Ensemble_HBV}}), so the job stops shortly after; the partial results can then be
+//' collected with \code{\link{JobCollect_HBV}}.
+//'
+//' @usage JobCancel_HBV(
+//'        job
+//' )
+//'
+//' @param job handle returned by \code{\link{Calibrate_HBV}} or \code{\link{Ensemble_HBV}}.
+//'
+//' @return \code{TRUE} when the job was still running.
+//'
+//' @examples
+//' # see JobStatus_HBV
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+LogicalVector JobCancel_HBV(SEXP job){
+  JobHandle &h = job_get(job);
+
+  bool running = !h.job->group.finished();
+  h.job->control.cancel();
+
+  LogicalVector out = LogicalVector::create(running);
+  return out;
+}
+
+//' @name JobCollect_HBV
+//'
+//' @title Results of a background job
+//'
+//' @description Returns the results of a job started with \code{async = TRUE}: the same object
+//' that \code{\link{Calibrate_HBV}} or \code{\link{Ensemble_HBV}} return without it. The wait
+//' can be interrupted from R (the job keeps running).
+//'
+//' @usage JobCollect_HBV(
+//'        job,
+//'        wait = TRUE
+//' )
+//'
+//' @param job handle returned by \code{\link{Calibrate_HBV}} or \code{\link{Ensemble_HBV}}.
+//'
+//' @param wait logical. When \code{FALSE} an unfinished job is an error instead of being waited
+//' for.
+//'
+//' @return See \code{\link{Calibrate_HBV}} and \code{\link{Ensemble_HBV}}. Cancelled jobs return
+//' their partial results.
+//'
+//' @examples
+//' # see JobStatus_HBV
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP JobCollect_HBV(SEXP job,
+                    bool wait = true){
+  JobHandle &h = job_get(job);
+
+  if ( !wait && !h.job->group.finished() ) {
+    stop("the job is still running");
+  }
+
+  // espero en intervalos cortos para atender las interrupciones de R
+  while ( !h.job->group.wait_for(0.1) ) {
+    checkUserInterrupt();
+  }
+
+  return h.collect();
+}
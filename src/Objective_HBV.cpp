@@ -0,0 +1,240 @@
+#include <Rcpp.h>
+#include "aa_pipeline.h"
+#include "aa_cache.h"
+#include "aa_calibrate.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// FUNCIÓN OBJETIVO PARA CALIBRACIÓN
+// Corre el modelo agregado (nieve -> suelo -> reservorios -> HU) en un único
+// loop temporal y acumula la suma de errores cuadráticos. Si se da una cota
+// (bound) el loop se corta apenas la suma parcial la supera. Las evaluaciones
+// se guardan en un cache LRU y las salidas de nieve y suelo en caches por
+// etapa (ver Cache_HBV).
+
+// DATOS DE ENTRADA - inputData
+// #1# airT  : serie de temperatura [°C/deltaT]
+// #2# precip: serie de precipitación [mm/deltaT]
+// #3# PET   : evapotranspiración potencial [mm/deltaT]
+
+// CONDICIONES INICIALES - initCond
+// SWE0, SM0 y las condiciones iniciales del modelo de reservorios
+
+// PARÁMETROS - param
+// SFCF, Tt, Tm, fm, FC, LP, beta, parámetros de los reservorios, Bmax
+*/
+
+//' @name Objective_HBV
+//'
+//' @title Objective function for lumped model calibration
+//'
+//' @description Runs a lumped HBV model (\code{\link{SnowGlacier_HBV}} model 1 over soil,
+//' \code{\link{Soil_HBV}} model 1, \code{\link{Routing_HBV}} without lake and \code{\link{UH}}
+//' model 1) in a single native time loop and returns the sum of squared errors against the
+//' observed discharge. When a \code{bound} is given (e.g.: the best value found so far by
+//' the optimization algorithm) the time loop stops as soon as the partial sum exceeds it.
+//'
+//' @usage Objective_HBV(
+//'        routing,
+//'        inputData,
+//'        obs,
+//'        initCond,
+//'        param,
+//'        bound = Inf,
+//'        cache = TRUE
+//' )
+//'
+//' @param routing numeric integer with the \code{\link{Routing_HBV}} model (1 to 5).
+//'
+//' @param inputData handle returned by \code{\link{Forcing_HBV}} or a numeric matrix with the
+//' following columns:
+//' \itemize{
+//' \item \code{column_1}: air temperature series \eqn{[°C/\Delta t]}.
+//' \item \code{column_2}: precipitation series \eqn{[mm/\Delta t]}.
+//' \item \code{column_3}: potential evapotranspiration series \eqn{[mm/\Delta t]}.
+//' }
+//'
+//' @param obs numeric vector with the observed discharge \eqn{[mm/\Delta t]}. \code{NA_real_}
+//' values are skipped. It must be \code{NULL} when \code{inputData} is a
+//' \code{\link{Forcing_HBV}} handle (the handle carries it).
+//'
+//' @param initCond numeric vector with \code{SWE0}, \code{SM0} and the initial conditions of the
+//' selected \code{\link{Routing_HBV}} model (e.g.: \code{c(SWE0, SM0, SLZ0, SUZ0, STZ0)} for model 1).
+//'
+//' @param param numeric vector with the \code{\link{SnowGlacier_HBV}} parameters (\code{SFCF},
+//' \code{Tr}, \code{Tt}, \code{fm}), the \code{\link{Soil_HBV}} parameters (\code{FC}, \code{LP},
+//' \code{beta}), the \code{\link{Routing_HBV}} parameters and the \code{\link{UH}} \code{Bmax}.
+//'
+//' @param bound numeric value. The simulation is pruned when the partial sum of squared errors
+//' exceeds it.
+//'
+//' @param cache logical. When \code{TRUE} the result is looked up in (and stored into) a
+//' least recently used cache keyed by the exact parameter values, initial conditions and a
+//' fingerprint of \code{inputData} and \code{obs}. The snow and soil output series are also
+//' memoized per upstream parameter set, so a candidate that only changes the routing or
+//' \code{Bmax} parameters does not run those stages again. See \code{\link{Cache_HBV}}.
+//' A \code{\link{Forcing_HBV}} handle carries its fingerprint; with a matrix the fingerprint
+//' is computed on every call, which costs a pass over the series (the order of one model run),
+//' so pass a handle when the function is called many times on the same series.
+//'
+//' @return List with the following elements:
+//' \itemize{
+//'   \item \code{SSE}: sum of squared errors (partial when \code{pruned}).
+//'   \item \code{pruned}: \code{TRUE} when the time loop stopped because \code{SSE > bound}.
+//'   \item \code{steps}: number of time steps evaluated.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] )
+//' param   <- c(1.20, 1.00, 0.00, 2.5, 200, 0.8, 1.15, 0.9, 0.01, 0.001, 0.5, 0.01, 1.5)
+//'
+//' full   <- Objective_HBV(routing = 1, inputData = forcing, obs = lumped_hbv$`qout(mm/d)`,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param)
+//'
+//' ## the series fingerprinted once, for repeated calls
+//' handle <- Forcing_HBV(inputData = forcing, obs = lumped_hbv$`qout(mm/d)`)
+//' fast   <- Objective_HBV(routing = 1, inputData = handle, obs = NULL,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param)
+//'
+//' pruned <- Objective_HBV(routing = 1, inputData = forcing, obs = lumped_hbv$`qout(mm/d)`,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param,
+//'                         bound = full$SSE / 2)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+List Objective_HBV(int routing,
+                   SEXP inputData,
+                   Nullable<NumericVector> obs,
+                   NumericVector initCond,
+                   NumericVector param,
+                   double bound = R_PosInf,
+                   bool cache = true){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // forzantes: handle de Forcing_HBV (ya revisado y con su huella) o matriz
+  ForcingHandle handle;
+  NumericMatrix mat;
+  NumericVector ob;
+
+  if ( Rf_inherits(inputData, "HBV_forcing") ) {
+    if (obs.isNotNull()) {
+      stop("obs must be NULL when inputData is a Forcing_HBV handle");
+    }
+    XPtr<ForcingHandle> h(inputData);
+    if (h.get() == 0) {
+      stop("invalid forcing handle (was the session restored?)");
+    }
+    handle = *h;
+
+  } else {
+    if (obs.isNull()) {
+      stop("obs is required when inputData is a matrix");
+    }
+    mat = as<NumericMatrix>(inputData);
+    ob  = NumericVector(obs.get());
+
+    // check for NA_real_
+    // inputData
+    int chk_1 = sum( is_na(mat) );
+    if(chk_1 != 0){
+
+      stop("inputData argument should not contain NA values!");
+
+    }
+
+    if (mat.ncol() < 3) {
+      stop("Please verify the inputData matrix");
+    }
+    if (ob.size() != mat.nrow()) {
+      stop("obs must have the same length as inputData rows");
+    }
+  }
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if ( (routing < 1) || (routing > 5) ) {
+    stop("Routing model not available");
+  }
+  if (initCond.size() != pipeline_ninit(routing)) {
+    stop("Please verify the initCond vector");
+  }
+  if (param.size() != pipeline_nparam(routing)) {
+    stop("Please verify the param vector");
+  }
+
+  const char *msg = pipeline_check(routing, param.begin());
+  if (msg != 0) {
+    stop(msg);
+  }
+
+  // *********************
+  //  function
+  // *********************
+  Forcing f;
+  if (handle) {
+    f = handle->view();
+  } else {
+    int n = mat.nrow();
+
+    f.n      = n;
+    f.airT   = mat.begin();
+    f.precip = mat.begin() + n;
+    f.pet    = mat.begin() + 2 * n;
+    f.obs    = ob.begin();
+  }
+
+  Objective res;
+  if (cache) {
+    // la huella del handle se calculó una sola vez (Forcing_HBV)
+    uint64_t fp     = handle ? handle->fingerprint : forcing_fingerprint(f);
+    std::string key = eval_key(routing, fp,
+                               initCond.begin(), initCond.size(),
+                               param.begin(), param.size());
+
+    if ( !objective_cache().find(key, bound, res) ) {
+      pipeline_sse_memo(routing, f, fp, initCond.begin(), param.begin(), bound, res,
+                        snow_cache(), soil_cache());
+      objective_cache().insert(key, res);
+    }
+
+  } else {
+    pipeline_sse(routing, f, initCond.begin(), param.begin(), bound, res);
+  }
+
+  return List::create(Named("SSE")    = res.sse,
+                      Named("pruned") = res.pruned,
+                      Named("steps")  = res.steps);
+
+}
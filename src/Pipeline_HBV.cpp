@@ -0,0 +1,279 @@
+#include <Rcpp.h>
+#include "aa_pipeline.h"
+#include "aa_stream.h"
+#include "aa_stage.h"
+#include "aa_probe.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// MODELO AGREGADO EN UN ÚNICO LOOP
+// Corre el modelo agregado (nieve -> suelo -> reservorios -> HU) en un único
+// loop temporal y devuelve las series simuladas. Con 'aggregate' las salidas
+// se acumulan por período dentro del loop, de modo que nunca se reserva la
+// serie completa (p.ej.: totales diarios o mensuales de una corrida horaria).
+
+// DATOS DE ENTRADA - inputData
+// #1# airT  : serie de temperatura [°C/deltaT]
+// #2# precip: serie de precipitación [mm/deltaT]
+// #3# PET   : evapotranspiración potencial [mm/deltaT]
+
+// CONDICIONES INICIALES - initCond
+// SWE0, SM0 y las condiciones iniciales del modelo de reservorios
+
+// PARÁMETROS - param
+// SFCF, Tt, Tm, fm, FC, LP, beta, parámetros de los reservorios, Bmax
+*/
+
+//' @name Pipeline_HBV
+//'
+//' @title Lumped model in a single time loop
+//'
+//' @description Runs the lumped HBV model used by \code{\link{Objective_HBV}}
+//' (\code{\link{SnowGlacier_HBV}} model 1 over soil, \code{\link{Soil_HBV}} model 1,
+//' \code{\link{Routing_HBV}} without lake and \code{\link{UH}} model 1) in a single native
+//' time loop and returns the simulated series. With \code{aggregate} the outputs are
+//' accumulated per period inside the loop (e.g.: daily or monthly totals of an hourly run),
+//' so the whole series is never stored.
+//'
+//' @usage Pipeline_HBV(
+//'        routing,
+//'        inputData,
+//'        initCond,
+//'        param,
+//'        aggregate = NULL,
+//'        stride = 1,
+//'        columns = NULL,
+//'        pipelined = FALSE,
+//'        profile = FALSE,
+//'        audit = FALSE,
+//'        into = NULL
+//' )
+//'
+//' @param routing numeric integer with the \code{\link{Routing_HBV}} model (1 to 5).
+//'
+//' @param inputData numeric matrix with the following columns:
+//' \itemize{
+//' \item \code{column_1}: air temperature series \eqn{[°C/\Delta t]}.
+//' \item \code{column_2}: precipitation series \eqn{[mm/\Delta t]}.
+//' \item \code{column_3}: potential evapotranspiration series \eqn{[mm/\Delta t]}.
+//' }
+//'
+//' @param initCond numeric vector with \code{SWE0}, \code{SM0} and the initial conditions of the
+//' selected \code{\link{Routing_HBV}} model (e.g.: \code{c(SWE0, SM0, SLZ0, SUZ0, STZ0)} for model 1).
+//'
+//' @param param numeric vector with the \code{\link{SnowGlacier_HBV}} parameters (\code{SFCF},
+//' \code{Tr}, \code{Tt}, \code{fm}), the \code{\link{Soil_HBV}} parameters (\code{FC}, \code{LP},
+//' \code{beta}), the \code{\link{Routing_HBV}} parameters and the \code{\link{UH}} \code{Bmax}.
+//'
+//' @param aggregate optional numeric integer. Either the length of the aggregation period in
+//' time steps (e.g.: \code{24} for daily values of an hourly run) or a vector with the period
+//' number (\code{1, 2, ...}) of every time step (e.g.: the month index of a daily run).
+//'
+//' @param stride numeric integer. Only every \code{stride}-th time step (rows \code{1, 1 + stride, ...})
+//' is stored while the model still runs every time step (e.g.: state snapshots of long runs).
+//' It can not be combined with \code{aggregate}.
+//'
+//' @param columns optional character vector with the names of the output columns to keep (e.g.:
+//' \code{c('SWE', 'SM')}). The other columns are never stored.
+//'
+//' @param pipelined logical. When \code{TRUE} the snow, soil and routing stages run on three
+//' threads kept for the whole session (created on the first pipelined run) and the unit
+//' hydrograph on the calling one; consecutive chunks of the series are
+//' handed from one stage to the next, so the stages work at the same time on different chunks.
+//' A long run then takes about as long as its slowest stage (usually the soil). The results are
+//' the same as with \code{FALSE}. Short series (less than 8 chunks of 2048 time steps) always
+//' run in a single thread.
+//'
+//' @param profile logical. When \code{TRUE} the run also records, for the \code{snow},
+//' \code{soil}, \code{routing} and \code{uh} stages, the wall time (the \code{uh} stage includes
+//' storing the output), the time steps processed and how often the model branches: time steps with
+//' and without snowmelt (\code{melt}, \code{nomelt}), soil overflow (\code{overflow}, \eqn{Def >
+//' FC}), upper zone over \code{UZL} (\code{uzl}) and percolation at its \code{PERC} limit
+//' (\code{perc}). The stages then run one after the other over chunks of the series; the results
+//' are the same. It can not be combined with \code{pipelined} or \code{into}.
+//'
+//' @param audit logical. When \code{TRUE} the time loop also accumulates the mass balance of the
+//' snow (\code{SWE}) and soil (\code{SM}) storages and of every routing bucket (\code{SLZ},
+//' \code{SUZ} and \code{STZ}, those of the \code{routing} model), so the closure of a run can be
+//' checked while only aggregated (or no) output columns are stored. The water a bucket passes to
+//' the one below is an output of the first and an input of the second. The results are the same.
+//' It can not be combined with \code{pipelined}, \code{profile} or \code{into}.
+//'
+//' @param into optional numeric (double) matrix with the dimensions of the output (rows: time
+//' steps, or every \code{stride}-th one; columns: the kept ones). The output is written into it in
+//' place and the same matrix is returned (only its values: its attributes, e.g. the column names,
+//' are left untouched), so repeated runs (e.g.: calibration loops) reuse a single buffer,
+//' allocated once with \code{matrix(0, nrow, ncol)}. It can not be combined with \code{aggregate},
+//' \code{profile} or \code{audit}. \strong{Warning}: the matrix is modified in place, outside R's
+//' copy-on-modify semantics. It is not copied when other variables refer to it, so every variable
+//' assigned from it (e.g.: \code{kept <- out} after a previous run) and every list holding it see
+//' the new values too. Use a matrix created only for this purpose and keep earlier results with an
+//' explicit copy (e.g.: \code{kept <- out + 0}).
+//'
+//' @return Numeric matrix with the following columns: \code{SWE}, \code{SM}, \code{Rech},
+//' \code{Qg} and \code{Qsim}. When \code{aggregate} is given, a list with the \code{sum},
+//' \code{mean}, \code{min} and \code{max} matrices (one row per period and the same columns)
+//' and \code{n}, the number of time steps of every period. Periods without time steps are
+//' \code{NA}. With \code{profile = TRUE} the result carries a \code{"profile"} attribute: a
+//' data frame with one row per stage and the columns \code{stage}, \code{seconds},
+//' \code{steps}, \code{melt}, \code{nomelt}, \code{overflow}, \code{uzl} and \code{perc}.
+//' With \code{audit = TRUE} it carries a \code{"balance"} attribute: a data frame with one row
+//' per storage (\code{store}) and its \code{input}, \code{output}, \code{initial} and
+//' \code{final} storage and the closure \code{error} (input - output - storage change)
+//' \eqn{[mm]}. The soil error is not zero when the soil moisture runs dry (\code{Eac} is then
+//' limited to \code{SM} as in \code{\link{Soil_HBV}} while the recharge is kept).
+//'
+//' With \code{into} the output is that matrix (the column names are set on the first call).
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' data("lumped_hbv")
+//'
+//' forcing <- as.matrix( lumped_hbv[ , c('T(ºC)', 'P(mm/d)', 'PET(mm/d)')] )
+//' param   <- c(1.20, 1.00, 0.00, 2.5, 200, 0.8, 1.15, 0.9, 0.01, 0.001, 0.5, 0.01, 1.5)
+//'
+//' daily   <- Pipeline_HBV(routing = 1, inputData = forcing,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param)
+//'
+//' ## monthly totals and means
+//' month   <- substr(as.character(lumped_hbv$Date), 1, 7)
+//' monthly <- Pipeline_HBV(routing = 1, inputData = forcing,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param,
+//'                         aggregate = match(month, unique(month)))
+//'
+//' ## SWE and SM snapshots every 30 days
+//' snap    <- Pipeline_HBV(routing = 1, inputData = forcing,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param,
+//'                         stride = 30, columns = c('SWE', 'SM'))
+//'
+//' ## where the time goes
+//' prof    <- attr(Pipeline_HBV(routing = 1, inputData = forcing,
+//'                              initCond = c(20, 100, 0, 0, 0), param = param,
+//'                              profile = TRUE), "profile")
+//'
+//' ## water balance closure of a run that only keeps the yearly discharge
+//' yearly  <- Pipeline_HBV(routing = 1, inputData = forcing,
+//'                         initCond = c(20, 100, 0, 0, 0), param = param,
+//'                         aggregate = 365, columns = 'Qsim', audit = TRUE)
+//' attr(yearly, "balance")
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Pipeline_HBV(int routing,
+                  NumericMatrix inputData,
+                  NumericVector initCond,
+                  NumericVector param,
+                  Nullable<IntegerVector> aggregate = R_NilValue,
+                  int stride = 1,
+                  Nullable<CharacterVector> columns = R_NilValue,
+                  bool pipelined = false,
+                  bool profile = false,
+                  bool audit = false,
+                  SEXP into = R_NilValue){
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // initCond
+  int chk_2 = sum( is_na(initCond) );
+  if(chk_2 != 0){
+
+    stop("initCond argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  if ( (routing < 1) || (routing > 5) ) {
+    stop("Routing model not available");
+  }
+  if (inputData.ncol() < 3) {
+    stop("Please verify the inputData matrix");
+  }
+  if (initCond.size() != pipeline_ninit(routing)) {
+    stop("Please verify the initCond vector");
+  }
+  if (param.size() != pipeline_nparam(routing)) {
+    stop("Please verify the param vector");
+  }
+
+  const char *msg = pipeline_check(routing, param.begin());
+  if (msg != 0) {
+    stop(msg);
+  }
+
+  if ( (pipelined + profile + audit) > 1 ) {
+    stop("pipelined, profile and audit options can not be combined");
+  }
+  // los atributos van en el resultado: no se tocan los de una matriz ajena
+  if ( (profile || audit) && (into != R_NilValue) ) {
+    stop("into option can not be combined with profile or audit");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  int n = inputData.nrow();
+
+  Forcing f;
+  f.n      = n;
+  f.airT   = inputData.begin();
+  f.precip = inputData.begin() + n;
+  f.pet    = inputData.begin() + 2 * n;
+  f.obs    = 0;
+
+  OutputSpec spec = output_spec(aggregate, stride, columns, n, into);
+  StageOutput out(n, 5, spec,
+                  {"SWE", "SM", "Rech", "Qg", "Qsim"});
+  if (pipelined) {
+    // una etapa por hilo sobre tramos consecutivos de la serie
+    pipeline_stream(routing, f, initCond.begin(), param.begin(), out);
+  } else if (profile) {
+    std::vector<StageProfile> prof;
+    pipeline_profile(routing, f, initCond.begin(), param.begin(), out, prof);
+
+    RObject res = out.result();
+    res.attr("profile") = profile_frame(prof, "stage");
+    return res;
+  } else if (audit) {
+    std::vector<StoreBalance> bal;
+    pipeline_audit(routing, f, initCond.begin(), param.begin(), out, bal);
+
+    RObject res = out.result();
+    res.attr("balance") = balance_frame(bal);
+    return res;
+  } else {
+    pipeline_run(routing, f, initCond.begin(), param.begin(), out);
+  }
+
+  return out.result();
+
+}
@@ -1,4 +1,5 @@
 #include <Rcpp.h>
+#include "aa_bands.h"
 using namespace Rcpp;
 
 // **********************************************************
@@ -206,3 +207,113 @@ NumericVector Precip_model(int model,
   }
 
 }
+
+//' @name PrecipBands_model
+//'
+//' @title Precipitation models over many elevation bands
+//'
+//' @description Same as \code{\link{Precip_model}} but for a vector of target heights. All
+//' the bands are computed in a single pass over the gauge record and returned as a matrix
+//' whose columns are contiguous band series (the layout read by the snow routines).
+//'
+//' @usage PrecipBands_model(
+//'        model,
+//'        inputData,
+//'        zmeteo,
+//'        ztopo,
+//'        param
+//' )
+//'
+//' @param model numeric value with model option (see \code{\link{Precip_model}}).
+//'
+//' @param inputData numeric vector with precipitation gauge series \eqn{[mm/\Delta t]}.
+//'
+//' @param zmeteo numeric value indicating the altitude of the precipitation gauge \eqn{[masl]}.
+//'
+//' @param ztopo numeric vector with the target heights \eqn{[masl]}.
+//'
+//' @param param numeric vector with the precipitation gradient (\code{gradP}) [\%/100m] and,
+//' for model 2, the threshold height (\code{maxALT}) \eqn{[masl]}: a single value or one per
+//' band.
+//'
+//' @return Numeric matrix (time steps x bands) with the extrapolated precipitation series.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' ## linear precipitation gradient
+//' precip <- PrecipBands_model(
+//'                             model = 1,
+//'                             inputData = runif(200, max = 50, min = 0),
+//'                             zmeteo = 2000, ztopo = c(2500, 3500, 4500),
+//'                             param = c(0.05)
+//'                             )
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix PrecipBands_model(int model,
+                                NumericVector inputData,
+                                double zmeteo,
+                                NumericVector ztopo,
+                                NumericVector param) {
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // ztopo
+  int chk_2 = sum( is_na(ztopo) );
+  if(chk_2 != 0){
+
+    stop("ztopo argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  int n     = inputData.size();
+  int nband = ztopo.size();
+
+  if (model != 1 && model != 2) {
+    stop("Model not available");
+  }
+  if (param.size() < 1 ||
+      (model == 2 && param.size() != 2 && param.size() != nband + 1) ) {
+    stop("Please verify the parameter vector");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  std::vector<double> maxALT;
+  if (model == 2) {
+    if (param.size() == 2) {
+      maxALT.assign(nband, param[1]);
+    } else {
+      maxALT.assign(param.begin() + 1, param.end());
+    }
+  }
+
+  NumericMatrix out(n, nband);
+  precip_bands(model, inputData.begin(), n, zmeteo, ztopo.begin(),
+               maxALT.empty() ? 0 : maxALT.data(), nband, param[0], out.begin());
+
+  return out;
+
+}
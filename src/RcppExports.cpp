@@ -10,6 +10,161 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// Allocations_HBV
+NumericVector Allocations_HBV(bool reset);
+RcppExport SEXP _HBV_IANIGLA_Allocations_HBV(SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(Allocations_HBV(reset));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Arrow_HBV
+void Arrow_HBV(SEXP results, SEXP array, SEXP schema);
+RcppExport SEXP _HBV_IANIGLA_Arrow_HBV(SEXP resultsSEXP, SEXP arraySEXP, SEXP schemaSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type results(resultsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type array(arraySEXP);
+    Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP);
+    Arrow_HBV(results, array, schema);
+    return R_NilValue;
+END_RCPP
+}
+// Bands_HBV
+SEXP Bands_HBV(NumericMatrix inputData, NumericVector zmeteo, NumericVector ztopo, int tmodel, NumericVector tparam, int pmodel, NumericVector pparam, std::string dir);
+RcppExport SEXP _HBV_IANIGLA_Bands_HBV(SEXP inputDataSEXP, SEXP zmeteoSEXP, SEXP ztopoSEXP, SEXP tmodelSEXP, SEXP tparamSEXP, SEXP pmodelSEXP, SEXP pparamSEXP, SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type zmeteo(zmeteoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type ztopo(ztopoSEXP);
+    Rcpp::traits::input_parameter< int >::type tmodel(tmodelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type tparam(tparamSEXP);
+    Rcpp::traits::input_parameter< int >::type pmodel(pmodelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type pparam(pparamSEXP);
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    rcpp_result_gen = Rcpp::wrap(Bands_HBV(inputData, zmeteo, ztopo, tmodel, tparam, pmodel, pparam, dir));
+    return rcpp_result_gen;
+END_RCPP
+}
+// SnowBands_HBV
+List SnowBands_HBV(SEXP bands, NumericVector initCond, NumericVector param, bool profile);
+RcppExport SEXP _HBV_IANIGLA_SnowBands_HBV(SEXP bandsSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP profileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type bands(bandsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< bool >::type profile(profileSEXP);
+    rcpp_result_gen = Rcpp::wrap(SnowBands_HBV(bands, initCond, param, profile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Ensemble_HBV
+SEXP Ensemble_HBV(SEXP bands, IntegerVector surface, NumericVector area, NumericVector initCond, NumericMatrix param, bool async);
+RcppExport SEXP _HBV_IANIGLA_Ensemble_HBV(SEXP bandsSEXP, SEXP surfaceSEXP, SEXP areaSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP asyncSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type bands(bandsSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type surface(surfaceSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type area(areaSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< bool >::type async(asyncSEXP);
+    rcpp_result_gen = Rcpp::wrap(Ensemble_HBV(bands, surface, area, initCond, param, async));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Cache_HBV
+NumericMatrix Cache_HBV(int capacity, int stages, bool clear, int bands);
+RcppExport SEXP _HBV_IANIGLA_Cache_HBV(SEXP capacitySEXP, SEXP stagesSEXP, SEXP clearSEXP, SEXP bandsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type capacity(capacitySEXP);
+    Rcpp::traits::input_parameter< int >::type stages(stagesSEXP);
+    Rcpp::traits::input_parameter< bool >::type clear(clearSEXP);
+    Rcpp::traits::input_parameter< int >::type bands(bandsSEXP);
+    rcpp_result_gen = Rcpp::wrap(Cache_HBV(capacity, stages, clear, bands));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Calibrate_HBV
+SEXP Calibrate_HBV(List basins, std::string file, int threads, bool async);
+RcppExport SEXP _HBV_IANIGLA_Calibrate_HBV(SEXP basinsSEXP, SEXP fileSEXP, SEXP threadsSEXP, SEXP asyncSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type basins(basinsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type async(asyncSEXP);
+    rcpp_result_gen = Rcpp::wrap(Calibrate_HBV(basins, file, threads, async));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Cluster_HBV
+SEXP Cluster_HBV(int workers, bool spawn, int port, std::string host, double timeout);
+RcppExport SEXP _HBV_IANIGLA_Cluster_HBV(SEXP workersSEXP, SEXP spawnSEXP, SEXP portSEXP, SEXP hostSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type workers(workersSEXP);
+    Rcpp::traits::input_parameter< bool >::type spawn(spawnSEXP);
+    Rcpp::traits::input_parameter< int >::type port(portSEXP);
+    Rcpp::traits::input_parameter< std::string >::type host(hostSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(Cluster_HBV(workers, spawn, port, host, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Distribute_HBV
+NumericVector Distribute_HBV(SEXP cluster, SEXP forcing, int routing, NumericVector initCond, NumericMatrix param, int chunk, double timeout);
+RcppExport SEXP _HBV_IANIGLA_Distribute_HBV(SEXP clusterSEXP, SEXP forcingSEXP, SEXP routingSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP chunkSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type cluster(clusterSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type forcing(forcingSEXP);
+    Rcpp::traits::input_parameter< int >::type routing(routingSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk(chunkSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(Distribute_HBV(cluster, forcing, routing, initCond, param, chunk, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Worker_HBV
+double Worker_HBV(int port, std::string host, double timeout);
+RcppExport SEXP _HBV_IANIGLA_Worker_HBV(SEXP portSEXP, SEXP hostSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type port(portSEXP);
+    Rcpp::traits::input_parameter< std::string >::type host(hostSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(Worker_HBV(port, host, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ClusterStop_HBV
+int ClusterStop_HBV(SEXP cluster);
+RcppExport SEXP _HBV_IANIGLA_ClusterStop_HBV(SEXP clusterSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type cluster(clusterSEXP);
+    rcpp_result_gen = Rcpp::wrap(ClusterStop_HBV(cluster));
+    return rcpp_result_gen;
+END_RCPP
+}
 // PET
 NumericVector PET(int model, int hemis, NumericMatrix inputData, NumericVector elev, NumericVector param);
 RcppExport SEXP _HBV_IANIGLA_PET(SEXP modelSEXP, SEXP hemisSEXP, SEXP inputDataSEXP, SEXP elevSEXP, SEXP paramSEXP) {
@@ -25,9 +180,36 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// PETBands
+NumericMatrix PETBands(int model, int hemis, NumericMatrix inputData, NumericVector elev, NumericVector param);
+RcppExport SEXP _HBV_IANIGLA_PETBands(SEXP modelSEXP, SEXP hemisSEXP, SEXP inputDataSEXP, SEXP elevSEXP, SEXP paramSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< int >::type hemis(hemisSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type elev(elevSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    rcpp_result_gen = Rcpp::wrap(PETBands(model, hemis, inputData, elev, param));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Forcing_HBV
+SEXP Forcing_HBV(NumericMatrix inputData, NumericVector obs);
+RcppExport SEXP _HBV_IANIGLA_Forcing_HBV(SEXP inputDataSEXP, SEXP obsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type obs(obsSEXP);
+    rcpp_result_gen = Rcpp::wrap(Forcing_HBV(inputData, obs));
+    return rcpp_result_gen;
+END_RCPP
+}
 // Glacier_Disch
-NumericMatrix Glacier_Disch(int model, NumericMatrix inputData, double initCond, NumericVector param);
-RcppExport SEXP _HBV_IANIGLA_Glacier_Disch(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
+SEXP Glacier_Disch(int model, NumericMatrix inputData, double initCond, NumericVector param, bool lazy, Nullable<IntegerVector> aggregate, int stride, Nullable<CharacterVector> columns, bool audit, SEXP into);
+RcppExport SEXP _HBV_IANIGLA_Glacier_Disch(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP lazySEXP, SEXP aggregateSEXP, SEXP strideSEXP, SEXP columnsSEXP, SEXP auditSEXP, SEXP intoSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -35,7 +217,114 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
     Rcpp::traits::input_parameter< double >::type initCond(initCondSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
-    rcpp_result_gen = Rcpp::wrap(Glacier_Disch(model, inputData, initCond, param));
+    Rcpp::traits::input_parameter< bool >::type lazy(lazySEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< int >::type stride(strideSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type audit(auditSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type into(intoSEXP);
+    rcpp_result_gen = Rcpp::wrap(Glacier_Disch(model, inputData, initCond, param, lazy, aggregate, stride, columns, audit, into));
+    return rcpp_result_gen;
+END_RCPP
+}
+// GlacierBatch_HBV
+NumericMatrix GlacierBatch_HBV(NumericMatrix inputData, NumericVector initCond, NumericMatrix param);
+RcppExport SEXP _HBV_IANIGLA_GlacierBatch_HBV(SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type param(paramSEXP);
+    rcpp_result_gen = Rcpp::wrap(GlacierBatch_HBV(inputData, initCond, param));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Gradient_HBV
+List Gradient_HBV(int routing, NumericMatrix inputData, NumericVector obs, NumericVector initCond, NumericVector param, double sharpness);
+RcppExport SEXP _HBV_IANIGLA_Gradient_HBV(SEXP routingSEXP, SEXP inputDataSEXP, SEXP obsSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP sharpnessSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type routing(routingSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type obs(obsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< double >::type sharpness(sharpnessSEXP);
+    rcpp_result_gen = Rcpp::wrap(Gradient_HBV(routing, inputData, obs, initCond, param, sharpness));
+    return rcpp_result_gen;
+END_RCPP
+}
+// JobStatus_HBV
+List JobStatus_HBV(SEXP job);
+RcppExport SEXP _HBV_IANIGLA_JobStatus_HBV(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(JobStatus_HBV(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// JobCancel_HBV
+LogicalVector JobCancel_HBV(SEXP job);
+RcppExport SEXP _HBV_IANIGLA_JobCancel_HBV(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(JobCancel_HBV(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// JobCollect_HBV
+SEXP JobCollect_HBV(SEXP job, bool wait);
+RcppExport SEXP _HBV_IANIGLA_JobCollect_HBV(SEXP jobSEXP, SEXP waitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    Rcpp::traits::input_parameter< bool >::type wait(waitSEXP);
+    rcpp_result_gen = Rcpp::wrap(JobCollect_HBV(job, wait));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Objective_HBV
+List Objective_HBV(int routing, SEXP inputData, Nullable<NumericVector> obs, NumericVector initCond, NumericVector param, double bound, bool cache);
+RcppExport SEXP _HBV_IANIGLA_Objective_HBV(SEXP routingSEXP, SEXP inputDataSEXP, SEXP obsSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP boundSEXP, SEXP cacheSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type routing(routingSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericVector> >::type obs(obsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< double >::type bound(boundSEXP);
+    Rcpp::traits::input_parameter< bool >::type cache(cacheSEXP);
+    rcpp_result_gen = Rcpp::wrap(Objective_HBV(routing, inputData, obs, initCond, param, bound, cache));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Pipeline_HBV
+SEXP Pipeline_HBV(int routing, NumericMatrix inputData, NumericVector initCond, NumericVector param, Nullable<IntegerVector> aggregate, int stride, Nullable<CharacterVector> columns, bool pipelined, bool profile, bool audit, SEXP into);
+RcppExport SEXP _HBV_IANIGLA_Pipeline_HBV(SEXP routingSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP aggregateSEXP, SEXP strideSEXP, SEXP columnsSEXP, SEXP pipelinedSEXP, SEXP profileSEXP, SEXP auditSEXP, SEXP intoSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type routing(routingSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< int >::type stride(strideSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type pipelined(pipelinedSEXP);
+    Rcpp::traits::input_parameter< bool >::type profile(profileSEXP);
+    Rcpp::traits::input_parameter< bool >::type audit(auditSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type into(intoSEXP);
+    rcpp_result_gen = Rcpp::wrap(Pipeline_HBV(routing, inputData, initCond, param, aggregate, stride, columns, pipelined, profile, audit, into));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -54,9 +343,49 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// PrecipBands_model
+NumericMatrix PrecipBands_model(int model, NumericVector inputData, double zmeteo, NumericVector ztopo, NumericVector param);
+RcppExport SEXP _HBV_IANIGLA_PrecipBands_model(SEXP modelSEXP, SEXP inputDataSEXP, SEXP zmeteoSEXP, SEXP ztopoSEXP, SEXP paramSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< double >::type zmeteo(zmeteoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type ztopo(ztopoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    rcpp_result_gen = Rcpp::wrap(PrecipBands_model(model, inputData, zmeteo, ztopo, param));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Open_HBV
+SEXP Open_HBV(std::string file);
+RcppExport SEXP _HBV_IANIGLA_Open_HBV(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(Open_HBV(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Read_HBV
+NumericMatrix Read_HBV(SEXP archive, std::string variable, Nullable<IntegerVector> members, Nullable<IntegerVector> steps);
+RcppExport SEXP _HBV_IANIGLA_Read_HBV(SEXP archiveSEXP, SEXP variableSEXP, SEXP membersSEXP, SEXP stepsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type archive(archiveSEXP);
+    Rcpp::traits::input_parameter< std::string >::type variable(variableSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type members(membersSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type steps(stepsSEXP);
+    rcpp_result_gen = Rcpp::wrap(Read_HBV(archive, variable, members, steps));
+    return rcpp_result_gen;
+END_RCPP
+}
 // Routing_HBV
-NumericMatrix Routing_HBV(int model, bool lake, NumericMatrix inputData, NumericVector initCond, NumericVector param);
-RcppExport SEXP _HBV_IANIGLA_Routing_HBV(SEXP modelSEXP, SEXP lakeSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
+SEXP Routing_HBV(int model, bool lake, NumericMatrix inputData, NumericVector initCond, NumericVector param, bool lazy, Nullable<IntegerVector> aggregate, int stride, Nullable<CharacterVector> columns, bool parallel, SEXP into);
+RcppExport SEXP _HBV_IANIGLA_Routing_HBV(SEXP modelSEXP, SEXP lakeSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP lazySEXP, SEXP aggregateSEXP, SEXP strideSEXP, SEXP columnsSEXP, SEXP parallelSEXP, SEXP intoSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -65,13 +394,19 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
-    rcpp_result_gen = Rcpp::wrap(Routing_HBV(model, lake, inputData, initCond, param));
+    Rcpp::traits::input_parameter< bool >::type lazy(lazySEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< int >::type stride(strideSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type parallel(parallelSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type into(intoSEXP);
+    rcpp_result_gen = Rcpp::wrap(Routing_HBV(model, lake, inputData, initCond, param, lazy, aggregate, stride, columns, parallel, into));
     return rcpp_result_gen;
 END_RCPP
 }
 // SnowGlacier_HBV
-NumericMatrix SnowGlacier_HBV(int model, NumericMatrix inputData, NumericVector initCond, NumericVector param);
-RcppExport SEXP _HBV_IANIGLA_SnowGlacier_HBV(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
+SEXP SnowGlacier_HBV(int model, NumericMatrix inputData, NumericVector initCond, NumericVector param, bool lazy, Nullable<IntegerVector> aggregate, int stride, Nullable<CharacterVector> columns, SEXP into);
+RcppExport SEXP _HBV_IANIGLA_SnowGlacier_HBV(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP lazySEXP, SEXP aggregateSEXP, SEXP strideSEXP, SEXP columnsSEXP, SEXP intoSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -79,13 +414,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
-    rcpp_result_gen = Rcpp::wrap(SnowGlacier_HBV(model, inputData, initCond, param));
+    Rcpp::traits::input_parameter< bool >::type lazy(lazySEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< int >::type stride(strideSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type into(intoSEXP);
+    rcpp_result_gen = Rcpp::wrap(SnowGlacier_HBV(model, inputData, initCond, param, lazy, aggregate, stride, columns, into));
     return rcpp_result_gen;
 END_RCPP
 }
 // Soil_HBV
-NumericVector Soil_HBV(int model, NumericMatrix inputData, NumericVector initCond, NumericVector param);
-RcppExport SEXP _HBV_IANIGLA_Soil_HBV(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
+SEXP Soil_HBV(int model, NumericMatrix inputData, NumericVector initCond, NumericVector param, bool lazy, Nullable<IntegerVector> aggregate, int stride, Nullable<CharacterVector> columns, SEXP into);
+RcppExport SEXP _HBV_IANIGLA_Soil_HBV(SEXP modelSEXP, SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP, SEXP lazySEXP, SEXP aggregateSEXP, SEXP strideSEXP, SEXP columnsSEXP, SEXP intoSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -93,7 +433,12 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type inputData(inputDataSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type initCond(initCondSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
-    rcpp_result_gen = Rcpp::wrap(Soil_HBV(model, inputData, initCond, param));
+    Rcpp::traits::input_parameter< bool >::type lazy(lazySEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type aggregate(aggregateSEXP);
+    Rcpp::traits::input_parameter< int >::type stride(strideSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type into(intoSEXP);
+    rcpp_result_gen = Rcpp::wrap(Soil_HBV(model, inputData, initCond, param, lazy, aggregate, stride, columns, into));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -112,6 +457,33 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// TempBands_model
+NumericMatrix TempBands_model(int model, NumericVector inputData, double zmeteo, NumericVector ztopo, NumericVector param);
+RcppExport SEXP _HBV_IANIGLA_TempBands_model(SEXP modelSEXP, SEXP inputDataSEXP, SEXP zmeteoSEXP, SEXP ztopoSEXP, SEXP paramSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type inputData(inputDataSEXP);
+    Rcpp::traits::input_parameter< double >::type zmeteo(zmeteoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type ztopo(ztopoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type param(paramSEXP);
+    rcpp_result_gen = Rcpp::wrap(TempBands_model(model, inputData, zmeteo, ztopo, param));
+    return rcpp_result_gen;
+END_RCPP
+}
+// Threads_HBV
+IntegerVector Threads_HBV(int threads, Nullable<LogicalVector> pin);
+RcppExport SEXP _HBV_IANIGLA_Threads_HBV(SEXP threadsSEXP, SEXP pinSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< Nullable<LogicalVector> >::type pin(pinSEXP);
+    rcpp_result_gen = Rcpp::wrap(Threads_HBV(threads, pin));
+    return rcpp_result_gen;
+END_RCPP
+}
 // UH
 NumericVector UH(int model, NumericVector Qg, NumericVector param);
 RcppExport SEXP _HBV_IANIGLA_UH(SEXP modelSEXP, SEXP QgSEXP, SEXP paramSEXP) {
@@ -125,6 +497,20 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// Write_HBV
+double Write_HBV(std::string file, List results, IntegerVector chunk, bool compress);
+RcppExport SEXP _HBV_IANIGLA_Write_HBV(SEXP fileSEXP, SEXP resultsSEXP, SEXP chunkSEXP, SEXP compressSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type results(resultsSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type chunk(chunkSEXP);
+    Rcpp::traits::input_parameter< bool >::type compress(compressSEXP);
+    rcpp_result_gen = Rcpp::wrap(Write_HBV(file, results, chunk, compress));
+    return rcpp_result_gen;
+END_RCPP
+}
 // icemelt_clean
 NumericMatrix icemelt_clean(NumericMatrix inputData, NumericVector initCond, NumericVector param);
 RcppExport SEXP _HBV_IANIGLA_icemelt_clean(SEXP inputDataSEXP, SEXP initCondSEXP, SEXP paramSEXP) {
@@ -283,15 +669,43 @@ BEGIN_RCPP
 END_RCPP
 }
 
+void init_altrep(DllInfo* dll);
+
 static const R_CallMethodDef CallEntries[] = {
+    {"_HBV_IANIGLA_Allocations_HBV", (DL_FUNC) &_HBV_IANIGLA_Allocations_HBV, 1},
+    {"_HBV_IANIGLA_Arrow_HBV", (DL_FUNC) &_HBV_IANIGLA_Arrow_HBV, 3},
+    {"_HBV_IANIGLA_Bands_HBV", (DL_FUNC) &_HBV_IANIGLA_Bands_HBV, 8},
+    {"_HBV_IANIGLA_SnowBands_HBV", (DL_FUNC) &_HBV_IANIGLA_SnowBands_HBV, 4},
+    {"_HBV_IANIGLA_Ensemble_HBV", (DL_FUNC) &_HBV_IANIGLA_Ensemble_HBV, 6},
+    {"_HBV_IANIGLA_Cache_HBV", (DL_FUNC) &_HBV_IANIGLA_Cache_HBV, 4},
+    {"_HBV_IANIGLA_Calibrate_HBV", (DL_FUNC) &_HBV_IANIGLA_Calibrate_HBV, 4},
+    {"_HBV_IANIGLA_Cluster_HBV", (DL_FUNC) &_HBV_IANIGLA_Cluster_HBV, 5},
+    {"_HBV_IANIGLA_Distribute_HBV", (DL_FUNC) &_HBV_IANIGLA_Distribute_HBV, 7},
+    {"_HBV_IANIGLA_Worker_HBV", (DL_FUNC) &_HBV_IANIGLA_Worker_HBV, 3},
+    {"_HBV_IANIGLA_ClusterStop_HBV", (DL_FUNC) &_HBV_IANIGLA_ClusterStop_HBV, 1},
     {"_HBV_IANIGLA_PET", (DL_FUNC) &_HBV_IANIGLA_PET, 5},
-    {"_HBV_IANIGLA_Glacier_Disch", (DL_FUNC) &_HBV_IANIGLA_Glacier_Disch, 4},
+    {"_HBV_IANIGLA_PETBands", (DL_FUNC) &_HBV_IANIGLA_PETBands, 5},
+    {"_HBV_IANIGLA_Forcing_HBV", (DL_FUNC) &_HBV_IANIGLA_Forcing_HBV, 2},
+    {"_HBV_IANIGLA_Glacier_Disch", (DL_FUNC) &_HBV_IANIGLA_Glacier_Disch, 10},
+    {"_HBV_IANIGLA_GlacierBatch_HBV", (DL_FUNC) &_HBV_IANIGLA_GlacierBatch_HBV, 3},
+    {"_HBV_IANIGLA_Gradient_HBV", (DL_FUNC) &_HBV_IANIGLA_Gradient_HBV, 6},
+    {"_HBV_IANIGLA_JobStatus_HBV", (DL_FUNC) &_HBV_IANIGLA_JobStatus_HBV, 1},
+    {"_HBV_IANIGLA_JobCancel_HBV", (DL_FUNC) &_HBV_IANIGLA_JobCancel_HBV, 1},
+    {"_HBV_IANIGLA_JobCollect_HBV", (DL_FUNC) &_HBV_IANIGLA_JobCollect_HBV, 2},
+    {"_HBV_IANIGLA_Objective_HBV", (DL_FUNC) &_HBV_IANIGLA_Objective_HBV, 7},
+    {"_HBV_IANIGLA_Pipeline_HBV", (DL_FUNC) &_HBV_IANIGLA_Pipeline_HBV, 11},
     {"_HBV_IANIGLA_Precip_model", (DL_FUNC) &_HBV_IANIGLA_Precip_model, 5},
-    {"_HBV_IANIGLA_Routing_HBV", (DL_FUNC) &_HBV_IANIGLA_Routing_HBV, 5},
-    {"_HBV_IANIGLA_SnowGlacier_HBV", (DL_FUNC) &_HBV_IANIGLA_SnowGlacier_HBV, 4},
-    {"_HBV_IANIGLA_Soil_HBV", (DL_FUNC) &_HBV_IANIGLA_Soil_HBV, 4},
+    {"_HBV_IANIGLA_PrecipBands_model", (DL_FUNC) &_HBV_IANIGLA_PrecipBands_model, 5},
+    {"_HBV_IANIGLA_Open_HBV", (DL_FUNC) &_HBV_IANIGLA_Open_HBV, 1},
+    {"_HBV_IANIGLA_Read_HBV", (DL_FUNC) &_HBV_IANIGLA_Read_HBV, 4},
+    {"_HBV_IANIGLA_Routing_HBV", (DL_FUNC) &_HBV_IANIGLA_Routing_HBV, 11},
+    {"_HBV_IANIGLA_SnowGlacier_HBV", (DL_FUNC) &_HBV_IANIGLA_SnowGlacier_HBV, 9},
+    {"_HBV_IANIGLA_Soil_HBV", (DL_FUNC) &_HBV_IANIGLA_Soil_HBV, 9},
     {"_HBV_IANIGLA_Temp_model", (DL_FUNC) &_HBV_IANIGLA_Temp_model, 5},
+    {"_HBV_IANIGLA_TempBands_model", (DL_FUNC) &_HBV_IANIGLA_TempBands_model, 5},
+    {"_HBV_IANIGLA_Threads_HBV", (DL_FUNC) &_HBV_IANIGLA_Threads_HBV, 2},
     {"_HBV_IANIGLA_UH", (DL_FUNC) &_HBV_IANIGLA_UH, 3},
+    {"_HBV_IANIGLA_Write_HBV", (DL_FUNC) &_HBV_IANIGLA_Write_HBV, 4},
     {"_HBV_IANIGLA_icemelt_clean", (DL_FUNC) &_HBV_IANIGLA_icemelt_clean, 3},
     {"_HBV_IANIGLA_icemelt_clean_gca", (DL_FUNC) &_HBV_IANIGLA_icemelt_clean_gca, 3},
     {"_HBV_IANIGLA_icemelt_debris", (DL_FUNC) &_HBV_IANIGLA_icemelt_debris, 3},
@@ -310,4 +724,5 @@ static const R_CallMethodDef CallEntries[] = {
 RcppExport void R_init_HBV_IANIGLA(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_altrep(dll);
 }
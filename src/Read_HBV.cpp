@@ -0,0 +1,154 @@
+#include <Rcpp.h>
+#include "aa_archive.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// LECTURA DEL ARCHIVO DE RESULTADOS
+// El archivo se mapea en memoria (Open_HBV) y cada consulta descomprime sólo
+// los bloques que cubren los miembros y pasos de tiempo pedidos.
+*/
+
+//' @name Open_HBV
+//'
+//' @title Open a chunked result archive
+//'
+//' @description Maps an archive written by \code{\link{Write_HBV}} in memory. Nothing is
+//' read until \code{\link{Read_HBV}} asks for a slice.
+//'
+//' @usage Open_HBV(
+//'        file
+//' )
+//'
+//' @param file string with the path of the archive.
+//'
+//' @return External pointer of class \code{HBV_archive} with the \code{variables} and
+//' \code{size} (time steps, members) attributes.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' file <- tempfile(fileext = ".hbv")
+//' Write_HBV(file = file, results = list(Qg = matrix(runif(730 * 4), ncol = 4)))
+//'
+//' archive <- Open_HBV(file)
+//' attr(archive, "size")
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+SEXP Open_HBV(std::string file){
+  XPtr<ArchiveReader> out(new ArchiveReader(file), true);
+
+  const ArchiveHeader &hdr = out->header();
+  out.attr("class")     = "HBV_archive";
+  out.attr("variables") = wrap(hdr.names);
+  out.attr("size")      = NumericVector::create(hdr.ntime, hdr.nmember);
+
+  return out;
+}
+
+//' @name Read_HBV
+//'
+//' @title Read a slice of a chunked result archive
+//'
+//' @description Returns some members and time steps of a variable stored with
+//' \code{\link{Write_HBV}}. Only the blocks that overlap the slice are decoded.
+//'
+//' @usage Read_HBV(
+//'        archive,
+//'        variable,
+//'        members = NULL,
+//'        steps = NULL
+//' )
+//'
+//' @param archive handle from \code{\link{Open_HBV}}.
+//'
+//' @param variable string with the variable name (see \code{attr(archive, "variables")}).
+//'
+//' @param members numeric integer vector with the members (columns) to read. \code{NULL}
+//' reads all of them.
+//'
+//' @param steps numeric integer vector with the time steps (rows) to read. \code{NULL}
+//' reads all of them.
+//'
+//' @return Numeric matrix (steps x members).
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' file <- tempfile(fileext = ".hbv")
+//' Write_HBV(file = file, results = list(Qg = matrix(runif(730 * 4), ncol = 4)))
+//'
+//' archive <- Open_HBV(file)
+//' Read_HBV(archive = archive, variable = "Qg", members = 3, steps = 366:730)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix Read_HBV(SEXP archive,
+                       std::string variable,
+                       Nullable<IntegerVector> members = R_NilValue,
+                       Nullable<IntegerVector> steps = R_NilValue){
+  // *********************
+  //  conditionals
+  // *********************
+  if ( !Rf_inherits(archive, "HBV_archive") ) {
+    stop("archive must be an Open_HBV handle");
+  }
+  XPtr<ArchiveReader> reader(archive);
+  if (reader.get() == 0) {
+    stop("invalid archive handle (was the session restored?)");
+  }
+
+  const ArchiveHeader &hdr = reader->header();
+  int var = reader->variable(variable);
+  if (var < 0) {
+    stop("variable " + variable + " is not in the archive");
+  }
+
+  std::vector<uint64_t> cols, rows;
+  if (members.isNotNull()) {
+    IntegerVector m(members.get());
+    for (int j = 0; j < m.size(); ++j) {
+      if (m[j] == NA_INTEGER || m[j] < 1 || (uint64_t) m[j] > hdr.nmember) {
+        stop("members out of range");
+      }
+      cols.push_back(m[j] - 1);
+    }
+  } else {
+    for (uint64_t j = 0; j < hdr.nmember; ++j) cols.push_back(j);
+  }
+
+  if (steps.isNotNull()) {
+    IntegerVector s(steps.get());
+    for (int i = 0; i < s.size(); ++i) {
+      if (s[i] == NA_INTEGER || s[i] < 1 || (uint64_t) s[i] > hdr.ntime) {
+        stop("steps out of range");
+      }
+      rows.push_back(s[i] - 1);
+    }
+  } else {
+    for (uint64_t i = 0; i < hdr.ntime; ++i) rows.push_back(i);
+  }
+
+  // *********************
+  //  function
+  // *********************
+  NumericMatrix out(rows.size(), cols.size());
+  reader->read(var, rows, cols, out.begin());
+
+  return out;
+
+}
@@ -1,4 +1,6 @@
 #include <Rcpp.h>
+#include "aa_altrep.h"
+#include "aa_stage.h"
 #include "aa_route_3r_3o.h"
 #include "aa_route_2r_2o.h"
 #include "aa_route_2r_3o.h"
@@ -100,7 +102,13 @@ using namespace Rcpp;
 //'        lake,
 //'        inputData,
 //'        initCond,
-//'        param
+//'        param,
+//'        lazy = FALSE,
+//'        aggregate = NULL,
+//'        stride = 1,
+//'        columns = NULL,
+//'        parallel = FALSE,
+//'        into = NULL
 //'        )
 //'
 //' @param model numeric integer indicating which reservoir formulation to use:
@@ -207,6 +215,46 @@ using namespace Rcpp;
 //'   runoff (\code{Q1}) to the total reservoir discharge (\code{Qg}) \eqn{[mm]}.
 //'}
 //'
+//' @param lazy logical. When \code{TRUE} the function returns at once a \code{data.frame} whose
+//' columns are computed on first access (ALTREP). Each column runs the model the first time it is
+//' touched and only that column is stored, so the columns nobody touches take no memory (when a
+//' second column is touched the model runs once more with every column, so touching all of them
+//' costs two runs).
+//'
+//' @param aggregate optional numeric integer. Either the length of the aggregation period in time
+//' steps (e.g.: \code{24} for daily values of an hourly run) or a vector with the period number
+//' (\code{1, 2, ...}) of every time step. The outputs are accumulated per period inside the time
+//' loop and the function returns a list with the \code{sum}, \code{mean}, \code{min} and
+//' \code{max} matrices (one row per period, same columns as below) and \code{n}, the number of
+//' time steps of every period. It can not be combined with \code{lazy}.
+//'
+//' @param stride numeric integer. Only every \code{stride}-th time step (rows \code{1, 1 + stride, ...})
+//' is stored while the model still runs every time step (e.g.: state snapshots of long runs).
+//' It can not be combined with \code{aggregate}.
+//'
+//' @param columns optional character vector with the names of the output columns to keep (e.g.:
+//' \code{c('SWE', 'SM')}). The other columns are never stored.
+//'
+//' @param parallel logical (models 2 and 4 only). When \code{TRUE} long series are split in
+//' chunks that run at the same time on the shared pool of threads (see \code{\link{Threads_HBV}}).
+//' The reservoir equations are linear between threshold switches, so the start of every chunk is
+//' estimated with a parallel prefix scan of the chunk maps; the few time steps after a chunk start
+//' where the estimate missed a switch are then run again in order. The output is identical to
+//' the sequential run. Series shorter than about 32000 time steps always run sequentially. The
+//' chunks write the whole output, so it can not be combined with \code{aggregate}, \code{stride},
+//' \code{columns} or \code{lazy}.
+//'
+//' @param into optional numeric (double) matrix with the dimensions of the output (rows: time
+//' steps, or every \code{stride}-th one; columns: the kept ones). The output is written into it in
+//' place and the same matrix is returned (only its values: its attributes, e.g. the column names,
+//' are left untouched), so repeated runs (e.g.: calibration loops) reuse a single buffer,
+//' allocated once with \code{matrix(0, nrow, ncol)}. It can not be combined with \code{aggregate}
+//' or \code{lazy}. \strong{Warning}: the matrix is modified in place, outside R's copy-on-modify
+//' semantics. It is not copied when other variables refer to it, so every variable assigned from
+//' it (e.g.: \code{kept <- out} after a previous run) and every list holding it see the new values
+//' too. Use a matrix created only for this purpose and keep earlier results with an explicit copy
+//' (e.g.: \code{kept <- out + 0}).
+//'
 //' @return Numeric matrix with the following columns:
 //'
 //' \strong{Model 1}
@@ -256,6 +304,8 @@ using namespace Rcpp;
 //'   \item \code{SLZ}: lower reservoir storage \eqn{[mm]}.
 //'}
 //'
+//' With \code{into} the output is that matrix (the column names are set on the first call).
+//'
 //' @examples
 //' # The following is a toy example. I strongly recommend to see
 //' # the package vignettes in order to improve your skills on HBV.IANIGLA
@@ -286,11 +336,34 @@ using namespace Rcpp;
 //' @export
 //'
 // [[Rcpp::export]]
-NumericMatrix Routing_HBV(int model,
-                          bool lake,
-                          NumericMatrix inputData,
-                          NumericVector initCond,
-                          NumericVector param){
+SEXP Routing_HBV(int model,
+                 bool lake,
+                 NumericMatrix inputData,
+                 NumericVector initCond,
+                 NumericVector param,
+                 bool lazy = false,
+                 Nullable<IntegerVector> aggregate = R_NilValue,
+                 int stride = 1,
+                 Nullable<CharacterVector> columns = R_NilValue,
+                 bool parallel = false,
+                 SEXP into = R_NilValue){
+  if (lazy && (aggregate.isNotNull() || stride != 1 || columns.isNotNull() || parallel || into != R_NilValue)) {
+    stop("lazy option can not be combined with aggregate, stride, columns, parallel or into");
+  }
+  if (parallel && (aggregate.isNotNull() || stride != 1 || columns.isNotNull())) {
+    stop("parallel option can not be combined with aggregate, stride or columns");
+  }
+  if (lazy) {
+    // salida diferida: el módulo corre recién al tocar una columna
+    freeze(inputData);
+    freeze(initCond);
+    freeze(param);
+    return lazy_stage(inputData.nrow(), [=](int rows, SEXP cols) -> SEXP {
+      return Routing_HBV(model, lake, head_rows(inputData, rows), initCond, param, false,
+                         R_NilValue, 1, cols);
+    });
+  }
+
   // *********************
   //  conditionals
   // *********************
@@ -320,46 +393,63 @@ NumericMatrix Routing_HBV(int model,
 
   }
 
+  if ( parallel && (model != 2) && (model != 4) ) {
+    stop("parallel option is only available for models 2 and 4");
+  }
+
+  // agregación temporal o submuestreo de las salidas
+  OutputSpec spec = output_spec(aggregate, stride, columns, inputData.nrow(), into);
+
+  // tramos en paralelo (0: uno por hilo del pool compartido)
+  int chunks = parallel ? 0 : 1;
+
   // PRIMERO ELIJO EL MODELO A CORRER
 
   if (model == 1) {
-    NumericMatrix out = route_3r_3o(lake,
-                                    inputData,
-                                    initCond,
-                                    param);
+    SEXP out = route_3r_3o(lake,
+                           inputData,
+                           initCond,
+                           param,
+                           spec);
     return(out);
 
   } else if (model == 2) {
 
-    NumericMatrix out = route_2r_2o(lake,
-                                    inputData,
-                                    initCond,
-                                    param);
+    SEXP out = route_2r_2o(lake,
+                           inputData,
+                           initCond,
+                           param,
+                           spec,
+                           chunks);
 
     return(out);
 
   } else if (model == 3) {
 
-    NumericMatrix out = route_2r_3o(lake,
-                                    inputData,
-                                    initCond,
-                                    param);
+    SEXP out = route_2r_3o(lake,
+                           inputData,
+                           initCond,
+                           param,
+                           spec);
 
     return(out);
 
   } else if (model == 4) {
 
-    NumericMatrix out = route_1r_2o(inputData,
-                                    initCond,
-                                    param);
+    SEXP out = route_1r_2o(inputData,
+                           initCond,
+                           param,
+                           spec,
+                           chunks);
 
     return(out);
 
   } else if (model == 5) {
 
-    NumericMatrix out = route_1r_3o(inputData,
-                                    initCond,
-                                    param);
+    SEXP out = route_1r_3o(inputData,
+                           initCond,
+                           param,
+                           spec);
 
     return(out);
 
@@ -1,4 +1,6 @@
 #include <Rcpp.h>
+#include "aa_altrep.h"
+#include "aa_stage.h"
 #include "aa_snowmelt.h"
 #include "aa_icemelt_debris.h"
 #include "aa_icemelt_clean.h"
@@ -70,7 +72,12 @@ using namespace Rcpp;
 //'        model,
 //'        inputData,
 //'        initCond,
-//'        param
+//'        param,
+//'        lazy = FALSE,
+//'        aggregate = NULL,
+//'        stride = 1,
+//'        columns = NULL,
+//'        into = NULL
 //' )
 //'
 //' @param model numeric indicating which model you will use:
@@ -122,6 +129,37 @@ using namespace Rcpp;
 //'  \item \code{fic}: debris-covered ice-melt factor \eqn{[mm/°C.\Delta t]}.
 //'  }
 //'
+//' @param lazy logical. When \code{TRUE} the function returns at once a \code{data.frame} whose
+//' columns are computed on first access (ALTREP). Each column runs the model the first time it is
+//' touched and only that column is stored, so the columns nobody touches take no memory (when a
+//' second column is touched the model runs once more with every column, so touching all of them
+//' costs two runs).
+//'
+//' @param aggregate optional numeric integer. Either the length of the aggregation period in time
+//' steps (e.g.: \code{24} for daily values of an hourly run) or a vector with the period number
+//' (\code{1, 2, ...}) of every time step. The outputs are accumulated per period inside the time
+//' loop and the function returns a list with the \code{sum}, \code{mean}, \code{min} and
+//' \code{max} matrices (one row per period, same columns as below) and \code{n}, the number of
+//' time steps of every period. It can not be combined with \code{lazy}.
+//'
+//' @param stride numeric integer. Only every \code{stride}-th time step (rows \code{1, 1 + stride, ...})
+//' is stored while the model still runs every time step (e.g.: state snapshots of long runs).
+//' It can not be combined with \code{aggregate}.
+//'
+//' @param columns optional character vector with the names of the output columns to keep (e.g.:
+//' \code{c('SWE', 'SM')}). The other columns are never stored.
+//'
+//' @param into optional numeric (double) matrix with the dimensions of the output (rows: time
+//' steps, or every \code{stride}-th one; columns: the kept ones). The output is written into it in
+//' place and the same matrix is returned (only its values: its attributes, e.g. the column names,
+//' are left untouched), so repeated runs (e.g.: calibration loops) reuse a single buffer,
+//' allocated once with \code{matrix(0, nrow, ncol)}. It can not be combined with \code{aggregate}
+//' or \code{lazy}. \strong{Warning}: the matrix is modified in place, outside R's copy-on-modify
+//' semantics. It is not copied when other variables refer to it, so every variable assigned from
+//' it (e.g.: \code{kept <- out} after a previous run) and every list holding it see the new values
+//' too. Use a matrix created only for this purpose and keep earlier results with an explicit copy
+//' (e.g.: \code{kept <- out + 0}).
+//'
 //' @return Numeric matrix with the following columns:
 //'
 //' \strong{Model 1}
@@ -179,6 +217,8 @@ using namespace Rcpp;
 //'    \item \code{TotScal}: \code{Total} *  inputData[i, 3].
 //'  }
 //'
+//' With \code{into} the output is that matrix (the column names are set on the first call).
+//'
 //' @references
 //' Bergström, S., Lindström, G., 2015. Interpretation of runoff processes in hydrological
 //' modelling—experience from the HBV approach. Hydrol. Process. 29, 3535–3545.
@@ -213,10 +253,29 @@ using namespace Rcpp;
 //'
 //'
 // [[Rcpp::export]]
-NumericMatrix SnowGlacier_HBV(int model,
-                              NumericMatrix inputData,
-                              NumericVector initCond,
-                              NumericVector param){
+SEXP SnowGlacier_HBV(int model,
+                     NumericMatrix inputData,
+                     NumericVector initCond,
+                     NumericVector param,
+                     bool lazy = false,
+                     Nullable<IntegerVector> aggregate = R_NilValue,
+                     int stride = 1,
+                     Nullable<CharacterVector> columns = R_NilValue,
+                     SEXP into = R_NilValue){
+  if (lazy && (aggregate.isNotNull() || stride != 1 || columns.isNotNull() || into != R_NilValue)) {
+    stop("lazy option can not be combined with aggregate, stride, columns or into");
+  }
+  if (lazy) {
+    // salida diferida: el módulo corre recién al tocar una columna
+    freeze(inputData);
+    freeze(initCond);
+    freeze(param);
+    return lazy_stage(inputData.nrow(), [=](int rows, SEXP cols) -> SEXP {
+      return SnowGlacier_HBV(model, head_rows(inputData, rows), initCond, param, false,
+                             R_NilValue, 1, cols);
+    });
+  }
+
   // *********************
   //  conditionals
   // *********************
@@ -247,6 +306,9 @@ NumericMatrix SnowGlacier_HBV(int model,
   }
 
 
+  // agregación temporal o submuestreo de las salidas
+  OutputSpec spec = output_spec(aggregate, stride, columns, inputData.nrow(), into);
+
   // *********************
   //  models
   // *********************
@@ -269,9 +331,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = icemelt_clean(inputData,
-                                        initCond,
-                                        param);
+      SEXP out = icemelt_clean(inputData,
+                               initCond,
+                               param,
+                               spec);
 
       return(out);
 
@@ -289,9 +352,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = snowmelt(inputData,
-                                   initCond,
-                                   param);
+      SEXP out = snowmelt(inputData,
+                          initCond,
+                          param,
+                          spec);
 
       return(out);
 
@@ -310,9 +374,10 @@ NumericMatrix SnowGlacier_HBV(int model,
        stop("Please verify the parameter vector");
      }
 
-     NumericMatrix out = icemelt_debris(inputData,
-                                        initCond,
-                                        param);
+     SEXP out = icemelt_debris(inputData,
+                               initCond,
+                               param,
+                               spec);
 
      return(out);
 
@@ -339,9 +404,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = icemelt_clean(inputData,
-                                        initCond,
-                                        param);
+      SEXP out = icemelt_clean(inputData,
+                               initCond,
+                               param,
+                               spec);
 
       return(out);
 
@@ -360,9 +426,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = snowmelt_sca(inputData,
-                                       initCond,
-                                       param);
+      SEXP out = snowmelt_sca(inputData,
+                              initCond,
+                              param,
+                              spec);
 
       return(out);
 
@@ -381,9 +448,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = icemelt_debris(inputData,
-                                         initCond,
-                                         param);
+      SEXP out = icemelt_debris(inputData,
+                                initCond,
+                                param,
+                                spec);
 
       return(out);
 
@@ -411,9 +479,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = icemelt_clean_gca(inputData,
-                                            initCond,
-                                            param);
+      SEXP out = icemelt_clean_gca(inputData,
+                                   initCond,
+                                   param,
+                                   spec);
 
       return(out);
 
@@ -431,9 +500,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = snowmelt(inputData,
-                                   initCond,
-                                   param);
+      SEXP out = snowmelt(inputData,
+                          initCond,
+                          param,
+                          spec);
 
       return(out);
 
@@ -452,9 +522,10 @@ NumericMatrix SnowGlacier_HBV(int model,
         stop("Please verify the parameter vector");
       }
 
-      NumericMatrix out = icemelt_debris_gca(inputData,
-                                             initCond,
-                                             param);
+      SEXP out = icemelt_debris_gca(inputData,
+                                    initCond,
+                                    param,
+                                    spec);
 
       return(out);
 
@@ -1,4 +1,6 @@
 #include <Rcpp.h>
+#include "aa_altrep.h"
+#include "aa_stage.h"
 using namespace Rcpp;
 
 // **********************************************************
@@ -74,7 +76,12 @@ using namespace Rcpp;
 //'        model,
 //'        inputData,
 //'        initCond,
-//'        param
+//'        param,
+//'        lazy = FALSE,
+//'        aggregate = NULL,
+//'        stride = 1,
+//'        columns = NULL,
+//'        into = NULL
 //'        )
 //'
 //' @param model numeric integer suggesting one of the following options:
@@ -125,6 +132,37 @@ using namespace Rcpp;
 //'   soil box water input (rainfall plus snowmelt) and the effective runoff \eqn{[-]}.
 //' }
 //'
+//' @param lazy logical. When \code{TRUE} the function returns at once a \code{data.frame} whose
+//' columns are computed on first access (ALTREP). Each column runs the model the first time it is
+//' touched and only that column is stored, so the columns nobody touches take no memory (when a
+//' second column is touched the model runs once more with every column, so touching all of them
+//' costs two runs).
+//'
+//' @param aggregate optional numeric integer. Either the length of the aggregation period in time
+//' steps (e.g.: \code{24} for daily values of an hourly run) or a vector with the period number
+//' (\code{1, 2, ...}) of every time step. The outputs are accumulated per period inside the time
+//' loop and the function returns a list with the \code{sum}, \code{mean}, \code{min} and
+//' \code{max} matrices (one row per period, same columns as below) and \code{n}, the number of
+//' time steps of every period. It can not be combined with \code{lazy}.
+//'
+//' @param stride numeric integer. Only every \code{stride}-th time step (rows \code{1, 1 + stride, ...})
+//' is stored while the model still runs every time step (e.g.: state snapshots of long runs).
+//' It can not be combined with \code{aggregate}.
+//'
+//' @param columns optional character vector with the names of the output columns to keep (e.g.:
+//' \code{c('SWE', 'SM')}). The other columns are never stored.
+//'
+//' @param into optional numeric (double) matrix with the dimensions of the output (rows: time
+//' steps, or every \code{stride}-th one; columns: the kept ones). The output is written into it in
+//' place and the same matrix is returned (only its values: its attributes, e.g. the column names,
+//' are left untouched), so repeated runs (e.g.: calibration loops) reuse a single buffer,
+//' allocated once with \code{matrix(0, nrow, ncol)}. It can not be combined with \code{aggregate}
+//' or \code{lazy}. \strong{Warning}: the matrix is modified in place, outside R's copy-on-modify
+//' semantics. It is not copied when other variables refer to it, so every variable assigned from
+//' it (e.g.: \code{kept <- out} after a previous run) and every list holding it see the new values
+//' too. Use a matrix created only for this purpose and keep earlier results with an explicit copy
+//' (e.g.: \code{kept <- out + 0}).
+//'
 //' @return Numeric matrix with the following columns:
 //' \enumerate{
 //'   \item \code{Rech}: recharge series \eqn{[mm/\Delta t]}. This is the input to
@@ -133,6 +171,8 @@ using namespace Rcpp;
 //'   \item \code{SM}: soil moisture series \eqn{[mm/\Delta t]}.
 //' }
 //'
+//' With \code{into} the output is that matrix (the column names are set on the first call).
+//'
 //' @references
 //' Bergström, S., Lindström, G., 2015. Interpretation of runoff processes in hydrological
 //' modelling—experience from the HBV approach. Hydrol. Process. 29, 3535–3545.
@@ -166,10 +206,29 @@ using namespace Rcpp;
 //'
 //'
 // [[Rcpp::export]]
-NumericVector Soil_HBV(int model,
-                       NumericMatrix inputData,
-                       NumericVector initCond,
-                       NumericVector param) {
+SEXP Soil_HBV(int model,
+              NumericMatrix inputData,
+              NumericVector initCond,
+              NumericVector param,
+              bool lazy = false,
+              Nullable<IntegerVector> aggregate = R_NilValue,
+              int stride = 1,
+              Nullable<CharacterVector> columns = R_NilValue,
+              SEXP into = R_NilValue) {
+  if (lazy && (aggregate.isNotNull() || stride != 1 || columns.isNotNull() || into != R_NilValue)) {
+    stop("lazy option can not be combined with aggregate, stride, columns or into");
+  }
+  if (lazy) {
+    // salida diferida: el módulo corre recién al tocar una columna
+    freeze(inputData);
+    freeze(initCond);
+    freeze(param);
+    return lazy_stage(inputData.nrow(), [=](int rows, SEXP cols) -> SEXP {
+      return Soil_HBV(model, head_rows(inputData, rows), initCond, param, false,
+                      R_NilValue, 1, cols);
+    });
+  }
+
   // *********************
   //  conditionals
   // *********************
@@ -199,6 +258,9 @@ NumericVector Soil_HBV(int model,
 
   }
 
+  // agregación temporal o submuestreo de las salidas
+  OutputSpec spec = output_spec(aggregate, stride, columns, inputData.nrow(), into);
+
   // *********************
   //  models
   // *********************
@@ -230,7 +292,8 @@ NumericVector Soil_HBV(int model,
     // defino variables, parámetros y matriz de salida
     double Eac, Ieff, Def, SM; // variables intermedias y finales
     double FC, LP, beta;       // parámetros
-    NumericMatrix out(n, m);   // matriz de salida
+    StageOutput out(n, m, spec, // matriz de salida
+                    {"Rech", "Eac", "SM"});
 
     // Le doy valores a los parámetros
     FC   = param[0];
@@ -290,8 +353,7 @@ NumericVector Soil_HBV(int model,
 
     }
 
-    colnames(out) = CharacterVector::create("Rech", "Eac", "SM");
-    return out;
+    return out.result();
 
   } else if (model == 2) {
     // MODELO CON ÁREA VARIABLE
@@ -316,7 +378,8 @@ NumericVector Soil_HBV(int model,
     // defino variables, parámetros y matriz de salida
     double Eac, Ieff, Def, SM; // variables intermedias y finales
     double FC, LP, beta;       // parámetros
-    NumericMatrix out(n, m);   // matriz de salida
+    StageOutput out(n, m, spec, // matriz de salida
+                    {"Rech", "Eac", "SM"});
 
     // Le doy valores a los parámetros
     FC   = param[0];
@@ -376,8 +439,7 @@ NumericVector Soil_HBV(int model,
 
     }
 
-    colnames(out) = CharacterVector::create("Rech", "Eac", "SM");
-    return out;
+    return out.result();
 
 
   } else {
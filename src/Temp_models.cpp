@@ -1,4 +1,5 @@
 #include <Rcpp.h>
+#include "aa_bands.h"
 using namespace Rcpp;
 
 // **********************************************************
@@ -175,3 +176,113 @@ NumericVector Temp_model(int model,
   }
 
 }
+
+//' @name TempBands_model
+//'
+//' @title Air temperature models over many elevation bands
+//'
+//' @description Same as \code{\link{Temp_model}} but for a vector of target heights. All the
+//' bands are computed in a single pass over the air temperature record and returned as a
+//' matrix whose columns are contiguous band series (the layout read by the snow routines).
+//'
+//' @usage TempBands_model(
+//'        model,
+//'        inputData,
+//'        zmeteo,
+//'        ztopo,
+//'        param
+//' )
+//' @param model numeric value with model option (see \code{\link{Temp_model}}).
+//'
+//' @param inputData numeric vector with air temperature record series [ºC/\eqn{\Delta t}].
+//'
+//' @param zmeteo numeric value indicating the altitude where the air temperature is recorded
+//' \eqn{[masl]}.
+//'
+//' @param ztopo numeric vector with the target heights \eqn{[masl]}.
+//'
+//' @param param numeric vector with the air temperature linear gradient (\code{grad_t})
+//' [ºC/km] and, for model 2, the threshold height \eqn{[masl]}: a single value or one per
+//' band.
+//'
+//' @return Numeric matrix (time steps x bands) with the extrapolated air temperature series.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' ## linear model with a threshold per band
+//' airTemp <- TempBands_model(
+//'                            model = 2,
+//'                            inputData = runif(200, max = 25, min = -10),
+//'                            zmeteo = 2000, ztopo = c(2500, 3500, 4500),
+//'                            param = c(-6.5, 4000, 4000, 4200)
+//'                            )
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+NumericMatrix TempBands_model(int model,
+                              NumericVector inputData,
+                              double zmeteo,
+                              NumericVector ztopo,
+                              NumericVector param) {
+  // *********************
+  //  conditionals
+  // *********************
+
+  // check for NA_real_
+  // inputData
+  int chk_1 = sum( is_na(inputData) );
+  if(chk_1 != 0){
+
+    stop("inputData argument should not contain NA values!");
+
+  }
+
+  // ztopo
+  int chk_2 = sum( is_na(ztopo) );
+  if(chk_2 != 0){
+
+    stop("ztopo argument should not contain NA values!");
+
+  }
+
+  // param
+  int chk_3 = sum( is_na(param) );
+  if(chk_3 != 0){
+
+    stop("param argument should not contain NA values!");
+
+  }
+
+  int n     = inputData.size();
+  int nband = ztopo.size();
+
+  if (model != 1 && model != 2) {
+    stop("Model not available");
+  }
+  if (param.size() < 1 ||
+      (model == 2 && param.size() != 2 && param.size() != nband + 1) ) {
+    stop("Please verify the parameter vector");
+  }
+
+  // *********************
+  //  function
+  // *********************
+  std::vector<double> thres;
+  if (model == 2) {
+    if (param.size() == 2) {
+      thres.assign(nband, param[1]);
+    } else {
+      thres.assign(param.begin() + 1, param.end());
+    }
+  }
+
+  NumericMatrix out(n, nband);
+  temp_bands(model, inputData.begin(), n, zmeteo, ztopo.begin(),
+             thres.empty() ? 0 : thres.data(), nband, param[0], out.begin());
+
+  return out;
+
+}
@@ -0,0 +1,88 @@
+#include <Rcpp.h>
+#include "aa_threadpool.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+//' @name Threads_HBV
+//'
+//' @title Shared thread pool
+//'
+//' @description Query or resize the pool of native threads shared by every parallel function
+//' of the package (e.g.: \code{\link{Calibrate_HBV}} and \code{\link{SnowBands_HBV}}). The pool
+//' is created once per session, on first use, so repeated calls do not pay for thread creation.
+//' Its size is taken from (in this order) the last call to this function, the
+//' \code{HBV.IANIGLA.threads} option at load time, the \code{HBV_THREADS} environment variable
+//' or the number of available cores. Background jobs (\code{async = TRUE}) run on a second pool
+//' of the same size, so a running job never holds the threads of the functions that wait for
+//' their result. Those functions can be interrupted (e.g.: Ctrl-C) while they wait: the
+//' pending tasks are skipped and the running ones finish first.
+//'
+//' @usage Threads_HBV(
+//'        threads = -1,
+//'        pin = NULL
+//' )
+//'
+//' @param threads numeric integer with the number of threads. Negative values keep the current
+//' size and zero goes back to the default size. The call never blocks: an idle pool is resized at
+//' once, while a busy one (e.g.: running a background \code{\link{Calibrate_HBV}} job) keeps its
+//' size until its tasks finish and is resized by the next parallel call that finds it idle.
+//'
+//' @param pin logical. When \code{TRUE} every thread is bound to one core (Linux and Windows).
+//' \code{NULL} keeps the current setting.
+//'
+//' @return Named integer vector with the following elements:
+//' \itemize{
+//'   \item \code{threads}: number of threads of the pool.
+//'   \item \code{pinned}: 1 when the threads are bound to cores.
+//'   \item \code{cores}: number of available cores.
+//'   \item \code{started}: 1 when the pool is already running.
+//'   \item \code{pending}: 1 when a new size waits for a pool to be idle.
+//' }
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' Threads_HBV()
+//'
+//' Threads_HBV(threads = 2)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+IntegerVector Threads_HBV(int threads = -1,
+                          Nullable<LogicalVector> pin = R_NilValue){
+  // *********************
+  //  conditionals
+  // *********************
+  bool p = shared_pool_pinned();
+  if (pin.isNotNull()) {
+    LogicalVector lv(pin.get());
+    if (lv.size() != 1 || lv[0] == NA_LOGICAL) {
+      stop("pin must be TRUE or FALSE");
+    }
+    p = (lv[0] == TRUE);
+  }
+
+  // *********************
+  //  function
+  // *********************
+  if (threads >= 0 || pin.isNotNull()) {
+    shared_pool_configure(threads, p);
+  }
+
+  return IntegerVector::create(Named("threads") = shared_pool_size(),
+                               Named("pinned")  = (int) shared_pool_pinned(),
+                               Named("cores")   = hardware_threads(),
+                               Named("started") = (int) shared_pool_started(),
+                               Named("pending") = (int) shared_pool_resize_pending());
+}
@@ -160,7 +160,8 @@ NumericVector UH(int model,
     for (int i = 0; i < m; ++i) {
       double Qf = 0.0; // variable ficticia
 
-      for (int j = 0; j < n; ++j) {
+      // los caudales previos al primer paso se toman como cero
+      for (int j = 0; j < n && j <= i; ++j) {
         Qf += Qg[i - j] * w[j];
 
       }
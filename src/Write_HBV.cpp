@@ -0,0 +1,123 @@
+#include <Rcpp.h>
+#include "aa_archive.h"
+using namespace Rcpp;
+
+// **********************************************************
+//  Author       : Ezequiel Toum
+//  Licence      : GPL V3
+//  Institution  : IANIGLA-CONICET
+//  e-mail       : etoum@mendoza-conicet.gob.ar
+//  **********************************************************
+//  HBV.IANIGLA package is distributed in the hope that it
+//  will be useful but WITHOUT ANY WARRANTY.
+//  **********************************************************
+
+/*
+// ARCHIVO DE RESULTADOS
+// Guarda las salidas de un ensamble (una matriz tiempo x miembro por variable)
+// en bloques de chunk[1] pasos por chunk[2] miembros, comprimidos por
+// separado. Leer un miembro o un período sólo toca los bloques necesarios
+// (ver Read_HBV).
+*/
+
+//' @name Write_HBV
+//'
+//' @title Write ensemble results to a chunked archive
+//'
+//' @description Stores ensemble outputs (e.g.: \code{Qg}, \code{SWE} or \code{SM} for every
+//' member) in a chunked columnar file. Each variable is split in blocks of \code{chunk[1]}
+//' time steps by \code{chunk[2]} members that are written (and optionally compressed)
+//' independently, so \code{\link{Read_HBV}} returns a member or a period without loading
+//' the whole file.
+//'
+//' @usage Write_HBV(
+//'        file,
+//'        results,
+//'        chunk = c(365, 64),
+//'        compress = TRUE
+//' )
+//'
+//' @param file string with the path of the archive.
+//'
+//' @param results named list of numeric matrices (time steps x members) with the same
+//' dimensions.
+//'
+//' @param chunk numeric integer vector with the number of time steps and members per block.
+//'
+//' @param compress logical. When \code{TRUE} the blocks are compressed (xor against the
+//' previous value, byte shuffle and zero run-length encoding). Blocks that do not shrink are
+//' stored as they are.
+//'
+//' @return Numeric value with the file size in bytes.
+//'
+//' @examples
+//' # The following is a toy example. I strongly recommend to see
+//' # the package vignettes in order to improve your skills on HBV.IANIGLA
+//'
+//' qg  <- matrix(runif(3650 * 20), ncol = 20)
+//' swe <- matrix(0, nrow = 3650, ncol = 20)
+//'
+//' file <- tempfile(fileext = ".hbv")
+//' Write_HBV(file = file, results = list(Qg = qg, SWE = swe))
+//'
+//' archive <- Open_HBV(file)
+//' Read_HBV(archive = archive, variable = "Qg", members = c(2, 7), steps = 1:10)
+//'
+//' @export
+//'
+// [[Rcpp::export]]
+double Write_HBV(std::string file,
+                 List results,
+                 IntegerVector chunk = IntegerVector::create(365, 64),
+                 bool compress = true){
+  // *********************
+  //  conditionals
+  // *********************
+  int nvar = results.size();
+  if (nvar == 0 || Rf_isNull(results.names())) {
+    stop("results must be a named list of matrices");
+  }
+  if (chunk.size() != 2 || chunk[0] < 1 || chunk[1] < 1) {
+    stop("Please verify the chunk vector");
+  }
+
+  CharacterVector names = results.names();
+  std::vector<NumericMatrix> mat;
+  for (int v = 0; v < nvar; ++v) {
+    if ( !Rf_isMatrix(results[v]) || TYPEOF(results[v]) != REALSXP ) {
+      stop("results must be a named list of numeric matrices");
+    }
+    mat.push_back( NumericMatrix(results[v]) );
+
+    if (mat[v].nrow() != mat[0].nrow() || mat[v].ncol() != mat[0].ncol()) {
+      stop("all the matrices in results must have the same dimensions");
+    }
+  }
+
+  // *********************
+  //  function
+  // *********************
+  ArchiveHeader hdr;
+  for (int v = 0; v < nvar; ++v) {
+    hdr.names.push_back( std::string(names[v]) );
+  }
+  hdr.ntime        = mat[0].nrow();
+  hdr.nmember      = mat[0].ncol();
+  hdr.chunk_time   = std::min<uint64_t>(chunk[0], hdr.ntime);
+  hdr.chunk_member = std::min<uint64_t>(chunk[1], hdr.nmember);
+  hdr.compress     = compress;
+
+  ArchiveWriter writer(file, hdr);
+
+  std::vector<const double*> data(nvar);
+  for (uint64_t m0 = 0; m0 < hdr.nmember; m0 += hdr.chunk_member) {
+    uint64_t nm = std::min<uint64_t>(hdr.chunk_member, hdr.nmember - m0);
+    for (int v = 0; v < nvar; ++v) {
+      data[v] = mat[v].begin() + m0 * hdr.ntime;
+    }
+    writer.write_members(m0, nm, data, hdr.ntime);
+  }
+
+  return writer.close();
+
+}
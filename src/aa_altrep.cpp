@@ -0,0 +1,226 @@
+#include <Rcpp.h>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "aa_altrep.h"
+
+#if R_VERSION < R_Version(3, 6, 0)
+#define class klass
+extern "C" {
+#include <R_ext/Altrep.h>
+}
+#undef class
+#else
+#include <R_ext/Altrep.h>
+#endif
+
+using namespace Rcpp;
+
+
+// salida diferida de un módulo: entradas retenidas hasta que se tocan todas
+// las columnas
+struct LazyTable {
+  std::function<SEXP(int, SEXP)> run;
+  int n;
+  int ncol;
+  int pending;    // columnas sin materializar
+  std::vector<std::string> names;
+
+  LazyTable(const std::function<SEXP(int, SEXP)> &f, int rows, int cols) :
+    run(f), n(rows), ncol(cols), pending(cols), names(cols) {}
+};
+
+static R_altrep_class_t lazy_column_class;
+
+static LazyTable* lazy_table(SEXP x){
+  return (LazyTable*) R_ExternalPtrAddr( R_altrep_data1(x) );
+}
+
+// data2: índice de la columna (INTSXP) hasta el primer acceso, luego la
+// serie de la columna (REALSXP), protegida como parte del propio ALTREP
+static bool lazy_ready(SEXP x){
+  return TYPEOF( R_altrep_data2(x) ) == REALSXP;
+}
+
+static int lazy_index(SEXP x){
+  return INTEGER( R_altrep_data2(x) )[0];
+}
+
+// corre el módulo con las columnas 'cols' (NULL: todas); devuelve un
+// mensaje de error o "" si la salida tiene 'ncol' columnas de n filas
+static SEXP lazy_run(LazyTable *t, SEXP cols, int ncol, char *msg, size_t size){
+  SEXP out = R_NilValue;
+  try {
+    out = t->run(t->n, cols);
+  } catch (std::exception &e) {
+    std::strncpy(msg, e.what(), size - 1);
+  }
+  if (msg[0] == '\0' &&
+      (TYPEOF(out) != REALSXP || Rf_xlength(out) != (R_xlen_t) t->n * ncol)) {
+    std::strncpy(msg, "lazy output does not match its columns", size - 1);
+  }
+  return out;
+}
+
+// la primera columna que se toca corre el módulo guardando sólo esa
+// columna; a partir de la segunda se corre una vez más con todas y las
+// demás se copian de esa salida, que queda en la tabla (protegida por su
+// puntero externo) hasta que se materializa la última
+static double* lazy_data(SEXP x){
+  if (lazy_ready(x)) return REAL( R_altrep_data2(x) );
+
+  SEXP tab = R_altrep_data1(x);
+  LazyTable *t = lazy_table(x);
+  int j = lazy_index(x);
+
+  char msg[512] = "";
+  SEXP full = R_ExternalPtrProtected(tab);
+  if (full == R_NilValue && t->pending < t->ncol) {
+    full = lazy_run(t, R_NilValue, t->ncol, msg, sizeof(msg));
+    if (msg[0] != '\0') {
+      Rf_error("%s", msg);
+    }
+    R_SetExternalPtrProtected(tab, full);
+  }
+
+  SEXP out;
+  if (full != R_NilValue) {
+    out = PROTECT( Rf_allocVector(REALSXP, t->n) );
+    std::memcpy(REAL(out), REAL(full) + (R_xlen_t) j * t->n, (size_t) t->n * sizeof(double));
+  } else {
+    SEXP col = PROTECT( Rf_mkString(t->names[j].c_str()) );
+    out = lazy_run(t, col, 1, msg, sizeof(msg));
+    UNPROTECT(1);
+    if (msg[0] != '\0') {
+      Rf_error("%s", msg);
+    }
+    PROTECT(out);
+  }
+
+  R_set_altrep_data2(x, out);
+  UNPROTECT(1);
+  if (--t->pending == 0) {
+    t->run = std::function<SEXP(int, SEXP)>();   // libero las entradas
+    R_SetExternalPtrProtected(tab, R_NilValue);
+  }
+
+  return REAL( R_altrep_data2(x) );
+}
+
+static R_xlen_t lazy_length(SEXP x){
+  return lazy_table(x)->n;
+}
+
+static Rboolean lazy_inspect(SEXP x, int pre, int deep, int pvec,
+                             void (*inspect_subtree)(SEXP, int, int, int)){
+  (void) pre;
+  (void) deep;
+  (void) pvec;
+  (void) inspect_subtree;
+  Rprintf("HBV.IANIGLA lazy column (%s)\n", lazy_ready(x) ? "materialized" : "deferred");
+  return TRUE;
+}
+
+static void* lazy_dataptr(SEXP x, Rboolean writeable){
+  (void) writeable;
+  return lazy_data(x);
+}
+
+static const void* lazy_dataptr_or_null(SEXP x){
+  return lazy_ready(x) ? REAL( R_altrep_data2(x) ) : NULL;
+}
+
+static double lazy_elt(SEXP x, R_xlen_t i){
+  return lazy_data(x)[i];
+}
+
+static R_xlen_t lazy_get_region(SEXP x, R_xlen_t i, R_xlen_t n, double *buf){
+  const double *d = lazy_data(x);
+  R_xlen_t m = std::min(n, lazy_length(x) - i);
+  std::copy(d + i, d + i + m, buf);
+  return m;
+}
+
+// [[Rcpp::init]]
+void init_altrep(DllInfo* dll){
+  lazy_column_class = R_make_altreal_class("lazy_column", "HBV.IANIGLA", dll);
+
+  R_set_altrep_Length_method(lazy_column_class, lazy_length);
+  R_set_altrep_Inspect_method(lazy_column_class, lazy_inspect);
+  R_set_altvec_Dataptr_method(lazy_column_class, lazy_dataptr);
+  R_set_altvec_Dataptr_or_null_method(lazy_column_class, lazy_dataptr_or_null);
+  R_set_altreal_Elt_method(lazy_column_class, lazy_elt);
+  R_set_altreal_Get_region_method(lazy_column_class, lazy_get_region);
+}
+
+void freeze(SEXP x){
+  MARK_NOT_MUTABLE(x);
+}
+
+NumericMatrix head_rows(NumericMatrix x,
+                        int rows){
+  if (rows == x.nrow()) return x;
+
+  NumericMatrix out(rows, x.ncol());
+  for (int j = 0; j < x.ncol(); ++j) {
+    std::copy(x.begin() + (R_xlen_t) j * x.nrow(),
+              x.begin() + (R_xlen_t) j * x.nrow() + rows,
+              out.begin() + (R_xlen_t) j * rows);
+  }
+  return out;
+}
+
+// nombres de las columnas de una matriz de salida
+static CharacterVector column_names(NumericMatrix x){
+  CharacterVector names(x.ncol());
+  SEXP dn = Rf_getAttrib(x, R_DimNamesSymbol);
+  for (int j = 0; j < x.ncol(); ++j) {
+    if (!Rf_isNull(dn) && !Rf_isNull(VECTOR_ELT(dn, 1))) {
+      names[j] = STRING_ELT(VECTOR_ELT(dn, 1), j);
+    } else {
+      names[j] = "V" + std::to_string(j + 1);
+    }
+  }
+  return names;
+}
+
+static List as_frame(List cols, CharacterVector names, int n){
+  cols.attr("names")     = names;
+  cols.attr("row.names") = IntegerVector::create(NA_INTEGER, -n);
+  cols.attr("class")     = "data.frame";
+  return cols;
+}
+
+SEXP lazy_stage(int n,
+                const std::function<SEXP(int, SEXP)> &run){
+  if (n < 2) {
+    // series cortas: se corren enseguida, con el mismo tipo de salida
+    NumericMatrix all = run(n, R_NilValue);
+    List cols(all.ncol());
+    for (int j = 0; j < all.ncol(); ++j) {
+      cols[j] = NumericVector(all.begin() + (R_xlen_t) j * n,
+                              all.begin() + (R_xlen_t) (j + 1) * n);
+    }
+    return as_frame(cols, column_names(all), n);
+  }
+
+  // una sola fila para conocer las columnas de salida
+  NumericMatrix probe = run(1, R_NilValue);
+  int ncol = probe.ncol();
+  CharacterVector names = column_names(probe);
+
+  XPtr<LazyTable> table(new LazyTable(run, n, ncol), true);
+  for (int j = 0; j < ncol; ++j) {
+    table->names[j] = std::string(names[j]);
+  }
+
+  List out(ncol);
+  for (int j = 0; j < ncol; ++j) {
+    SEXP idx = PROTECT( Rf_ScalarInteger(j) );
+    out[j] = R_new_altrep(lazy_column_class, table, idx);
+    UNPROTECT(1);
+  }
+
+  return as_frame(out, names, n);
+}
@@ -0,0 +1,31 @@
+#include <Rcpp.h>
+#ifndef HBV_ALTREP_H
+#define HBV_ALTREP_H
+
+#include <functional>
+
+// **********************************************************
+//  Lazily materialized stage outputs. The stage is not run
+//  until a column is touched; then it runs keeping only that
+//  column (the 'columns' option of the stages), so the columns
+//  nobody touches are never stored. When a second column is
+//  touched the stage runs once more with every column and the
+//  rest are taken from that run: touching all of them costs at
+//  most two runs.
+// **********************************************************
+
+// run(rows, columns) runs the stage over the first 'rows' time steps and
+// returns its output matrix with the given 'columns' (a character vector;
+// NULL: all). Returns a data.frame of ALTREP columns with n rows (plain
+// columns when n < 2).
+SEXP lazy_stage(int n,
+                const std::function<SEXP(int, SEXP)> &run);
+
+// inputs captured by run() must not be modified in place afterwards
+void freeze(SEXP x);
+
+// first 'rows' rows of a matrix (itself when rows == nrow)
+Rcpp::NumericMatrix head_rows(Rcpp::NumericMatrix x,
+                              int rows);
+
+#endif
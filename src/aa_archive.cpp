@@ -0,0 +1,413 @@
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "aa_archive.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char ARCHIVE_MAGIC[8]  = {'H','B','V','A','R','C','H','1'};
+static const char ARCHIVE_END[8]    = {'H','B','V','I','N','D','E','X'};
+static const uint32_t ARCHIVE_VERSION = 2;   // 1: without tag
+
+static uint64_t nchunks(uint64_t n, uint64_t chunk){
+  return (n + chunk - 1) / chunk;
+}
+
+// *********************
+//  block codec
+// *********************
+
+// 1) xor con el valor anterior (series suaves -> muchos bytes nulos)
+// 2) bytes agrupados por posición (byte shuffle)
+// 3) RLE de ceros: c < 128 -> c + 1 bytes literales; c >= 128 -> c - 127 ceros
+void archive_encode(const double *x, uint64_t n, std::string &out){
+  std::string plane(8 * n, '\0');
+  uint64_t prev = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    uint64_t u;
+    std::memcpy(&u, x + i, 8);
+    uint64_t d = u ^ prev;
+    prev = u;
+    for (int b = 0; b < 8; ++b) {
+      plane[b * n + i] = (char) ( (d >> (8 * b)) & 0xFF );
+    }
+  }
+
+  out.clear();
+  uint64_t len = plane.size(), i = 0;
+  while (i < len) {
+    uint64_t z = 0;
+    while (i + z < len && z < 128 && plane[i + z] == '\0') ++z;
+
+    if (z >= 2) {
+      out.push_back( (char) (127 + z) );
+      i += z;
+      continue;
+    }
+
+    // literales hasta el próximo par de ceros
+    uint64_t j = i;
+    while (j < len && (j - i) < 128 &&
+           !(plane[j] == '\0' && j + 1 < len && plane[j + 1] == '\0') ) ++j;
+    if (j == i) j = i + 1;
+
+    out.push_back( (char) (j - i - 1) );
+    out.append(plane, i, j - i);
+    i = j;
+  }
+}
+
+void archive_decode(const unsigned char *src, uint64_t bytes, uint64_t n, double *x){
+  std::vector<unsigned char> plane(8 * n, 0);
+  uint64_t i = 0, k = 0;
+  while (i < bytes && k < plane.size()) {
+    unsigned c = src[i++];
+    if (c >= 128) {
+      k += c - 127;
+    } else {
+      // los literales no pueden pasar el final del bloque
+      if (c + 1 > bytes - i) {
+        throw std::runtime_error("truncated archive");
+      }
+      uint64_t m = std::min<uint64_t>(c + 1, plane.size() - k);
+      std::memcpy(&plane[k], src + i, m);
+      i += c + 1;
+      k += m;
+    }
+  }
+  if (i != bytes || k != plane.size()) {
+    throw std::runtime_error("corrupted archive block");
+  }
+
+  uint64_t prev = 0;
+  for (uint64_t j = 0; j < n; ++j) {
+    uint64_t d = 0;
+    for (int b = 0; b < 8; ++b) {
+      d |= (uint64_t) plane[b * n + j] << (8 * b);
+    }
+    prev ^= d;
+    std::memcpy(x + j, &prev, 8);
+  }
+}
+
+// *********************
+//  writer
+// *********************
+
+ArchiveWriter::ArchiveWriter(const std::string &path,
+                             const ArchiveHeader &header)
+  : out(0), hdr(header), pos(0), written(0) {
+  if (hdr.names.empty() || hdr.ntime == 0 || hdr.nmember == 0 ||
+      hdr.chunk_time == 0 || hdr.chunk_member == 0) {
+    throw std::runtime_error("Please verify the archive dimensions");
+  }
+
+  out = std::fopen(path.c_str(), "wb");
+  if (out == 0) {
+    throw std::runtime_error("cannot open " + path + " for writing");
+  }
+
+  uint32_t nvar = hdr.names.size();
+  std::fwrite(ARCHIVE_MAGIC, 1, 8, out);
+  std::fwrite(&ARCHIVE_VERSION, 4, 1, out);
+  std::fwrite(&nvar, 4, 1, out);
+  std::fwrite(&hdr.ntime, 8, 1, out);
+  std::fwrite(&hdr.nmember, 8, 1, out);
+  std::fwrite(&hdr.chunk_time, 4, 1, out);
+  std::fwrite(&hdr.chunk_member, 4, 1, out);
+  std::fwrite(&hdr.compress, 4, 1, out);
+  pos = 44;
+  for (uint32_t v = 0; v < nvar; ++v) {
+    uint32_t len = hdr.names[v].size();
+    std::fwrite(&len, 4, 1, out);
+    std::fwrite(hdr.names[v].data(), 1, len, out);
+    pos += 4 + len;
+  }
+  uint32_t len = hdr.tag.size();
+  std::fwrite(&len, 4, 1, out);
+  std::fwrite(hdr.tag.data(), 1, len, out);
+  pos += 4 + len;
+
+  ArchiveBlock empty = {0, 0, 0, 0};
+  index.assign(nvar * nchunks(hdr.nmember, hdr.chunk_member) *
+               nchunks(hdr.ntime, hdr.chunk_time), empty);
+}
+
+ArchiveWriter::~ArchiveWriter(){
+  if (out != 0) std::fclose(out);
+}
+
+void ArchiveWriter::write_members(uint64_t m0,
+                                  uint64_t nm,
+                                  const std::vector<const double*> &data,
+                                  uint64_t ld){
+  uint64_t cm = hdr.chunk_member, ct = hdr.chunk_time;
+  uint64_t ntc = nchunks(hdr.ntime, ct), nmc = nchunks(hdr.nmember, cm);
+
+  if (out == 0 || m0 != written || data.size() != hdr.names.size() ||
+      nm != std::min(cm, hdr.nmember - m0) || ld < hdr.ntime) {
+    throw std::runtime_error("archive members must be written in chunk order");
+  }
+
+  uint64_t mc = m0 / cm;
+  for (uint64_t v = 0; v < data.size(); ++v) {
+    for (uint64_t tc = 0; tc < ntc; ++tc) {
+      uint64_t t0 = tc * ct;
+      uint64_t nt = std::min(ct, hdr.ntime - t0);
+
+      block.resize(nt * nm);
+      for (uint64_t j = 0; j < nm; ++j) {
+        std::memcpy(&block[j * nt], data[v] + t0 + j * ld, nt * sizeof(double));
+      }
+
+      ArchiveBlock &b = index[ (v * nmc + mc) * ntc + tc ];
+      b.offset = pos;
+      b.codec  = 0;
+      b.bytes  = block.size() * sizeof(double);
+
+      const char *src = (const char*) block.data();
+      if (hdr.compress) {
+        archive_encode(block.data(), block.size(), packed);
+        if (packed.size() < b.bytes) {
+          b.codec = 1;
+          b.bytes = packed.size();
+          src     = packed.data();
+        }
+      }
+
+      if (std::fwrite(src, 1, b.bytes, out) != b.bytes) {
+        throw std::runtime_error("archive write failed (disk full?)");
+      }
+      pos += b.bytes;
+    }
+  }
+
+  written += nm;
+}
+
+uint64_t ArchiveWriter::close(){
+  if (out == 0) return pos;
+  if (written != hdr.nmember) {
+    throw std::runtime_error("archive closed before all the members were written");
+  }
+
+  uint64_t at = pos;
+  std::fwrite(index.data(), sizeof(ArchiveBlock), index.size(), out);
+  std::fwrite(&at, 8, 1, out);
+  std::fwrite(ARCHIVE_END, 1, 8, out);
+  pos += index.size() * sizeof(ArchiveBlock) + 16;
+
+  int rc = std::fclose(out);
+  out = 0;
+  if (rc != 0) {
+    throw std::runtime_error("archive write failed");
+  }
+  return pos;
+}
+
+// *********************
+//  reader
+// *********************
+
+ArchiveReader::ArchiveReader(const std::string &path)
+  : base(0), size(0), handle(0) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  LARGE_INTEGER len;
+  GetFileSizeEx(file, &len);
+  size = len.QuadPart;
+  HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (map == NULL) {
+    throw std::runtime_error("cannot map " + path);
+  }
+  base   = (const unsigned char*) MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+  handle = map;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  struct stat st;
+  fstat(fd, &st);
+  size = st.st_size;
+  void *addr = (size > 0) ? mmap(0, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  base = (addr == MAP_FAILED) ? 0 : (const unsigned char*) addr;
+#endif
+
+  if (base == 0 || size < 60 ||
+      std::memcmp(base, ARCHIVE_MAGIC, 8) != 0 ||
+      std::memcmp(base + size - 8, ARCHIVE_END, 8) != 0) {
+    unmap();
+    throw std::runtime_error(path + " is not a HBV.IANIGLA archive");
+  }
+
+  uint32_t version, nvar;
+  std::memcpy(&version, base + 8, 4);
+  std::memcpy(&nvar, base + 12, 4);
+  std::memcpy(&hdr.ntime, base + 16, 8);
+  std::memcpy(&hdr.nmember, base + 24, 8);
+  std::memcpy(&hdr.chunk_time, base + 32, 4);
+  std::memcpy(&hdr.chunk_member, base + 36, 4);
+  std::memcpy(&hdr.compress, base + 40, 4);
+
+  uint64_t p = 44;
+  for (uint32_t v = 0; v < nvar && p + 4 <= size; ++v) {
+    uint32_t len;
+    std::memcpy(&len, base + p, 4);
+    hdr.names.push_back( std::string( (const char*) base + p + 4, std::min<uint64_t>(len, size - p - 4) ) );
+    p += 4 + len;
+  }
+  if (version >= 2) {
+    // un tag cortado deja p > size y el archivo se rechaza abajo
+    uint32_t len = 0;
+    if (p + 4 <= size) std::memcpy(&len, base + p, 4);
+    if (p + 4 <= size && len <= size - p - 4) {
+      hdr.tag.assign( (const char*) base + p + 4, len );
+    }
+    p += 4 + (uint64_t) len;
+  }
+
+  if (version < 1 || version > ARCHIVE_VERSION || hdr.names.size() != nvar || p > size ||
+      hdr.ntime == 0 || hdr.nmember == 0 ||
+      hdr.chunk_time == 0 || hdr.chunk_member == 0) {
+    unmap();
+    throw std::runtime_error(path + ": unsupported or truncated archive");
+  }
+
+  // el índice ocupa exactamente el espacio entre los bloques y el final
+  uint64_t at;
+  std::memcpy(&at, base + size - 16, 8);
+  uint64_t ntc = nchunks(hdr.ntime, hdr.chunk_time);
+  uint64_t nmc = nchunks(hdr.nmember, hdr.chunk_member);
+  uint64_t room = (at >= p && at <= size - 16) ? (size - 16 - at) : 0;
+
+  if (room % sizeof(ArchiveBlock) != 0 ||
+      nmc > room / sizeof(ArchiveBlock) / nvar ||
+      ntc > room / sizeof(ArchiveBlock) / nvar / nmc ||
+      nvar * nmc * ntc * sizeof(ArchiveBlock) != room) {
+    unmap();
+    throw std::runtime_error(path + ": truncated archive");
+  }
+
+  index.resize(nvar * nmc * ntc);
+  std::memcpy(index.data(), base + at, room);
+
+  // cada bloque dentro de la zona de datos; los no comprimidos con su
+  // tamaño exacto
+  for (uint64_t v = 0; v < nvar; ++v) {
+    for (uint64_t mc = 0; mc < nmc; ++mc) {
+      for (uint64_t tc = 0; tc < ntc; ++tc) {
+        const ArchiveBlock &blk = index[ (v * nmc + mc) * ntc + tc ];
+        uint64_t nt = std::min<uint64_t>(hdr.chunk_time, hdr.ntime - tc * hdr.chunk_time);
+        uint64_t nm = std::min<uint64_t>(hdr.chunk_member, hdr.nmember - mc * hdr.chunk_member);
+
+        bool ok = (blk.offset >= p) && (blk.offset <= at) && (blk.bytes <= at - blk.offset);
+        if (blk.codec == 0) {
+          ok = ok && (blk.bytes % 8 == 0) && (blk.bytes / 8 == nt * nm);
+        } else if (blk.codec != 1) {
+          ok = false;
+        }
+        if (!ok) {
+          unmap();
+          throw std::runtime_error(path + ": truncated archive");
+        }
+      }
+    }
+  }
+}
+
+ArchiveReader::~ArchiveReader(){
+  unmap();
+}
+
+void ArchiveReader::unmap(){
+#ifdef _WIN32
+  if (base != 0) UnmapViewOfFile(base);
+  if (handle != 0) CloseHandle((HANDLE) handle);
+#else
+  if (base != 0) munmap((void*) base, size);
+#endif
+  base   = 0;
+  handle = 0;
+}
+
+int ArchiveReader::variable(const std::string &name) const {
+  for (size_t v = 0; v < hdr.names.size(); ++v) {
+    if (hdr.names[v] == name) return v;
+  }
+  return -1;
+}
+
+const ArchiveBlock& ArchiveReader::block(int var, uint64_t mc, uint64_t tc) const {
+  uint64_t ntc = nchunks(hdr.ntime, hdr.chunk_time);
+  uint64_t nmc = nchunks(hdr.nmember, hdr.chunk_member);
+  return index[ (var * nmc + mc) * ntc + tc ];
+}
+
+void ArchiveReader::read(int var,
+                         const std::vector<uint64_t> &rows,
+                         const std::vector<uint64_t> &members,
+                         double *out) const {
+  uint64_t ct = hdr.chunk_time, cm = hdr.chunk_member;
+  uint64_t nr = rows.size();
+
+  // pares (posición de salida, índice) agrupados por bloque
+  std::vector< std::pair<uint64_t, uint64_t> > r(nr), m(members.size());
+  for (uint64_t i = 0; i < nr; ++i) r[i] = std::make_pair(rows[i] / ct, i);
+  for (uint64_t j = 0; j < m.size(); ++j) m[j] = std::make_pair(members[j] / cm, j);
+  std::sort(r.begin(), r.end());
+  std::sort(m.begin(), m.end());
+
+  std::vector<double> scratch;
+  for (uint64_t a = 0; a < m.size(); ) {
+    uint64_t mc = m[a].first, a1 = a;
+    while (a1 < m.size() && m[a1].first == mc) ++a1;
+
+    for (uint64_t b = 0; b < nr; ) {
+      uint64_t tc = r[b].first, b1 = b;
+      while (b1 < nr && r[b1].first == tc) ++b1;
+
+      const ArchiveBlock &blk = block(var, mc, tc);
+      uint64_t nt = std::min(ct, hdr.ntime - tc * ct);
+      uint64_t nm = std::min(cm, hdr.nmember - mc * cm);
+
+      // los bloques sin comprimir se leen directo del mapa (sin alinear)
+      const unsigned char *raw = 0;
+      if (blk.codec == 0) {
+        raw = base + blk.offset;
+      } else {
+        scratch.resize(nt * nm);
+        archive_decode(base + blk.offset, blk.bytes, nt * nm, scratch.data());
+      }
+
+      for (uint64_t jj = a; jj < a1; ++jj) {
+        uint64_t j  = m[jj].second;
+        uint64_t lm = members[j] - mc * cm;
+        for (uint64_t ii = b; ii < b1; ++ii) {
+          uint64_t i = r[ii].second;
+          uint64_t k = (rows[i] - tc * ct) + lm * nt;
+          if (raw != 0) {
+            std::memcpy(out + i + j * nr, raw + 8 * k, 8);
+          } else {
+            out[i + j * nr] = scratch[k];
+          }
+        }
+      }
+      b = b1;
+    }
+    a = a1;
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef HBV_ARCHIVE_H
+#define HBV_ARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+// **********************************************************
+//  Chunked columnar archive for ensemble outputs. Every
+//  variable (e.g.: Qg, SWE, SM) is a time x member matrix split
+//  in (chunk_time x chunk_member) blocks, each one stored alone
+//  (column-major) and optionally compressed, so a slice only
+//  touches the blocks it overlaps. The reader maps the file in
+//  memory and decodes blocks on demand.
+//
+//  Layout (native byte order):
+//    header  : magic, version, nvar, ntime, nmember, chunk sizes,
+//              compress flag, variable names and (version 2) the
+//              tag
+//    blocks  : written as the member blocks arrive
+//    index   : offset, stored bytes and codec of every block
+//    trailer : index offset and end magic
+// **********************************************************
+
+struct ArchiveHeader {
+  std::vector<std::string> names;
+  uint64_t ntime, nmember;
+  uint32_t chunk_time, chunk_member;
+  uint32_t compress;
+  std::string tag;   // free bytes kept with the header (e.g.: a cache key)
+};
+
+struct ArchiveBlock {
+  uint64_t offset;
+  uint64_t bytes;
+  uint32_t codec;    // 0: raw doubles, 1: xor-delta + byte shuffle + zero RLE
+  uint32_t pad;
+};
+
+class ArchiveWriter {
+public:
+  ArchiveWriter(const std::string &path,
+                const ArchiveHeader &header);
+  ~ArchiveWriter();
+
+  // members [m0, m0 + nm) of every variable. m0 must be a multiple of
+  // chunk_member and nm equal to chunk_member (or the remainder).
+  // data[v] points to a ntime x nm column-major matrix with leading
+  // dimension 'ld'.
+  void write_members(uint64_t m0,
+                     uint64_t nm,
+                     const std::vector<const double*> &data,
+                     uint64_t ld);
+
+  // writes the index; returns the file size [bytes]
+  uint64_t close();
+
+private:
+  FILE *out;
+  ArchiveHeader hdr;
+  std::vector<ArchiveBlock> index;
+  std::vector<double> block;
+  std::string packed;
+  uint64_t pos, written;
+};
+
+class ArchiveReader {
+public:
+  explicit ArchiveReader(const std::string &path);
+  ~ArchiveReader();
+
+  const ArchiveHeader& header() const { return hdr; }
+  int variable(const std::string &name) const;
+
+  // out: rows.size() x members.size() column-major (0-based indices)
+  void read(int var,
+            const std::vector<uint64_t> &rows,
+            const std::vector<uint64_t> &members,
+            double *out) const;
+
+private:
+  const ArchiveBlock& block(int var, uint64_t mc, uint64_t tc) const;
+  void unmap();
+
+  ArchiveHeader hdr;
+  std::vector<ArchiveBlock> index;
+  const unsigned char *base;
+  uint64_t size;
+  void *handle;      // mapping (platform dependent)
+};
+
+// block codec (exposed for the writer and the reader)
+void archive_encode(const double *x, uint64_t n, std::string &out);
+void archive_decode(const unsigned char *src, uint64_t bytes, uint64_t n, double *x);
+
+#endif
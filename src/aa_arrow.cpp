@@ -0,0 +1,109 @@
+#include "aa_arrow.h"
+
+
+// datos privados de cada ArrowArray (padre o columna)
+struct ArrayPrivate {
+  std::shared_ptr<void> owner;
+  const void *buffers[2];
+  std::vector<struct ArrowArray*> children;
+};
+
+// datos privados de cada ArrowSchema
+struct SchemaPrivate {
+  std::string format, name;
+  std::vector<struct ArrowSchema*> children;
+};
+
+static void release_array(struct ArrowArray *array){
+  if (array == 0 || array->release == 0) return;
+
+  ArrayPrivate *priv = (ArrayPrivate*) array->private_data;
+  for (size_t k = 0; k < priv->children.size(); ++k) {
+    struct ArrowArray *child = priv->children[k];
+    // el consumidor puede haber movido (y liberado) la columna
+    if (child->release != 0) child->release(child);
+    delete child;
+  }
+  delete priv;
+
+  array->release = 0;
+}
+
+static void release_schema(struct ArrowSchema *schema){
+  if (schema == 0 || schema->release == 0) return;
+
+  SchemaPrivate *priv = (SchemaPrivate*) schema->private_data;
+  for (size_t k = 0; k < priv->children.size(); ++k) {
+    struct ArrowSchema *child = priv->children[k];
+    if (child->release != 0) child->release(child);
+    delete child;
+  }
+  delete priv;
+
+  schema->release = 0;
+}
+
+static void init_array(struct ArrowArray *array,
+                       ArrayPrivate *priv,
+                       int64_t length,
+                       int64_t n_buffers){
+  array->length       = length;
+  array->null_count   = 0;
+  array->offset       = 0;
+  array->n_buffers    = n_buffers;
+  array->n_children   = priv->children.size();
+  array->buffers      = priv->buffers;
+  array->children     = priv->children.empty() ? 0 : priv->children.data();
+  array->dictionary   = 0;
+  array->release      = release_array;
+  array->private_data = priv;
+}
+
+static void init_schema(struct ArrowSchema *schema,
+                        SchemaPrivate *priv){
+  schema->format       = priv->format.c_str();
+  schema->name         = priv->name.c_str();
+  schema->metadata     = 0;
+  schema->flags        = 0;
+  schema->n_children   = priv->children.size();
+  schema->children     = priv->children.empty() ? 0 : priv->children.data();
+  schema->dictionary   = 0;
+  schema->release      = release_schema;
+  schema->private_data = priv;
+}
+
+void arrow_export(const std::vector<ArrowColumn> &columns,
+                  int64_t length,
+                  const std::shared_ptr<void> &owner,
+                  struct ArrowArray *array,
+                  struct ArrowSchema *schema){
+  ArrayPrivate  *arr = new ArrayPrivate();
+  SchemaPrivate *sch = new SchemaPrivate();
+
+  arr->owner      = owner;
+  arr->buffers[0] = 0;    // sin máscara de validez
+  arr->buffers[1] = 0;
+  sch->format     = "+s";
+
+  for (size_t k = 0; k < columns.size(); ++k) {
+    ArrayPrivate *col = new ArrayPrivate();
+    col->owner      = owner;
+    col->buffers[0] = 0;
+    col->buffers[1] = columns[k].data;
+
+    struct ArrowArray *child = new struct ArrowArray;
+    init_array(child, col, length, 2);
+    arr->children.push_back(child);
+
+    SchemaPrivate *field = new SchemaPrivate();
+    field->format = columns[k].int32 ? "i" : "g";
+    field->name   = columns[k].name;
+
+    struct ArrowSchema *fchild = new struct ArrowSchema;
+    init_schema(fchild, field);
+    sch->children.push_back(fchild);
+  }
+
+  init_array(array, arr, length, 1);
+  init_schema(schema, sch);
+}
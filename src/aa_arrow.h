@@ -0,0 +1,73 @@
+#ifndef HBV_ARROW_H
+#define HBV_ARROW_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+// **********************************************************
+//  Arrow C data interface (https://arrow.apache.org/docs/
+//  format/CDataInterface.html). Result columns are exported
+//  as a struct array whose children point to the original
+//  buffers (no copy); 'owner' keeps them alive until the
+//  consumer calls every release callback.
+// **********************************************************
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+// column of a result table: float64 ("g") or int32 ("i")
+struct ArrowColumn {
+  std::string name;
+  const void *data;
+  bool int32;
+};
+
+// fills 'array' and 'schema' with a struct array of 'length' rows
+void arrow_export(const std::vector<ArrowColumn> &columns,
+                  int64_t length,
+                  const std::shared_ptr<void> &owner,
+                  struct ArrowArray *array,
+                  struct ArrowSchema *schema);
+
+#endif
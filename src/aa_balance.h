@@ -0,0 +1,90 @@
+#ifndef HBV_BALANCE_H
+#define HBV_BALANCE_H
+
+#include <string>
+#include <vector>
+#include "aa_core.h"
+#include "aa_partition.h"
+
+// **********************************************************
+//  Mass balance audit of a storage (SWE, SM, the routing
+//  buckets or SG), accumulated inside the time loop so the
+//  closure of a run can be checked without storing its
+//  output series.
+// **********************************************************
+
+struct StoreBalance {
+  std::string name;
+  double input;      // water that entered the storage [mm]
+  double output;     // water that left it [mm]
+  double initial;    // storage at the start of the run [mm]
+  double final;      // storage at the end of the run [mm]
+
+  StoreBalance(const std::string &name = "", double initial = 0.0) :
+    name(name), input(0.0), output(0.0), initial(initial), final(initial) {}
+
+  // closure error: input - output - (final - initial). Non-zero values come
+  // from rounding or from the model itself (e.g.: the soil moisture set to
+  // zero when SM + input - recharge - Eac < 0).
+  double error() const { return (input - output) - (final - initial); }
+};
+
+// no mass balance: the hooks of the lumped chain (aa_chain.h) compile out
+struct NoChainAudit : public NoProbe {
+  void start(int, double, double, const double*) {}
+  void snow(double, double, const double*, double) {}
+  void soil(double, double) {}
+  void finish(double, double, const double*) {}
+};
+
+// mass balance of the lumped chain: one row for the snow (SWE), one for the
+// soil (SM) and one per routing bucket (SLZ, SUZ and STZ, in initCond
+// order). It is also the probe of soil_step() and route_step(): it adds the
+// actual evapotranspiration (the Eac of Soil_HBV) and the flows of every
+// bucket, which the steps do not return. The transfer between two buckets
+// is the output of the upper one and the input of the lower one.
+struct ChainAudit : public NoProbe {
+  std::vector<StoreBalance> &bal;
+
+  explicit ChainAudit(std::vector<StoreBalance> &bal) : bal(bal) {}
+
+  void start(int routing, double SWE, double SM, const double *S){
+    static const char *bucket[3] = {"SLZ", "SUZ", "STZ"};
+
+    bal.clear();
+    bal.push_back( StoreBalance("snow", SWE) );
+    bal.push_back( StoreBalance("soil", SM) );
+    for (int k = 0; k < route_nstore(routing); ++k) {
+      bal.push_back( StoreBalance(bucket[k], S[k]) );
+    }
+  }
+
+  // snow input: rainfall and snowfall (corrected by SFCF)
+  void snow(double airT, double precip, const double *p_snow, double total){
+    SnowForcing sf = snow_partition(airT, precip, p_snow);
+    bal[0].input  += sf.Prain + sf.Psnow;
+    bal[0].output += total;
+  }
+
+  void soil(double total, double rech){
+    bal[1].input  += total;
+    bal[1].output += rech;
+  }
+
+  void evap(double Eac) { bal[1].output += Eac; }
+
+  void flux(int k, double in, double out){
+    bal[2 + k].input  += in;
+    bal[2 + k].output += out;
+  }
+
+  void finish(double SWE, double SM, const double *S){
+    bal[0].final = SWE;
+    bal[1].final = SM;
+    for (size_t k = 2; k < bal.size(); ++k) {
+      bal[k].final = S[k - 2];
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "aa_bands.h"
+#include "aa_core.h"
+#include "aa_threadpool.h"
+#include "aa_probe.h"
+
+
+// Las constantes de cada banda se calculan fuera del loop temporal, que queda
+// como una suma (o producto) sin saltos que el compilador vectoriza. Las
+// operaciones son las mismas que en Temp_model y Precip_model.
+void temp_bands(int model,
+                const double *airT,
+                int n,
+                double zmeteo,
+                const double *ztopo,
+                const double *thres,
+                int nband,
+                double gradT,
+                double *out){
+  for (int b = 0; b < nband; ++b) {
+    double dz = (model == 2 && !(ztopo[b] < thres[b])) ?
+      (ztopo[b] - thres[b]) : (ztopo[b] - zmeteo);
+    double offset = dz * (gradT / 1000);
+    double *o = out + (size_t) b * n;
+
+    for (int i = 0; i < n; ++i) {
+      o[i] = offset + airT[i];
+    }
+  }
+}
+
+void precip_bands(int model,
+                  const double *precip,
+                  int n,
+                  double zmeteo,
+                  const double *ztopo,
+                  const double *maxALT,
+                  int nband,
+                  double gradP,
+                  double *out){
+  for (int b = 0; b < nband; ++b) {
+    double z = (model == 2 && !(ztopo[b] <= maxALT[b])) ? maxALT[b] : ztopo[b];
+    double factor = 1 + (z - zmeteo) * (gradP / (100 * 100) );
+    double *o = out + (size_t) b * n;
+
+    for (int i = 0; i < n; ++i) {
+      double p = precip[i];
+      double v = std::max(factor * p, 0.0);
+      o[i] = (p == 0.0) ? 0.0 : v;
+    }
+  }
+}
+
+void band_forcing(const BandModel &m,
+                  const double *airT,
+                  const double *precip,
+                  int n,
+                  const double *ztopo,
+                  int nband,
+                  BandForcing &out){
+  out.n     = n;
+  out.nband = nband;
+  out.airT.resize( (size_t) n * nband );
+  out.precip.resize( (size_t) n * nband );
+
+  std::vector<double> thres(nband, (m.tmodel == 2) ? m.tparam[1] : 0.0);
+  std::vector<double> maxALT(nband, (m.pmodel == 2) ? m.pparam[1] : 0.0);
+
+  temp_bands(m.tmodel, airT, n, m.zmeteo[0], ztopo, thres.data(), nband,
+             m.tparam[0], out.airT.data());
+  precip_bands(m.pmodel, precip, n, m.zmeteo[1], ztopo, maxALT.data(), nband,
+               m.pparam[0], out.precip.data());
+}
+
+template<class Probe>
+static void snow_band(const BandForcing &f,
+                      int b,
+                      const double *SWE0,
+                      const double *param,
+                      double *total,
+                      double *swe,
+                      Probe &probe){
+  const double *t = f.temp(b);
+  const double *p = f.prec(b);
+  double *tot = total + (size_t) b * f.n;
+  double *s   = swe + (size_t) b * f.n;
+  double SWE  = SWE0[b];
+
+  for (int i = 0; i < f.n; ++i) {
+    tot[i] = snowmelt_step(t[i], p[i], param, SWE, probe);
+    s[i]   = SWE;
+  }
+}
+
+static void snow_band(const BandForcing &f,
+                      int b,
+                      const double *SWE0,
+                      const double *param,
+                      double *total,
+                      double *swe,
+                      StageProfile *prof){
+  if (prof == 0) {
+    NoProbe probe;
+    snow_band(f, b, SWE0, param, total, swe, probe);
+  } else {
+    // contadores y tiempo propios de la banda
+    CountProbe probe(prof[b]);
+    StageTimer t(prof[b], f.n);
+    snow_band(f, b, SWE0, param, total, swe, probe);
+  }
+}
+
+void snow_bands(const BandForcing &f,
+                const double *SWE0,
+                const double *param,
+                double *total,
+                double *swe,
+                StageProfile *prof){
+  ThreadPool &pool = shared_pool();
+
+  if (f.nband == 1 || pool.size() == 1) {
+    for (int b = 0; b < f.nband; ++b) {
+      snow_band(f, b, SWE0, param, total, swe, prof);
+    }
+    return;
+  }
+
+  // una tarea por banda (escriben columnas distintas)
+  TaskGroup group;
+  for (int b = 0; b < f.nband; ++b) {
+    pool.submit([&f, b, SWE0, param, total, swe, prof](){
+      snow_band(f, b, SWE0, param, total, swe, prof);
+    }, group);
+  }
+  group.wait();
+}
@@ -0,0 +1,75 @@
+#ifndef HBV_BANDS_H
+#define HBV_BANDS_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// **********************************************************
+//  Elevation band forcing. The station series are moved to
+//  every band once (Temp_model and Precip_model arithmetic)
+//  and stored band-major, so band 'b' is a contiguous series
+//  that the snow kernels read directly.
+// **********************************************************
+
+// Temp_model() for every band in one pass. 'thres' holds one value per band
+// (model 2) or NULL. out: n x nband (band-major)
+void temp_bands(int model,
+                const double *airT,
+                int n,
+                double zmeteo,
+                const double *ztopo,
+                const double *thres,
+                int nband,
+                double gradT,
+                double *out);
+
+// Precip_model() for every band in one pass. 'maxALT' holds one value per
+// band (model 2) or NULL. out: n x nband (band-major)
+void precip_bands(int model,
+                  const double *precip,
+                  int n,
+                  double zmeteo,
+                  const double *ztopo,
+                  const double *maxALT,
+                  int nband,
+                  double gradP,
+                  double *out);
+
+struct BandForcing {
+  int n, nband;
+  std::vector<double> airT, precip;   // band-major (n x nband)
+
+  const double* temp(int b) const { return airT.data() + (size_t) b * n; }
+  const double* prec(int b) const { return precip.data() + (size_t) b * n; }
+};
+
+// models and parameters of Temp_model and Precip_model
+struct BandModel {
+  int tmodel, pmodel;
+  double zmeteo[2];             // temperature sensor and precipitation gauge [masl]
+  std::vector<double> tparam, pparam;
+};
+
+void band_forcing(const BandModel &m,
+                  const double *airT,
+                  const double *precip,
+                  int n,
+                  const double *ztopo,
+                  int nband,
+                  BandForcing &out);
+
+struct StageProfile;
+
+// snowmelt_step() over every band (one task per band on the shared pool).
+// SWE0: one value per band. total and swe: n x nband (band-major).
+// prof: NULL or one StageProfile per band (wall time and melt counters,
+// see aa_probe.h)
+void snow_bands(const BandForcing &f,
+                const double *SWE0,
+                const double *param,
+                double *total,
+                double *swe,
+                StageProfile *prof = 0);
+
+#endif
@@ -0,0 +1,114 @@
+#include <cstring>
+#include "aa_cache.h"
+
+
+std::shared_ptr<StageSeries> StageCache::get(const std::string &key, double state0, int n){
+  return LruCache< std::shared_ptr<StageSeries> >::get(key, [state0, n](){
+    std::shared_ptr<StageSeries> entry(new StageSeries);
+    entry->out.resize(n);
+    entry->done  = 0;
+    entry->state = state0;
+    return entry;
+  });
+}
+
+// mezcla de 64 bits (splitmix64)
+static inline uint64_t mix64(uint64_t h, uint64_t x){
+  h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  return h;
+}
+
+static inline uint64_t hash_series(uint64_t h, const double *x, int n){
+  uint64_t bits;
+  for (int i = 0; i < n; ++i) {
+    std::memcpy(&bits, x + i, sizeof(bits));
+    h = mix64(h, bits);
+  }
+  return h;
+}
+
+uint64_t forcing_fingerprint(const Forcing &f){
+  uint64_t h = mix64(0, (uint64_t) f.n);
+  h = hash_series(h, f.airT, f.n);
+  h = hash_series(h, f.precip, f.n);
+  h = hash_series(h, f.pet, f.n);
+  h = hash_series(h, f.obs, f.n);
+  return h;
+}
+
+std::string eval_key(int routing,
+                     uint64_t fingerprint,
+                     const double *initCond,
+                     int ninit,
+                     const double *param,
+                     int nparam){
+  std::string key;
+  key.reserve(sizeof(int) + sizeof(uint64_t) + (ninit + nparam) * sizeof(double));
+  key.append((const char*) &routing, sizeof(int));
+  key.append((const char*) &fingerprint, sizeof(uint64_t));
+  key.append((const char*) initCond, ninit * sizeof(double));
+  key.append((const char*) param, nparam * sizeof(double));
+  return key;
+}
+
+std::string stage_key(const std::string &upstream,
+                      double state0,
+                      const double *param,
+                      int nparam){
+  std::string key(upstream);
+  key.append((const char*) &state0, sizeof(double));
+  key.append((const char*) param, nparam * sizeof(double));
+  return key;
+}
+
+std::string band_key(const BandModel &m,
+                     const double *airT,
+                     const double *precip,
+                     int n,
+                     const double *ztopo,
+                     int nband){
+  uint64_t fp = mix64(0, (uint64_t) n);
+  fp = hash_series(fp, airT, n);
+  fp = hash_series(fp, precip, n);
+
+  std::string key;
+  key.append((const char*) &m.tmodel, sizeof(int));
+  key.append((const char*) &m.pmodel, sizeof(int));
+  key.append((const char*) &fp, sizeof(uint64_t));
+  key.append((const char*) m.zmeteo, 2 * sizeof(double));
+  key.append((const char*) m.tparam.data(), m.tparam.size() * sizeof(double));
+  key.append((const char*) m.pparam.data(), m.pparam.size() * sizeof(double));
+  key.append((const char*) ztopo, nband * sizeof(double));
+  return key;
+}
+
+uint64_t key_hash(const std::string &key){
+  uint64_t h = mix64(0, key.size());
+  for (size_t i = 0; i < key.size(); ++i) {
+    h = mix64(h, (unsigned char) key[i]);
+  }
+  return h;
+}
+
+EvalCache& objective_cache(){
+  static EvalCache cache(1024);
+  return cache;
+}
+
+StageCache& snow_cache(){
+  static StageCache cache(8);
+  return cache;
+}
+
+StageCache& soil_cache(){
+  static StageCache cache(8);
+  return cache;
+}
+
+BandCache& band_cache(){
+  static BandCache cache(4);
+  return cache;
+}
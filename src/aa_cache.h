@@ -0,0 +1,205 @@
+#ifndef HBV_CACHE_H
+#define HBV_CACHE_H
+
+#include <list>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <stdint.h>
+#include "aa_pipeline.h"
+#include "aa_bands.h"
+
+// **********************************************************
+//  Least recently used caches: objective function values,
+//  stage output series and elevation band forcing. Keys hold
+//  the bit pattern of the routing model, initial conditions
+//  and parameters plus a fingerprint of the forcing.
+// **********************************************************
+
+// thread-safe LRU map from keys to values of type V
+template<class V>
+class LruCache {
+public:
+  explicit LruCache(size_t capacity) : cap(capacity), n_hit(0), n_miss(0) {}
+
+  // true on hit (the entry moves to the front). 'accept' can turn an
+  // existing entry into a miss.
+  template<class Accept>
+  bool find(const std::string &key, V &value, Accept accept){
+    std::lock_guard<std::mutex> lock(mtx);
+
+    typename index_map::iterator it = index.find(key);
+    if (it == index.end() || !accept(it->second->second)) {
+      ++n_miss;
+      return false;
+    }
+
+    items.splice(items.begin(), items, it->second);
+    value = it->second->second;
+    ++n_hit;
+    return true;
+  }
+
+  bool find(const std::string &key, V &value){
+    return find(key, value, [](const V&){ return true; });
+  }
+
+  // cached value of 'key' or, on a miss, make() (stored unless the capacity
+  // is zero). Lookup and insertion are one step.
+  template<class Make>
+  V get(const std::string &key, Make make){
+    std::lock_guard<std::mutex> lock(mtx);
+
+    typename index_map::iterator it = index.find(key);
+    if (it != index.end()) {
+      items.splice(items.begin(), items, it->second);
+      ++n_hit;
+      return it->second->second;
+    }
+    ++n_miss;
+
+    V value = make();
+    if (cap > 0) put(key, value);
+    return value;
+  }
+
+  void insert(const std::string &key, const V &value){
+    std::lock_guard<std::mutex> lock(mtx);
+    if (cap == 0) return;
+
+    typename index_map::iterator it = index.find(key);
+    if (it != index.end()) {
+      it->second->second = value;
+      items.splice(items.begin(), items, it->second);
+      return;
+    }
+    put(key, value);
+  }
+
+  void clear(){
+    std::lock_guard<std::mutex> lock(mtx);
+    items.clear();
+    index.clear();
+    n_hit  = 0;
+    n_miss = 0;
+  }
+
+  void resize(size_t capacity){
+    std::lock_guard<std::mutex> lock(mtx);
+    cap = capacity;
+    trim();
+  }
+
+  size_t hits()     { std::lock_guard<std::mutex> lock(mtx); return n_hit; }
+  size_t misses()   { std::lock_guard<std::mutex> lock(mtx); return n_miss; }
+  size_t size()     { std::lock_guard<std::mutex> lock(mtx); return items.size(); }
+  size_t capacity() { std::lock_guard<std::mutex> lock(mtx); return cap; }
+
+private:
+  typedef std::list< std::pair<std::string, V> > item_list;
+  typedef std::unordered_map<std::string, typename item_list::iterator> index_map;
+
+  void put(const std::string &key, const V &value){
+    items.push_front(std::make_pair(key, value));
+    index[key] = items.begin();
+    trim();
+  }
+
+  void trim(){
+    while (items.size() > cap) {
+      index.erase(items.back().first);
+      items.pop_back();
+    }
+  }
+
+  std::mutex mtx;
+  size_t cap, n_hit, n_miss;
+  item_list items;
+  index_map index;
+};
+
+class EvalCache : public LruCache<Objective> {
+public:
+  explicit EvalCache(size_t capacity) : LruCache<Objective>(capacity) {}
+
+  // true on hit. A pruned entry only answers when it is still a
+  // proof for the new bound (its partial sum exceeds it).
+  bool find(const std::string &key, double bound, Objective &res){
+    return LruCache<Objective>::find(key, res, [bound](const Objective &o){
+      return !o.pruned || o.sse > bound;
+    });
+  }
+};
+
+// Output series of a single model stage (e.g.: snowmelt Total) for a
+// given upstream key. A pruned evaluation leaves it partially filled;
+// 'state' is the stage state after 'done' steps, so the next user
+// resumes from there.
+struct StageSeries {
+  std::mutex mtx;
+  std::vector<double> out;
+  int done;
+  double state;
+};
+
+// LRU of stage outputs (SnowGlacier_HBV and Soil_HBV in the pipeline)
+class StageCache : public LruCache< std::shared_ptr<StageSeries> > {
+public:
+  explicit StageCache(size_t capacity) : LruCache< std::shared_ptr<StageSeries> >(capacity) {}
+
+  // cached series for 'key' or a new empty one starting at 'state0'
+  std::shared_ptr<StageSeries> get(const std::string &key, double state0, int n);
+};
+
+// LRU of elevation band forcing (Bands_HBV). Entries are read-only and
+// shared by every run that uses the same gradients and bands.
+class BandCache : public LruCache< std::shared_ptr<const BandForcing> > {
+public:
+  explicit BandCache(size_t capacity) : LruCache< std::shared_ptr<const BandForcing> >(capacity) {}
+
+  // NULL on a miss
+  std::shared_ptr<const BandForcing> find(const std::string &key){
+    std::shared_ptr<const BandForcing> bands;
+    LruCache< std::shared_ptr<const BandForcing> >::find(key, bands);
+    return bands;
+  }
+};
+
+// 64 bit fingerprint of the forcing series (values and length)
+uint64_t forcing_fingerprint(const Forcing &f);
+
+// key for a single evaluation
+std::string eval_key(int routing,
+                     uint64_t fingerprint,
+                     const double *initCond,
+                     int ninit,
+                     const double *param,
+                     int nparam);
+
+// key of a stage: upstream key plus initial state and stage parameters
+std::string stage_key(const std::string &upstream,
+                      double state0,
+                      const double *param,
+                      int nparam);
+
+// key of the band forcing: station series, models, gradients and band elevations
+std::string band_key(const BandModel &m,
+                     const double *airT,
+                     const double *precip,
+                     int n,
+                     const double *ztopo,
+                     int nband);
+
+// 64 bit hash of a key (e.g.: file names)
+uint64_t key_hash(const std::string &key);
+
+// process-wide caches in front of Objective_HBV
+EvalCache& objective_cache();
+StageCache& snow_cache();
+StageCache& soil_cache();
+BandCache& band_cache();
+
+#endif
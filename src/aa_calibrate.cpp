@@ -0,0 +1,270 @@
+#include <cmath>
+#include <ctime>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+#include "aa_calibrate.h"
+#include "aa_cache.h"
+#include "aa_threadpool.h"
+
+
+// reflejo en los límites (DDS)
+static double reflect(double x, double lo, double hi){
+  if (x < lo) {
+    x = lo + (lo - x);
+    if (x > hi) x = lo;
+  } else if (x > hi) {
+    x = hi - (x - hi);
+    if (x < lo) x = hi;
+  }
+  return x;
+}
+
+void calibrate_dds(const BasinConfig &cfg,
+                   BasinResult &res,
+                   JobControl *control,
+                   int unit){
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  Forcing f   = cfg.forcing->view();
+  int np      = cfg.lower.size();
+  double r    = 0.2;
+  std::mt19937_64 rng(cfg.seed);
+  std::uniform_real_distribution<double> unif(0.0, 1.0);
+  std::normal_distribution<double> norm(0.0, 1.0);
+
+  // caches de etapa propios de la cuenca (DDS cambia pocas dimensiones)
+  StageCache snow_memo(2), soil_memo(2);
+
+  // dimensiones libres
+  std::vector<int> free_dim;
+  for (int j = 0; j < np; ++j) {
+    if (cfg.upper[j] > cfg.lower[j]) free_dim.push_back(j);
+  }
+
+  // solución inicial: centro del dominio
+  std::vector<double> best(np), cand(np);
+  for (int j = 0; j < np; ++j) {
+    best[j] = 0.5 * (cfg.lower[j] + cfg.upper[j]);
+  }
+
+  res.evaluations = 0;
+  res.pruned      = 0;
+  res.cancelled   = false;
+  res.error.clear();
+
+  const char *msg = pipeline_check(cfg.routing, best.data());
+  if (msg != 0) {
+    res.error = std::string("initial solution (bounds midpoint): ") + msg;
+    res.sse   = NAN;
+    res.param = best;
+    res.seconds = 0.0;
+    return;
+  }
+
+  Objective obj;
+  pipeline_sse_memo(cfg.routing, f, cfg.forcing->fingerprint, cfg.initCond.data(),
+                    best.data(), INFINITY, obj, snow_memo, soil_memo);
+  double f_best = obj.sse;
+  res.evaluations = 1;
+  if (control != 0) {
+    control->count();
+    control->improve(unit, f_best);
+  }
+
+  int nfree = free_dim.size();
+  for (int i = 1; i < cfg.maxEval && nfree > 0; ++i) {
+    // la cancelación se revisa entre corridas del modelo
+    if (control != 0 && control->cancelled()) {
+      res.cancelled = true;
+      break;
+    }
+
+    double P = 1.0 - std::log((double) i) / std::log((double) cfg.maxEval);
+
+    // perturbo un subconjunto de dimensiones
+    cand = best;
+    int moved = 0;
+    for (int k = 0; k < nfree; ++k) {
+      if (unif(rng) < P) {
+        int j   = free_dim[k];
+        cand[j] = reflect(best[j] + r * (cfg.upper[j] - cfg.lower[j]) * norm(rng),
+                          cfg.lower[j], cfg.upper[j]);
+        ++moved;
+      }
+    }
+    if (moved == 0) {
+      int j   = free_dim[ std::min( (int) (unif(rng) * nfree), nfree - 1 ) ];
+      cand[j] = reflect(best[j] + r * (cfg.upper[j] - cfg.lower[j]) * norm(rng),
+                        cfg.lower[j], cfg.upper[j]);
+    }
+
+    // candidatos que violan las restricciones del modelo se descartan
+    if (pipeline_check(cfg.routing, cand.data()) != 0) {
+      continue;
+    }
+
+    pipeline_sse_memo(cfg.routing, f, cfg.forcing->fingerprint, cfg.initCond.data(),
+                      cand.data(), f_best, obj, snow_memo, soil_memo);
+    ++res.evaluations;
+    if (control != 0) control->count();
+
+    if (obj.pruned) {
+      ++res.pruned;
+    } else if (obj.sse <= f_best) {
+      f_best = obj.sse;
+      best   = cand;
+      if (control != 0) control->improve(unit, f_best);
+    }
+  }
+
+  res.param   = best;
+  res.sse     = f_best;
+  res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// campo de texto csv: comillas dobles y las internas duplicadas
+static std::string csv_quote(const std::string &x){
+  std::string out = "\"";
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (x[i] == '"') out += '"';
+    out += x[i];
+  }
+  return out + "\"";
+}
+
+// 'np': columnas de parámetros del archivo (las que faltan van como NA)
+static void write_result(FILE *out,
+                         const BasinConfig &cfg,
+                         const BasinResult &res,
+                         int np){
+  std::fprintf(out, "%s,%d,%.17g,%d,%d,%.3f,%s",
+               csv_quote(cfg.name).c_str(), cfg.routing, res.sse, res.evaluations,
+               res.pruned, res.seconds, csv_quote(res.error).c_str());
+  for (int j = 0; j < np; ++j) {
+    if (j < (int) res.param.size()) {
+      std::fprintf(out, ",%.17g", res.param[j]);
+    } else {
+      std::fprintf(out, ",NA");
+    }
+  }
+  std::fprintf(out, "\n");
+  std::fflush(out);
+}
+
+static double planned_evaluations(const std::vector<BasinConfig> &basins){
+  double total = 0.0;
+  for (size_t b = 0; b < basins.size(); ++b) total += basins[b].maxEval;
+  return total;
+}
+
+CalibrationJob::CalibrationJob(const std::vector<BasinConfig> &basins) :
+  Job(basins.size(), planned_evaluations(basins)), basins(basins), results(basins.size()),
+  next(0), running(0), out(0), nparam(0) {}
+
+// toma cuencas hasta que no quedan; el último en salir cierra el archivo
+static void calibrate_runner(std::shared_ptr<CalibrationJob> job){
+  int nb = job->basins.size();
+
+  for (int k = job->next++; k < nb; k = job->next++) {
+    int b = job->order[k];
+    BasinResult &res = job->results[b];
+
+    if (job->control.cancelled()) {
+      // cuenca sin empezar
+      res.cancelled = true;
+      job->control.finish();
+      continue;
+    }
+
+    try {
+      calibrate_dds(job->basins[b], res, &job->control, b);
+    } catch (std::exception &e) {
+      res.sse   = NAN;
+      res.error = e.what();
+    }
+    job->control.finish();
+
+    if (job->out != 0) {
+      std::lock_guard<std::mutex> lock(job->out_mtx);
+      write_result(job->out, job->basins[b], res, job->nparam);
+    }
+  }
+
+  if (--job->running == 0 && job->out != 0) {
+    std::fclose(job->out);
+    job->out = 0;
+  }
+}
+
+void calibrate_start(const std::shared_ptr<CalibrationJob> &job,
+                     ThreadPool &pool,
+                     int nthreads,
+                     const std::string &file){
+  const std::vector<BasinConfig> &basins = job->basins;
+  int nb = basins.size();
+
+  if (!file.empty()) {
+    // tantas columnas de parámetros como el modelo de reservorios más largo
+    job->nparam = 0;
+    for (int b = 0; b < nb; ++b) {
+      job->nparam = std::max(job->nparam, pipeline_nparam(basins[b].routing));
+    }
+
+    job->out = std::fopen(file.c_str(), "w");
+    if (job->out == 0) {
+      throw std::runtime_error("can not open the output file: " + file);
+    }
+    std::fprintf(job->out, "basin,routing,SSE,evaluations,pruned,seconds,error");
+    for (int j = 1; j <= job->nparam; ++j) std::fprintf(job->out, ",p%d", j);
+    std::fprintf(job->out, "\n");
+    std::fflush(job->out);
+  }
+
+  // las cuencas más costosas primero
+  std::vector<int> &order = job->order;
+  order.resize(nb);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&basins](int a, int b){
+    return (double) basins[a].forcing->airT.size() * basins[a].maxEval >
+           (double) basins[b].forcing->airT.size() * basins[b].maxEval;
+  });
+
+  // 'nthreads' tareas del pool toman las cuencas en orden
+  int nrun = (nthreads > 0) ? nthreads : pool.size();
+  nrun     = std::min(nrun, nb);
+
+  if (nrun == 0 && job->out != 0) {
+    std::fclose(job->out);
+    job->out = 0;
+  }
+
+  job->running = nrun;
+  for (int r = 0; r < nrun; ++r) {
+    pool.submit([job](){ calibrate_runner(job); }, job->group);
+  }
+}
+
+void calibrate_batch(const std::vector<BasinConfig> &basins,
+                     int nthreads,
+                     const std::string &file,
+                     std::vector<BasinResult> &results){
+  std::shared_ptr<CalibrationJob> job = std::make_shared<CalibrationJob>(basins);
+  calibrate_start(job, shared_pool(), nthreads, file);
+
+  // espero en intervalos cortos para atender las interrupciones de R. Las
+  // tareas sólo usan el trabajo (que conservan), así que al interrumpir
+  // basta con cancelarlo: cada una termina con la corrida en curso.
+  while ( !job->group.wait_for(0.1) ) {
+    if ( interrupt_pending() ) {
+      job->control.cancel();
+      throw Interrupted();
+    }
+  }
+
+  results.swap(job->results);
+}
@@ -0,0 +1,85 @@
+#ifndef HBV_CALIBRATE_H
+#define HBV_CALIBRATE_H
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "aa_pipeline.h"
+#include "aa_jobs.h"
+
+// **********************************************************
+//  Dynamically Dimensioned Search (Tolson & Shoemaker, 2007)
+//  over the lumped pipeline, and a scheduler that calibrates
+//  many basins at once on the shared work-stealing thread pool.
+// **********************************************************
+
+// shared, read-only forcing of a catchment (see Forcing_HBV)
+typedef std::shared_ptr<const ForcingData> ForcingHandle;
+
+struct BasinConfig {
+  std::string name;
+  ForcingHandle forcing;
+  int routing;
+  std::vector<double> initCond;
+  std::vector<double> lower, upper;
+  int maxEval;
+  uint64_t seed;
+};
+
+struct BasinResult {
+  std::vector<double> param;
+  double sse;
+  int evaluations;   // model runs
+  int pruned;        // runs stopped by the best value so far
+  double seconds;
+  std::string error; // empty when the calibration succeeded
+  bool cancelled;    // stopped by JobControl::cancel()
+
+  BasinResult() : sse(NAN), evaluations(0), pruned(0), seconds(0.0), cancelled(false) {}
+};
+
+// single basin (DDS, neighbourhood size r = 0.2). With a 'control' every
+// model run is counted as progress of 'unit' and the search stops (keeping
+// the best solution so far) once the job is cancelled.
+void calibrate_dds(const BasinConfig &cfg,
+                   BasinResult &res,
+                   JobControl *control = 0,
+                   int unit = 0);
+
+// all basins, at most 'nthreads' at a time (<= 0: the size of the shared
+// pool). Throws Interrupted when the user interrupts the R session. When 'file' is not empty every result is appended to it (csv) as
+// soon as the basin finishes, with one column per parameter of the longest
+// parameter vector (NA for the shorter ones).
+void calibrate_batch(const std::vector<BasinConfig> &basins,
+                     int nthreads,
+                     const std::string &file,
+                     std::vector<BasinResult> &results);
+
+// the same batch as a background job (see Calibrate_HBV(async = TRUE))
+struct CalibrationJob : public Job {
+  explicit CalibrationJob(const std::vector<BasinConfig> &basins);
+
+  std::vector<BasinConfig> basins;
+  std::vector<BasinResult> results;
+
+  // scheduling state of the runner tasks
+  std::vector<int> order;
+  std::atomic<int> next, running;
+  FILE *out;
+  int nparam;         // parameter columns of the output file
+  std::mutex out_mtx;
+};
+
+// submits the runner tasks to 'pool' (job_pool() for the background jobs)
+// and returns at once; job->group.wait() blocks until every basin has
+// finished. Throws std::runtime_error when 'file' can not be opened
+// (before any task starts).
+void calibrate_start(const std::shared_ptr<CalibrationJob> &job,
+                     ThreadPool &pool,
+                     int nthreads,
+                     const std::string &file);
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef HBV_CHAIN_H
+#define HBV_CHAIN_H
+
+#include <algorithm>
+#include <cmath>
+#include "aa_core.h"
+#include "aa_pipeline.h"
+#include "aa_output.h"
+#include "aa_balance.h"
+
+// **********************************************************
+//  The four stages of the lumped chain (see aa_pipeline.h)
+//  and their states, written once for every run of it: the
+//  single loop, the objective function, the audited run
+//  (pipeline_run below) and the profiled and pipelined runs,
+//  which step the same stages chunk by chunk.
+//
+//  Probe: counters of every stage (NoProbe or CountProbe,
+//  see aa_probe.h). Audit: NoChainAudit or ChainAudit (mass
+//  balance of the storages, see aa_balance.h).
+// **********************************************************
+
+// forwards the hooks of a step to the stage probe and to the audit
+template<class Probe, class Audit>
+struct ChainProbe {
+  Probe &p;
+  Audit &a;
+
+  ChainProbe(Probe &p, Audit &a) : p(p), a(a) {}
+
+  void melt(bool m)     { p.melt(m); a.melt(m); }
+  void overflow()       { p.overflow(); a.overflow(); }
+  void evap(double Eac) { p.evap(Eac); a.evap(Eac); }
+  void uzl()            { p.uzl(); a.uzl(); }
+  void perc()           { p.perc(); a.perc(); }
+  void flux(int k, double in, double out) { p.flux(k, in, out); a.flux(k, in, out); }
+};
+
+template<class Probe = NoProbe, class Audit = NoChainAudit>
+struct PipelineChain {
+  int routing;
+  const double *p_snow, *p_soil, *p_route;
+
+  // states
+  double SWE, SM;
+  double S[3];       // SLZ, SUZ, STZ
+  UHState uh;
+
+  Probe snow_probe, soil_probe, route_probe;
+  Audit audit;
+
+  PipelineChain(int routing,
+                const double *initCond,
+                const double *param,
+                const Audit &audit = Audit()) :
+    routing(routing), audit(audit) {
+    init(initCond, param);
+  }
+
+  PipelineChain(int routing,
+                const double *initCond,
+                const double *param,
+                const Probe &snow,
+                const Probe &soil,
+                const Probe &route,
+                const Audit &audit = Audit()) :
+    routing(routing), snow_probe(snow), soil_probe(soil), route_probe(route),
+    audit(audit) {
+    init(initCond, param);
+  }
+
+  // SnowGlacier_HBV (model 1, soil): returns Total
+  double snow(const Forcing &f, int i){
+    double total = snowmelt_step(f.airT[i], f.precip[i], p_snow, SWE, snow_probe);
+    audit.snow(f.airT[i], f.precip[i], p_snow, total);
+    return total;
+  }
+
+  // Soil_HBV (model 1): returns Rech
+  double soil(const Forcing &f, int i, double total){
+    ChainProbe<Probe, Audit> probe(soil_probe, audit);
+    double rech = soil_step(total, f.pet[i], p_soil, SM, probe);
+    audit.soil(total, rech);
+    return rech;
+  }
+
+  // Routing_HBV without lake: returns Qg
+  double route(double rech){
+    ChainProbe<Probe, Audit> probe(route_probe, audit);
+    return route_step(routing, rech, p_route, S, probe);
+  }
+
+  // UH (model 1): returns Qsim
+  double transfer(double Qg){
+    return uh.step(Qg);
+  }
+
+  // the stages over the time steps i0 .. i0 + m - 1, one after the other
+  // (profiled and pipelined runs)
+  void snow_chunk(const Forcing &f, int i0, int m, double *total, double *swe){
+    for (int k = 0; k < m; ++k) {
+      total[k] = snow(f, i0 + k);
+      swe[k]   = SWE;
+    }
+  }
+
+  void soil_chunk(const Forcing &f, int i0, int m, const double *total,
+                  double *rech, double *sm){
+    for (int k = 0; k < m; ++k) {
+      rech[k] = soil(f, i0 + k, total[k]);
+      sm[k]   = SM;
+    }
+  }
+
+  void route_chunk(int m, const double *rech, double *Qg){
+    for (int k = 0; k < m; ++k) {
+      Qg[k] = route(rech[k]);
+    }
+  }
+
+  void transfer_chunk(int i0, int m, const double *swe, const double *sm,
+                      const double *rech, const double *Qg, OutputSink &out){
+    for (int k = 0; k < m; ++k) {
+      double Q = transfer(Qg[k]);
+
+      out(i0 + k, 0) = swe[k];
+      out(i0 + k, 1) = sm[k];
+      out(i0 + k, 2) = rech[k];
+      out(i0 + k, 3) = Qg[k];
+      out(i0 + k, 4) = Q;
+    }
+  }
+
+  // final storages into the audit
+  void finish(){
+    audit.finish(SWE, SM, S);
+  }
+
+private:
+  void init(const double *initCond, const double *param){
+    p_snow  = param;
+    p_soil  = param + 4;
+    p_route = param + 7;
+
+    SWE  = initCond[0];
+    SM   = std::min(initCond[1], p_soil[0]);
+    S[0] = S[1] = S[2] = 0.0;
+    for (int k = 0; k < route_nstore(routing); ++k) {
+      S[k] = initCond[2 + k];
+    }
+    uh.reset(param[pipeline_nparam(routing) - 1]);
+
+    audit.start(routing, SWE, SM, S);
+  }
+};
+
+// every time step into the output: SWE, SM, Rech, Qg and Qsim
+struct SinkEmit {
+  OutputSink &out;
+
+  explicit SinkEmit(OutputSink &out) : out(out) {}
+
+  bool operator()(int i, double SWE, double SM, double rech, double Qg, double Q){
+    out(i, 0) = SWE;
+    out(i, 1) = SM;
+    out(i, 2) = rech;
+    out(i, 3) = Qg;
+    out(i, 4) = Q;
+    return true;
+  }
+};
+
+// sum of squared errors against the observed discharge (NaN: missing). It
+// stops the loop as soon as the partial sum exceeds 'bound' (it can only
+// grow from there on).
+struct SseEmit {
+  const double *obs;
+  double bound;
+  double sse;
+  bool pruned;
+
+  SseEmit(const double *obs, double bound) :
+    obs(obs), bound(bound), sse(0.0), pruned(false) {}
+
+  bool operator()(int i, double, double, double, double, double Q){
+    if (!std::isnan(obs[i])) {
+      double e = Q - obs[i];
+      sse += e * e;
+
+      if (sse > bound) {
+        pruned = true;
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// the whole chain in a single time loop. 'emit' gets every time step and
+// returns false to stop the loop. Returns the time steps run.
+template<class Probe, class Audit, class Emit>
+int pipeline_run(PipelineChain<Probe, Audit> &c,
+                 const Forcing &f,
+                 Emit &emit){
+  int i = 0;
+  while (i < f.n) {
+    double total = c.snow(f, i);
+    double rech  = c.soil(f, i, total);
+    double Qg    = c.route(rech);
+    double Q     = c.transfer(Qg);
+
+    bool more = emit(i, c.SWE, c.SM, rech, Qg, Q);
+    ++i;
+    if (!more) break;
+  }
+  c.finish();
+
+  return i;
+}
+
+#endif
@@ -0,0 +1,484 @@
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include "aa_cluster.h"
+#include "aa_cache.h"
+#include "aa_threadpool.h"
+
+
+static const uint32_t CLUSTER_MAGIC = 0x48425643;   // "HBVC"
+static const double CLUSTER_PROBE   = 1.0 / 3.0;
+
+// tamaño máximo de un mensaje (1 GiB: un forzante de unos 30 millones de
+// pasos); un encabezado mayor es un error, no una reserva de memoria
+static const uint64_t CLUSTER_MAX_PAYLOAD = (uint64_t) 1 << 30;
+
+struct MessageHeader {
+  uint32_t magic;
+  uint32_t type;
+  uint64_t size;
+};
+
+// armado y lectura de los mensajes
+class Packer {
+public:
+  template <class T> void put(T x){
+    const char *p = (const char*) &x;
+    buf.insert(buf.end(), p, p + sizeof(T));
+  }
+  void put(const double *x, size_t n){
+    const char *p = (const char*) x;
+    buf.insert(buf.end(), p, p + n * sizeof(double));
+  }
+  void put(const std::string &s){
+    put<uint32_t>(s.size());
+    buf.insert(buf.end(), s.begin(), s.end());
+  }
+
+  std::vector<char> buf;
+};
+
+class Unpacker {
+public:
+  explicit Unpacker(const std::vector<char> &buf) : buf(buf), pos(0) {}
+
+  template <class T> T get(){
+    T x;
+    take(&x, sizeof(T));
+    return x;
+  }
+  void get(double *x, size_t n){
+    take(x, n * sizeof(double));
+  }
+  std::string text(){
+    uint32_t n = get<uint32_t>();
+    if (n > left()) {
+      throw std::runtime_error("truncated cluster message");
+    }
+    std::string s(n, ' ');
+    take(&s[0], n);
+    return s;
+  }
+
+  // bytes sin leer
+  size_t left() const { return buf.size() - pos; }
+
+private:
+  void take(void *x, size_t n){
+    if (pos + n > buf.size()) {
+      throw std::runtime_error("truncated cluster message");
+    }
+    std::memcpy(x, buf.data() + pos, n);
+    pos += n;
+  }
+
+  const std::vector<char> &buf;
+  size_t pos;
+};
+
+static void send_message(Socket &s, uint32_t type, const std::vector<char> &body){
+  MessageHeader h;
+  h.magic = CLUSTER_MAGIC;
+  h.type  = type;
+  h.size  = body.size();
+  s.send_all(&h, sizeof(h));
+  if (!body.empty()) {
+    s.send_all(body.data(), body.size());
+  }
+}
+
+// false cuando el otro extremo cerró la conexión
+static bool recv_message(Socket &s, uint32_t &type, std::vector<char> &body){
+  MessageHeader h;
+  if (!s.recv_all(&h, sizeof(h))) {
+    return false;
+  }
+  if (h.magic != CLUSTER_MAGIC) {
+    throw std::runtime_error("unexpected data on the cluster connection");
+  }
+  if (h.size > CLUSTER_MAX_PAYLOAD) {
+    throw std::runtime_error("cluster message too large");
+  }
+  type = h.type;
+  body.resize(h.size);
+  if (h.size > 0 && !s.recv_all(body.data(), h.size)) {
+    throw std::runtime_error("connection lost while receiving");
+  }
+  return true;
+}
+
+// **********************************************************
+//  coordinador
+// **********************************************************
+Cluster::Cluster(const std::string &host, int port) : server( Socket::listen(host, port) ) {}
+
+Cluster::~Cluster(){
+  try {
+    shutdown();
+  } catch (...) {
+    // los trabajadores también terminan al cerrarse la conexión
+  }
+}
+
+// índice del primer socket con datos, -1 después de 'timeout' [s]. Espera en
+// intervalos cortos para atender las interrupciones de R.
+static int wait_any(const std::vector<Socket*> &watch, double timeout){
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (;;) {
+    double left = timeout - std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    int k = Socket::wait(watch, std::max(0.0, std::min(left, 0.1)));
+    if (k >= 0 || left <= 0.1) {
+      return k;
+    }
+    if (interrupt_pending()) {
+      throw Interrupted();
+    }
+  }
+}
+
+// saludo del trabajador recién conectado
+static bool hello(Socket &s, double timeout){
+  std::vector<Socket*> self(1, &s);
+  if (wait_any(self, timeout) < 0) {
+    return false;
+  }
+
+  uint32_t type;
+  std::vector<char> body;
+  if (!recv_message(s, type, body) || type != MSG_HELLO) {
+    return false;
+  }
+  Unpacker in(body);
+  return in.get<double>() == CLUSTER_PROBE;
+}
+
+bool Cluster::accept(int n, double timeout){
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  while ( (int) peers.size() < n ) {
+    double left = timeout - std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (left <= 0.0) {
+      return false;
+    }
+
+    std::vector<Socket*> self(1, &server);
+    if (wait_any(self, left) < 0) {
+      return false;
+    }
+
+    Socket s = server.accept(0.0);
+    if (!s.valid()) {
+      continue;
+    }
+    try {
+      if (!hello(s, left)) continue;
+    } catch (Interrupted &) {
+      throw;
+    } catch (std::exception &) {
+      continue;
+    }
+
+    std::unique_ptr<Peer> p(new Peer);
+    p->socket = std::move(s);
+    peers.push_back( std::move(p) );
+  }
+
+  return true;
+}
+
+void Cluster::drop(int k){
+  peers.erase(peers.begin() + k);
+}
+
+void Cluster::evaluate(const ForcingHandle &forcing,
+                       int routing,
+                       const std::vector<double> &initCond,
+                       const double *param,
+                       int nset,
+                       int npar,
+                       int chunk,
+                       double timeout,
+                       double *sse){
+  uint64_t fp  = forcing->fingerprint;
+  int nchunk   = (nset + chunk - 1) / chunk;
+  int left     = nchunk;
+
+  // un juego de parámetros contiguo por fila
+  std::vector<double> sets( (size_t) nset * npar );
+  for (int s = 0; s < nset; ++s) {
+    for (int j = 0; j < npar; ++j) {
+      sets[(size_t) s * npar + j] = param[s + (size_t) j * nset];
+    }
+  }
+
+  std::deque<int> todo;
+  for (int c = 0; c < nchunk; ++c) todo.push_back(c);
+
+  // hasta dos tramos en vuelo por trabajador
+  auto dispatch = [&](Peer &p){
+    while (p.inflight.size() < 2 && !todo.empty()) {
+      int c     = todo.front();
+      int first = c * chunk;
+      int count = std::min(chunk, nset - first);
+
+      if (p.shipped.count(fp) == 0) {
+        const ForcingData &d = *forcing;
+        Packer msg;
+        msg.put<uint64_t>(fp);
+        msg.put<int32_t>(d.airT.size());
+        msg.put(d.airT.data(), d.airT.size());
+        msg.put(d.precip.data(), d.precip.size());
+        msg.put(d.pet.data(), d.pet.size());
+        msg.put(d.obs.data(), d.obs.size());
+        send_message(p.socket, MSG_FORCING, msg.buf);
+        p.shipped.insert(fp);
+      }
+
+      Packer msg;
+      msg.put<uint32_t>(c);
+      msg.put<uint64_t>(fp);
+      msg.put<int32_t>(routing);
+      msg.put<int32_t>(initCond.size());
+      msg.put<int32_t>(npar);
+      msg.put<int32_t>(count);
+      msg.put(initCond.data(), initCond.size());
+      msg.put(sets.data() + (size_t) first * npar, (size_t) count * npar);
+      send_message(p.socket, MSG_TASK, msg.buf);
+
+      todo.pop_front();
+      p.inflight.push_back(c);
+    }
+  };
+
+  // los tramos de un trabajador perdido vuelven a la cola
+  auto lose = [&](int k){
+    std::deque<int> &f = peers[k]->inflight;
+    todo.insert(todo.begin(), f.begin(), f.end());
+    drop(k);
+  };
+
+  auto deal = [&](){
+    for (int k = peers.size() - 1; k >= 0; --k) {
+      try {
+        dispatch(*peers[k]);
+      } catch (std::exception &e) {
+        lose(k);
+      }
+    }
+  };
+
+  deal();
+
+  // ante un error los trabajadores quedan en un estado desconocido: se
+  // despiden y el cluster queda vacío
+  try {
+    uint32_t type;
+    std::vector<char> body;
+    while (left > 0) {
+      if (peers.empty()) {
+        throw std::runtime_error("no workers left in the cluster");
+      }
+
+      // los trabajadores nuevos también se atienden
+      std::vector<Socket*> watch;
+      for (size_t k = 0; k < peers.size(); ++k) watch.push_back(&peers[k]->socket);
+      watch.push_back(&server);
+
+      int k = wait_any(watch, timeout);
+      if (k < 0) {
+        throw std::runtime_error("no answer from the workers in " + std::to_string(timeout) + " s");
+      }
+
+      if (k == (int) peers.size()) {
+        Socket s = server.accept(0.0);
+        bool ok = false;
+        try {
+          ok = s.valid() && hello(s, timeout);
+        } catch (Interrupted &) {
+          throw;
+        } catch (std::exception &) {
+          // conexión ajena al cluster
+        }
+        if (ok) {
+          std::unique_ptr<Peer> p(new Peer);
+          p->socket = std::move(s);
+          peers.push_back( std::move(p) );
+          deal();
+        }
+        continue;
+      }
+
+      Peer &p = *peers[k];
+      try {
+        if (!recv_message(p.socket, type, body)) {
+          lose(k);
+          deal();
+          continue;
+        }
+      } catch (std::exception &e) {
+        lose(k);
+        deal();
+        continue;
+      }
+
+      Unpacker in(body);
+      if (type == MSG_ERROR) {
+        in.get<uint32_t>();
+        throw std::runtime_error("worker error: " + in.text());
+      }
+      if (type != MSG_SCORES) {
+        throw std::runtime_error("unexpected message from a worker");
+      }
+
+      int c     = in.get<uint32_t>();
+      int count = in.get<int32_t>();
+      std::deque<int>::iterator it = std::find(p.inflight.begin(), p.inflight.end(), c);
+      if (it == p.inflight.end() || count != std::min(chunk, nset - c * chunk)) {
+        throw std::runtime_error("unexpected scores from a worker");
+      }
+      in.get(sse + (size_t) c * chunk, count);
+      p.inflight.erase(it);
+      --left;
+
+      try {
+        dispatch(p);
+      } catch (std::exception &e) {
+        lose(k);
+        deal();
+      }
+    }
+  } catch (...) {
+    shutdown();
+    throw;
+  }
+}
+
+void Cluster::shutdown(){
+  std::vector<char> none;
+  for (size_t k = 0; k < peers.size(); ++k) {
+    try {
+      send_message(peers[k]->socket, MSG_QUIT, none);
+    } catch (std::exception &e) {
+      // trabajador ya desconectado
+    }
+  }
+  peers.clear();
+}
+
+// **********************************************************
+//  trabajador
+// **********************************************************
+static void send_error(Socket &s, uint32_t id, const std::string &msg){
+  Packer out;
+  out.put<uint32_t>(id);
+  out.put(msg);
+  send_message(s, MSG_ERROR, out.buf);
+}
+
+double worker_serve(const std::string &host,
+                    int port,
+                    double timeout){
+  Socket s = Socket::connect(host, port, timeout);
+
+  Packer hi;
+  hi.put<double>(CLUSTER_PROBE);
+  send_message(s, MSG_HELLO, hi.buf);
+
+  // forzantes recibidos, por huella
+  std::unordered_map< uint64_t, std::shared_ptr<ForcingData> > forcings;
+  double done = 0.0;
+
+  uint32_t type;
+  std::vector<char> body;
+  while (recv_message(s, type, body)) {
+    Unpacker in(body);
+
+    if (type == MSG_QUIT) {
+      break;
+    }
+
+    if (type == MSG_FORCING) {
+      uint64_t fp = in.get<uint64_t>();
+      int n       = in.get<int32_t>();
+
+      // cuatro series de 'n' valores
+      if ( n <= 0 || (size_t) n > in.left() / (4 * sizeof(double)) ) {
+        send_error(s, 0, "malformed forcing message");
+        break;
+      }
+
+      std::shared_ptr<ForcingData> d = std::make_shared<ForcingData>();
+      d->airT.resize(n);
+      d->precip.resize(n);
+      d->pet.resize(n);
+      d->obs.resize(n);
+      in.get(d->airT.data(), n);
+      in.get(d->precip.data(), n);
+      in.get(d->pet.data(), n);
+      in.get(d->obs.data(), n);
+      d->fingerprint = forcing_fingerprint(d->view());
+
+      if (d->fingerprint != fp) {
+        send_error(s, 0, "forcing corrupted in transit");
+        break;
+      }
+      forcings[fp] = d;
+      continue;
+    }
+
+    if (type != MSG_TASK) {
+      send_error(s, 0, "unexpected message from the coordinator");
+      break;
+    }
+
+    uint32_t id = in.get<uint32_t>();
+    uint64_t fp = in.get<uint64_t>();
+    int routing = in.get<int32_t>();
+    int ninit   = in.get<int32_t>();
+    int npar    = in.get<int32_t>();
+    int count   = in.get<int32_t>();
+
+    if (forcings.count(fp) == 0) {
+      send_error(s, id, "task for an unknown forcing");
+      break;
+    }
+    if ( routing < 1 || routing > 5 || ninit != pipeline_ninit(routing) ||
+         npar != pipeline_nparam(routing) ) {
+      send_error(s, id, "Please verify the routing, initCond and param arguments");
+      break;
+    }
+    size_t room = in.left() / sizeof(double);
+    if ( count <= 0 || room < (size_t) ninit || (size_t) count > (room - ninit) / npar ) {
+      send_error(s, id, "malformed task message");
+      break;
+    }
+
+    std::vector<double> init(ninit), sets( (size_t) count * npar ), score(count);
+    in.get(init.data(), ninit);
+    in.get(sets.data(), sets.size());
+
+    Forcing f = forcings[fp]->view();
+    Objective obj;
+    for (int k = 0; k < count; ++k) {
+      const double *p = sets.data() + (size_t) k * npar;
+      if (pipeline_check(routing, p) != 0) {
+        score[k] = NAN;
+        continue;
+      }
+      pipeline_sse(routing, f, init.data(), p, INFINITY, obj);
+      score[k] = obj.sse;
+    }
+    done += count;
+
+    Packer out;
+    out.put<uint32_t>(id);
+    out.put<int32_t>(count);
+    out.put(score.data(), count);
+    send_message(s, MSG_SCORES, out.buf);
+  }
+
+  return done;
+}
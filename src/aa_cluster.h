@@ -0,0 +1,84 @@
+#ifndef HBV_CLUSTER_H
+#define HBV_CLUSTER_H
+
+#include <set>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aa_socket.h"
+#include "aa_calibrate.h"
+
+// **********************************************************
+//  Coordinator / worker ensembles over TCP. The coordinator
+//  splits the parameter sets in chunks and deals them to the
+//  worker processes (at most two chunks in flight each), the
+//  workers run pipeline_sse() and stream the scores back per
+//  chunk. A forcing is shipped once per worker: later tasks
+//  refer to it by its fingerprint.
+//
+//  Message: 16 byte header (magic, type, payload size) and the
+//  payload in the native byte order (at most 1 GiB; sizes and
+//  counts are checked against it). The HELLO message of the
+//  worker carries a probe value, so peers with another byte
+//  order or floating point layout are rejected.
+// **********************************************************
+
+enum ClusterMessage {
+  MSG_HELLO   = 1,   // worker -> coordinator: probe value
+  MSG_FORCING = 2,   // fingerprint, n, airT, precip, pet, obs
+  MSG_TASK    = 3,   // id, fingerprint, routing, ninit, npar, nset, initCond, sets
+  MSG_SCORES  = 4,   // id, nset, SSE (NaN: invalid set)
+  MSG_ERROR   = 5,   // id, message
+  MSG_QUIT    = 6
+};
+
+class Cluster {
+public:
+  // listens on host:port (port 0: any free port)
+  Cluster(const std::string &host, int port);
+  ~Cluster();
+
+  int port() const { return server.port(); }
+  int size() const { return peers.size(); }
+
+  // waits until 'n' workers are connected; false after 'timeout' [s]
+  bool accept(int n, double timeout);
+
+  // SSE of 'nset' parameter sets (param: nset x npar, column-major). A
+  // worker that disconnects is dropped and its chunks are dealt again to
+  // the others; any other error (worker error, timeout) sends every
+  // worker away and is thrown.
+  void evaluate(const ForcingHandle &forcing,
+                int routing,
+                const std::vector<double> &initCond,
+                const double *param,
+                int nset,
+                int npar,
+                int chunk,
+                double timeout,
+                double *sse);
+
+  // QUIT to every worker
+  void shutdown();
+
+private:
+  struct Peer {
+    Socket socket;
+    std::set<uint64_t> shipped;   // forcings already sent
+    std::deque<int> inflight;     // chunks sent, waiting for scores
+  };
+
+  void drop(int k);
+
+  Socket server;
+  std::vector< std::unique_ptr<Peer> > peers;
+};
+
+// connects to the coordinator and serves its tasks until QUIT (or the
+// connection is closed). Returns the number of evaluated sets.
+double worker_serve(const std::string &host,
+                    int port,
+                    double timeout);
+
+#endif
@@ -0,0 +1,446 @@
+#ifndef HBV_CORE_H
+#define HBV_CORE_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// **********************************************************
+//  Single time step versions of the aa_* kernels. They hold
+//  no R objects, so they can be fused in one time loop and
+//  called away from the R main thread. The arithmetic follows
+//  the original kernels operation by operation.
+// **********************************************************
+
+// Instrumentation hooks of the step functions (see aa_probe.h). The
+// functions without a probe argument use this one, whose empty hooks
+// compile out.
+struct NoProbe {
+  void melt(bool) {}       // time step with or without snow (or ice) melt
+  void overflow() {}       // soil: Def > FC
+  void evap(double) {}     // soil: actual evapotranspiration (Eac of Soil_HBV)
+  void uzl() {}            // routing: upper zone over UZL
+  void perc() {}           // routing: storage over PERC
+  void flux(int, double, double) {}  // routing: water into and out of a bucket
+                                     // (initCond order) in the time step
+};
+
+// snowmelt(): temperature index model over soil
+// param: SFCF, Tt, Tm, fm
+// returns Total (Prain + Msnow) and updates SWE
+template<class Probe>
+inline double snowmelt_step(double airT,
+                            double precip,
+                            const double *param,
+                            double &SWE,
+                            Probe &probe){
+  double Prain, Psnow, Msnow;
+
+  // Precipitación líquida o sólida
+  if (airT > param[1]){
+    Prain = precip;
+    Psnow = 0.0;
+  } else {
+    Prain = 0.0;
+    Psnow = precip * param[0];
+  }
+
+  // Nieve derretida
+  if (airT > param[2] && SWE != 0.0) {
+    Msnow = std::min( (airT - param[2]) * param[3], SWE);
+    probe.melt(true);
+  } else {
+    Msnow = 0.0;
+    probe.melt(false);
+  }
+  SWE += Psnow - Msnow;
+
+  return (Msnow + Prain);
+}
+
+inline double snowmelt_step(double airT,
+                            double precip,
+                            const double *param,
+                            double &SWE){
+  NoProbe probe;
+  return snowmelt_step(airT, precip, param, SWE, probe);
+}
+
+// icemelt_clean() and icemelt_debris(): snowmelt_step() over ice. The ice
+// melts (factor 'fi') only when there is no snow left.
+// param: SFCF, Tt, Tm, fm
+// returns Total (Prain + Msnow + Mice) and updates SWE
+template<class Probe>
+inline double icemelt_step(double airT,
+                           double precip,
+                           const double *param,
+                           double fi,
+                           double &SWE,
+                           Probe &probe){
+  double Prain, Psnow, Msnow, Mice;
+
+  // Precipitación líquida o sólida
+  if (airT > param[1]){
+    Prain = precip;
+    Psnow = 0.0;
+  } else {
+    Prain = 0.0;
+    Psnow = precip * param[0];
+  }
+
+  // Nieve y hielo derretidos
+  if (airT > param[2]) {
+    if (SWE == 0.0) {
+      Msnow = 0.0;
+      Mice  = (airT - param[2]) * fi;
+    } else {
+      Msnow = std::min( (airT - param[2]) * param[3], SWE);
+      Mice  = 0.0;
+    }
+    probe.melt(true);
+  } else {
+    Msnow = 0.0;
+    Mice  = 0.0;
+    probe.melt(false);
+  }
+  SWE += Psnow - Msnow;
+
+  return ( (Msnow + Mice) + Prain );
+}
+
+inline double icemelt_step(double airT,
+                           double precip,
+                           const double *param,
+                           double fi,
+                           double &SWE){
+  NoProbe probe;
+  return icemelt_step(airT, precip, param, fi, SWE, probe);
+}
+
+// Soil_HBV() model 1
+// param: FC, LP, beta
+// returns the effective input (before scaling) and updates SM
+template<class Probe>
+inline double soil_step(double total,
+                        double pet,
+                        const double *param,
+                        double &SM,
+                        Probe &probe){
+  double Eac, Ieff, Def;
+  double FC   = param[0];
+  double LP   = param[1];
+  double beta = param[2];
+
+  Eac  = pet * std::min(SM / (FC * LP), 1.0);
+  Ieff = total * std::pow( (SM / FC), beta );
+  Def  = SM + total - Ieff - Eac;
+
+  // me aseguro que cierre el balance de masa
+  if (Def < 0.0) {
+    probe.evap(SM);     // Soil_HBV() reporta Eac = SM
+    SM = 0.0;
+  } else if (Def <= FC){
+    probe.evap(Eac);
+    SM = Def;
+  } else {
+    probe.evap(Eac);
+    Ieff = Ieff + (Def - FC);
+    SM   = FC;
+    probe.overflow();
+  }
+
+  return Ieff;
+}
+
+inline double soil_step(double total,
+                        double pet,
+                        const double *param,
+                        double &SM){
+  NoProbe probe;
+  return soil_step(total, pet, param, SM, probe);
+}
+
+// number of storages (initCond) and parameters of each Routing_HBV model
+inline int route_nstore(int model){
+  switch (model) {
+  case 1: return 3;
+  case 2: return 2;
+  case 3: return 2;
+  case 4: return 1;
+  case 5: return 1;
+  default: return 0;
+  }
+}
+
+inline int route_nparam(int model){
+  switch (model) {
+  case 1: return 5;
+  case 3: return 5;
+  case 5: return 5;
+  case 2: return 3;
+  case 4: return 3;
+  default: return 0;
+  }
+}
+
+// Routing_HBV() without lake. S holds the storages in initCond
+// order (SLZ, SUZ, STZ). Returns Qg.
+template<class Probe>
+inline double route_step(int model,
+                         double rech,
+                         const double *param,
+                         double *S,
+                         Probe &probe){
+  double TopUp, UpLow;
+  double Q0, Q1, Q2;
+
+  if (model == 1) {
+    // K0, K1, K2, UZL, PERC
+    if (S[2] >= param[3]) {
+      probe.uzl();
+      TopUp = param[3];
+      Q0    = (S[2] + rech - TopUp) * param[0];
+      S[2]  = (1 / param[0] - 1) * Q0;
+    } else {
+      TopUp = S[2];
+      Q0    = 0.0;
+      S[2]  = rech;
+    }
+
+    if (S[1] >= param[4]) {
+      probe.perc();
+      UpLow = param[4];
+      Q1    = (S[1] + TopUp - UpLow) * param[1];
+      S[1]  = (1 / param[1] - 1) * Q1;
+    } else {
+      UpLow = S[1];
+      Q1    = 0.0;
+      S[1]  = TopUp;
+    }
+
+    Q2   = (S[0] + UpLow) * param[2];
+    S[0] = (1 / param[2] - 1) * Q2;
+
+    // STZ -> SUZ -> SLZ
+    probe.flux(2, rech, Q0 + TopUp);
+    probe.flux(1, TopUp, Q1 + UpLow);
+    probe.flux(0, UpLow, Q2);
+
+    return (Q2 + Q1 + Q0);
+
+  } else if (model == 2) {
+    // K1, K2, PERC
+    if (S[1] >= param[2]) {
+      probe.perc();
+      UpLow = param[2];
+      Q1    = (S[1] + rech - UpLow) * param[0];
+      S[1]  = (1 / param[0] - 1) * Q1;
+    } else {
+      UpLow = S[1];
+      Q1    = 0.0;
+      S[1]  = rech;
+    }
+
+    Q2   = (S[0] + UpLow) * param[1];
+    S[0] = (1 / param[1] - 1) * Q2;
+
+    probe.flux(1, rech, Q1 + UpLow);
+    probe.flux(0, UpLow, Q2);
+
+    return (Q2 + Q1);
+
+  } else if (model == 3) {
+    // K0, K1, K2, UZL, PERC
+    if (S[1] > param[3]) {
+      probe.uzl();
+      Q0   = (S[1] - param[3] + rech) * param[0];
+      S[1] = (1 / param[0] - 1) * Q0 + param[3];
+
+      if (S[1] >= param[4]) {
+        probe.perc();
+        UpLow = param[4];
+        Q1    = (S[1] - UpLow) * param[1];
+        S[1]  = (1 / param[1] - 1) * Q1;
+      } else {
+        UpLow = S[1];
+        Q1    = 0.0;
+        S[1]  = 0.0;
+      }
+
+    } else {
+      Q0 = 0.0;
+
+      if (S[1] >= param[4]) {
+        probe.perc();
+        UpLow = param[4];
+        Q1    = (S[1] + rech - UpLow) * param[1];
+        S[1]  = (1 / param[1] - 1) * Q1;
+      } else {
+        UpLow = S[1];
+        Q1    = 0.0;
+        S[1]  = rech;
+      }
+    }
+
+    Q2   = (S[0] + UpLow) * param[2];
+    S[0] = (1 / param[2] - 1) * Q2;
+
+    probe.flux(1, rech, (Q0 + Q1) + UpLow);
+    probe.flux(0, UpLow, Q2);
+
+    return (Q2 + Q1 + Q0);
+
+  } else if (model == 4) {
+    // K1, K2, PERC
+    if (S[0] > param[2]) {
+      probe.perc();
+      Q1   = (S[0] - param[2] + rech) * param[0];
+      S[0] = (1 / param[0] - 1) * Q1 + param[2];
+      Q2   = S[0] * param[1];
+      S[0] = S[0] - Q2;
+    } else {
+      Q1   = 0.0;
+      Q2   = (S[0] + rech) * param[1];
+      S[0] = (1 / param[1] - 1) * Q2;
+    }
+
+    probe.flux(0, rech, Q2 + Q1);
+
+    return (Q2 + Q1);
+
+  } else {
+    // K0, K1, K2, UZL, PERC
+    if (S[0] > param[3]) {
+      probe.uzl();
+      probe.perc();
+      Q0   = (S[0] - param[3] + rech) * param[0];
+      S[0] = (1 / param[0] - 1) * Q0 + param[3];
+      Q1   = (S[0] - param[4]) * param[1];
+      S[0] = (1 / param[1] - 1) * Q1 + param[4];
+      Q2   = S[0] * param[2];
+      S[0] = S[0] - Q2;
+    } else if (S[0] > param[4]) {
+      probe.perc();
+      Q0   = 0.0;
+      Q1   = (S[0] - param[4] + rech) * param[1];
+      S[0] = (1 / param[1] - 1) * Q1 + param[4];
+      Q2   = S[0] * param[2];
+      S[0] = S[0] - Q2;
+    } else {
+      Q0   = 0.0;
+      Q1   = 0.0;
+      Q2   = (S[0] + rech) * param[2];
+      S[0] = (1 / param[2] - 1) * Q2;
+    }
+
+    probe.flux(0, rech, Q2 + Q1 + Q0);
+
+    return (Q2 + Q1 + Q0);
+  }
+}
+
+inline double route_step(int model,
+                         double rech,
+                         const double *param,
+                         double *S){
+  NoProbe probe;
+  return route_step(model, rech, param, S, probe);
+}
+
+// Parameter restrictions of the routing kernels. Returns the same
+// message as the kernel or NULL when the parameter set is valid.
+inline const char* route_check(int model,
+                               const double *param){
+  if (model == 2 || model == 4) {
+    if ( (1.0 <= param[0]) || (param[0] <= param[1]) ) {
+      return "Please verify: 1 > K1 > K2";
+    }
+  } else {
+    if ( (1.0 <= param[0]) || (param[0] <= param[1]) || (param[1] <= param[2]) ||
+         (param[3] <= param[4]) ) {
+      return "Please verify: 1 > K0 > K1 > K2 & UZL > PERC";
+    }
+  }
+  return 0;
+}
+
+// value of a plain or dual number (see aa_smooth.h)
+inline double value(double x){
+  return x;
+}
+
+// UH() model 1 weights (static triangular transfer function)
+template <class T>
+inline void uh_weights(const T &Bmax,
+                       std::vector<T> &w){
+  using std::abs;
+  int n = (int) std::ceil(value(Bmax));
+  double hm = 2.0, eps = 4.0, Tp = 0.5;
+
+  if (n == 1) {
+    w.assign(1, T(1.0));
+    return;
+  }
+
+  std::vector<T> t(n), h(n);
+  w.assign(n, T(0.0));
+
+  t[0] = 1 / Bmax;
+  h[0] = hm - abs(t[0] - Tp) * eps;
+  for (int i = 1; i < (n - 1); ++i) {
+    t[i] = t[i - 1] + 1 / Bmax;
+    h[i] = hm - abs(t[i] - Tp) * eps;
+  }
+  t[n - 1] = 1.0;
+  h[n - 1] = 0.0;
+
+  if (value(Bmax) < 2) {
+    w[0] = 0.5 + (hm + h[0]) * (t[0] - Tp) * 0.5;
+    w[1] = 1 - w[0];
+  } else {
+    // medianCpp(n) - 1
+    int j = (n + 1) / 2 - 1;
+    w[0] = t[0] * h[0] * 0.5;
+    for (int i = 1; i < n; ++i) {
+      if (i == j) {
+        w[i] = (h[i - 1] + hm) * (Tp - t[i - 1]) * 0.5 + (h[i] + hm) * (t[i] - Tp) * 0.5;
+      } else {
+        w[i] = (h[i] + h[i - 1]) * (t[i] - t[i - 1]) * 0.5;
+      }
+    }
+  }
+}
+
+// UH() convolution carried one step at a time. Qg values before
+// the first step are taken as zero.
+template <class T>
+struct UHBuffer {
+  std::vector<T> w;   // weights
+  std::vector<T> Qg;  // last w.size() inputs (ring buffer)
+  int pos;
+
+  void reset(const T &Bmax){
+    uh_weights(Bmax, w);
+    Qg.assign(w.size(), T(0.0));
+    pos = 0;
+  }
+
+  T step(const T &qg){
+    int n = w.size();
+    T Qf = 0.0;
+
+    Qg[pos] = qg;
+    for (int j = 0; j < n; ++j) {
+      int k = pos - j;
+      if (k < 0) k += n;
+      Qf += Qg[k] * w[j];
+    }
+    pos = (pos + 1 == n) ? 0 : pos + 1;
+
+    return Qf;
+  }
+};
+
+typedef UHBuffer<double> UHState;
+
+#endif
@@ -0,0 +1,125 @@
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include "aa_ensemble.h"
+#include "aa_core.h"
+#include "aa_threadpool.h"
+
+
+double surface_cost(int surface){
+  return (surface == SURFACE_SOIL) ? 5.0 : 9.0;
+}
+
+// suma de las bandas de un miembro, en orden de banda
+struct MemberSum {
+  std::mutex mtx;
+  std::vector< std::unique_ptr< std::vector<double> > > ready;
+  int next;
+
+  MemberSum() : next(0) {}
+};
+
+static void run_band(const EnsembleBands &e,
+                     int b,
+                     const double *p,
+                     double *total){
+  const BandForcing &f = *e.forcing;
+  const double *t = f.temp(b);
+  const double *pr = f.prec(b);
+  double SWE = e.SWE0[b];
+
+  if (e.surface[b] == SURFACE_SOIL) {
+    for (int i = 0; i < f.n; ++i) {
+      total[i] = snowmelt_step(t[i], pr[i], p, SWE);
+    }
+  } else {
+    double fi = (e.surface[b] == SURFACE_GLACIER) ? p[4] : p[5];
+    for (int i = 0; i < f.n; ++i) {
+      total[i] = icemelt_step(t[i], pr[i], p, fi, SWE);
+    }
+  }
+}
+
+EnsembleJob::EnsembleJob(const EnsembleBands &e,
+                         std::shared_ptr<const BandForcing> forcing,
+                         const double *param,
+                         int nmember,
+                         double *dest) :
+  Job(nmember, nmember), e(e), forcing(forcing),
+  param(param, param + (size_t) nmember * 6), nmember(nmember), out(dest) {
+  size_t size = (size_t) e.forcing->n * nmember;
+  if (out == 0) {
+    buffer.resize(size);
+    out = buffer.data();
+  }
+  std::fill(out, out + size, 0.0);
+
+  for (int m = 0; m < nmember; ++m) {
+    sums.push_back( std::unique_ptr<MemberSum>(new MemberSum) );
+    sums.back()->ready.resize(e.forcing->nband);
+  }
+}
+
+EnsembleJob::~EnsembleJob() {}
+
+bool EnsembleJob::complete(int m) const {
+  return sums[m]->next == e.forcing->nband;
+}
+
+void ensemble_start(const std::shared_ptr<EnsembleJob> &job,
+                    ThreadPool &pool){
+  int n     = job->e.forcing->n;
+  int nband = job->e.forcing->nband;
+  int nmember = job->nmember;
+
+  std::vector< std::function<void()> > tasks;
+  std::vector<double> cost;
+
+  for (int m = 0; m < nmember; ++m) {
+    for (int b = 0; b < nband; ++b) {
+      EnsembleJob *j = job.get();
+
+      tasks.push_back([job, j, nmember, n, nband, m, b](){
+        // la cancelación se revisa entre tareas (banda x miembro)
+        if (j->control.cancelled()) return;
+
+        // parámetros del miembro
+        double p[6];
+        for (int k = 0; k < 6; ++k) p[k] = j->param[m + (size_t) k * nmember];
+
+        std::unique_ptr< std::vector<double> > total(new std::vector<double>(n));
+        run_band(j->e, b, p, total->data());
+
+        // sumo las bandas que ya están listas, siempre en orden
+        MemberSum *s = j->sums[m].get();
+        std::lock_guard<std::mutex> lock(s->mtx);
+        s->ready[b] = std::move(total);
+        double *o = j->out + (size_t) m * n;
+        while (s->next < nband && s->ready[s->next]) {
+          const std::vector<double> &x = *s->ready[s->next];
+          double a = j->e.area[s->next];
+          for (int i = 0; i < n; ++i) o[i] += a * x[i];
+          s->ready[s->next].reset();
+          ++s->next;
+        }
+        if (s->next == nband) {
+          j->control.count();
+          j->control.finish();
+        }
+      });
+      cost.push_back( surface_cost(job->e.surface[b]) * n );
+    }
+  }
+
+  pool.submit_batch(tasks, cost, job->group);
+}
+
+void ensemble_bands(const EnsembleBands &e,
+                    const double *param,
+                    int nmember,
+                    double *out){
+  std::shared_ptr<EnsembleJob> job =
+    std::make_shared<EnsembleJob>(e, std::shared_ptr<const BandForcing>(), param, nmember, out);
+  ensemble_start(job, shared_pool());
+  job->group.wait();
+}
@@ -0,0 +1,75 @@
+#ifndef HBV_ENSEMBLE_H
+#define HBV_ENSEMBLE_H
+
+#include <memory>
+#include <vector>
+#include "aa_bands.h"
+#include "aa_jobs.h"
+
+// **********************************************************
+//  Band x member ensembles of the snow and glacier routine.
+//  Every (band, member) pair is one task on the shared pool,
+//  weighted by the cost of its surface type, so expensive
+//  glacier bands are spread over the workers first and idle
+//  workers steal the cheap soil bands.
+// **********************************************************
+
+// surface of an elevation band (initCond[2] of SnowGlacier_HBV)
+enum Surface {
+  SURFACE_GLACIER = 1,   // icemelt_clean()
+  SURFACE_SOIL    = 2,   // snowmelt()
+  SURFACE_DEBRIS  = 3    // icemelt_debris()
+};
+
+// relative cost of one time step: output columns of the kernel
+double surface_cost(int surface);
+
+struct EnsembleBands {
+  const BandForcing *forcing;
+  std::vector<int> surface;    // one per band
+  std::vector<double> area;    // relative area of every band
+  std::vector<double> SWE0;    // one per band
+};
+
+// param: nmember x 6 (column-major) with SFCF, Tt, Tm, fm, fi and fic.
+// out: n x nmember, area weighted Total of the basin. The bands of a
+// member are added in band order, so the result does not depend on the
+// schedule.
+void ensemble_bands(const EnsembleBands &e,
+                    const double *param,
+                    int nmember,
+                    double *out);
+
+// band sum of one member (see aa_ensemble.cpp)
+struct MemberSum;
+
+// the same ensemble as a background job (see Ensemble_HBV(async = TRUE)).
+// Every member is one unit of the JobControl; after a cancellation the
+// members with missing bands are left incomplete.
+struct EnsembleJob : public Job {
+  EnsembleJob(const EnsembleBands &e,
+              std::shared_ptr<const BandForcing> forcing,
+              const double *param,
+              int nmember,
+              double *dest = 0);
+  ~EnsembleJob();
+
+  EnsembleBands e;
+  std::shared_ptr<const BandForcing> forcing;   // keeps e.forcing alive
+  std::vector<double> param;
+  int nmember;
+  std::vector<double> buffer;
+  double *out;        // n x nmember: 'dest' or the job's own buffer
+
+  // true when every band of member 'm' was added (once the job finished)
+  bool complete(int m) const;
+
+  std::vector< std::unique_ptr<MemberSum> > sums;
+};
+
+// submits the band x member tasks to 'pool' (job_pool() for the
+// background jobs) and returns at once
+void ensemble_start(const std::shared_ptr<EnsembleJob> &job,
+                    ThreadPool &pool);
+
+#endif
@@ -0,0 +1,210 @@
+#include <vector>
+#include <algorithm>
+#include "aa_glacier.h"
+#include "aa_output.h"
+#include "aa_threadpool.h"
+#include "aa_balance.h"
+#include "aa_probe.h"
+
+// parameter sets per block of glacier_batch()
+#define GLACIER_SETS 8
+
+// time steps per KG block of a non-dense output
+#define GLACIER_CHUNK 256
+
+// rango en el que exp_lane() es válida (fuera de él da 0 o Inf)
+static inline double exp_clamp(double x){
+  x = (x < -746.0) ? -746.0 : x;
+  return (x > 710.0) ? 710.0 : x;
+}
+
+void exp_vec(const double *x, int n, double *y){
+  int i = 0;
+
+  // bloques de ancho fijo: el compilador los vectoriza también con -O2
+  for (; i + HBV_LANES <= n; i += HBV_LANES) {
+    double c[HBV_LANES];
+    for (int j = 0; j < HBV_LANES; ++j) c[j] = exp_clamp(x[i + j]);
+    for (int j = 0; j < HBV_LANES; ++j) y[i + j] = exp_lane(c[j]);
+  }
+  for (; i < n; ++i) {
+    y[i] = exp_lane( exp_clamp(x[i]) );
+  }
+}
+
+void glacier_kg(const double *SWE,
+                int n,
+                const double *param,
+                double *KG){
+  double KGmin = param[0];
+  double dKG   = param[1];
+  double AG    = param[2];
+  int i = 0;
+
+  for (; i + HBV_LANES <= n; i += HBV_LANES) {
+    double e[HBV_LANES];
+    for (int j = 0; j < HBV_LANES; ++j) e[j] = exp_clamp(-SWE[i + j] / AG);
+    for (int j = 0; j < HBV_LANES; ++j) e[j] = exp_lane(e[j]);
+    for (int j = 0; j < HBV_LANES; ++j) KG[i + j] = std::min(KGmin + dKG * e[j], 1.0);
+  }
+  for (; i < n; ++i) {
+    KG[i] = std::min(KGmin + dKG * exp_lane( exp_clamp(-SWE[i] / AG) ), 1.0);
+  }
+}
+
+// sumas del balance de masa (NoAudit no agrega nada al loop)
+struct NoAudit {
+  void add(double, double) {}
+};
+
+struct SumAudit {
+  double in, out;
+
+  SumAudit() : in(0.0), out(0.0) {}
+  void add(double inflow, double Q) { in += inflow; out += Q; }
+};
+
+// devuelve el agua que queda en el reservorio (SG - Q del último paso)
+template<class Audit>
+static double glacier_loop(const double *SWE,
+                           const double *inflow,
+                           int n,
+                           double initCond,
+                           const double *param,
+                           OutputSink &out,
+                           Audit &audit){
+  double Q = 0.0, SG = initCond;
+  double *full = out.data();
+
+  if (full != 0) {
+    // KG va directo a la columna Q y se reemplaza paso a paso
+    double *Qc  = full;
+    double *SGc = full + n;
+    glacier_kg(SWE, n, param, Qc);
+
+    for (int i = 0; i < n; ++i) {
+      if (i == 0){
+        SG = inflow[i] + initCond;
+      } else {
+        SG = std::max( (inflow[i] - Q) + SG, 0.0);
+      }
+      Q = Qc[i] * SG;
+      audit.add(inflow[i], Q);
+
+      Qc[i]  = Q;
+      SGc[i] = SG;
+    }
+    return SG - Q;
+  }
+
+  // salida submuestreada o sin todas las columnas: KG por tramos en la
+  // pila, así la corrida no reserva memoria
+  double KG[GLACIER_CHUNK];
+  for (int i0 = 0; i0 < n; i0 += GLACIER_CHUNK) {
+    int m = std::min(GLACIER_CHUNK, n - i0);
+    glacier_kg(SWE + i0, m, param, KG);
+
+    for (int k = 0; k < m; ++k) {
+      int i = i0 + k;
+      if (i == 0){
+        SG = inflow[i] + initCond;
+      } else {
+        SG = std::max( (inflow[i] - Q) + SG, 0.0);
+      }
+      Q = KG[k] * SG;
+      audit.add(inflow[i], Q);
+
+      // Relleno matriz de salida
+      out(i, 0) = Q;
+      out(i, 1) = SG;
+    }
+  }
+  return SG - Q;
+}
+
+void glacier_run(const double *SWE,
+                 const double *inflow,
+                 int n,
+                 double initCond,
+                 const double *param,
+                 OutputSink &out,
+                 StoreBalance *bal){
+  if (bal == 0) {
+    NoAudit audit;
+    glacier_loop(SWE, inflow, n, initCond, param, out, audit);
+    return;
+  }
+
+  SumAudit audit;
+  *bal = StoreBalance("glacier", initCond);
+  bal->final  = glacier_loop(SWE, inflow, n, initCond, param, out, audit);
+  bal->input  = audit.in;
+  bal->output = audit.out;
+}
+
+// conjuntos [s0, s1): KG de cada uno en su columna de Q y luego las
+// recurrencias de SG intercaladas (son independientes entre sí)
+static void glacier_block(const double *SWE,
+                          const double *inflow,
+                          int n,
+                          const double *initCond,
+                          const double *param,
+                          int nset,
+                          int s0,
+                          int s1,
+                          double *Q){
+  int w = s1 - s0;
+  double SG[GLACIER_SETS], q[GLACIER_SETS];
+  double *col[GLACIER_SETS];
+
+  for (int k = 0; k < w; ++k) {
+    int s = s0 + k;
+    double p[3] = {param[s], param[s + nset], param[s + 2 * nset]};
+    col[k] = Q + (size_t) s * n;
+    glacier_kg(SWE, n, p, col[k]);
+  }
+
+  if (n == 0) return;
+
+  for (int k = 0; k < w; ++k) {
+    SG[k] = inflow[0] + initCond[s0 + k];
+    q[k]  = col[k][0] * SG[k];
+    col[k][0] = q[k];
+  }
+  for (int i = 1; i < n; ++i) {
+    for (int k = 0; k < w; ++k) {
+      SG[k] = std::max( (inflow[i] - q[k]) + SG[k], 0.0);
+      q[k]  = col[k][i] * SG[k];
+      col[k][i] = q[k];
+    }
+  }
+}
+
+void glacier_batch(const double *SWE,
+                   const double *inflow,
+                   int n,
+                   const double *initCond,
+                   const double *param,
+                   int nset,
+                   double *Q){
+  ThreadPool &pool = shared_pool();
+  int nblock = (nset + GLACIER_SETS - 1) / GLACIER_SETS;
+
+  if (nblock <= 1 || pool.size() == 1) {
+    for (int s0 = 0; s0 < nset; s0 += GLACIER_SETS) {
+      glacier_block(SWE, inflow, n, initCond, param, nset,
+                    s0, std::min(s0 + GLACIER_SETS, nset), Q);
+    }
+    return;
+  }
+
+  // una tarea por bloque de conjuntos (escriben columnas distintas)
+  TaskGroup group;
+  for (int s0 = 0; s0 < nset; s0 += GLACIER_SETS) {
+    int s1 = std::min(s0 + GLACIER_SETS, nset);
+    pool.submit([=](){
+      glacier_block(SWE, inflow, n, initCond, param, nset, s0, s1, Q);
+    }, group);
+  }
+  group.wait();
+}
@@ -0,0 +1,103 @@
+#ifndef HBV_GLACIER_H
+#define HBV_GLACIER_H
+
+#include <cstring>
+#include <stdint.h>
+
+class OutputSink;
+struct StoreBalance;
+
+// **********************************************************
+//  Glacier storage and release model of Stahl et al. (2008)
+//  (Glacier_Disch model 1) in two phases. The outflow rate
+//  KG = min(KGmin + dKG * exp(-SWE / AG), 1) does not depend
+//  on the reservoir, so it is computed first for the whole
+//  series in fixed-width blocks the compiler turns into SIMD
+//  code; the second phase only carries the SG recurrence.
+// **********************************************************
+
+// values per block of the vectorized loops
+#define HBV_LANES 4
+
+// exp(x) without branches, for x already clamped to [-746, 710].
+// Cody-Waite reduction x = k ln2 + r and a degree 13 Taylor polynomial;
+// 2^k is applied in two halves, so results below DBL_MIN come out as
+// subnormals (and 0) and x > log(DBL_MAX) as Inf. The error is at most
+// one ulp against the C library exp().
+inline double exp_lane(double x){
+  const double log2e = 1.4426950408889634074;
+  const double ln2hi = 6.93147180369123816490e-01;
+  const double ln2lo = 1.90821492927058770002e-10;
+  const double shift = 6755399441055744.0;   // 1.5 * 2^52
+
+  // k = round(x / ln2), kept in the low bits of t
+  double t = x * log2e + shift;
+  double k = t - shift;
+  double r = (x - k * ln2hi) - k * ln2lo;
+
+  double p = 1.0 / 6227020800.0;
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  // 2^k = 2^h1 * 2^h2
+  int64_t b;
+  std::memcpy(&b, &t, sizeof(double));
+  int64_t ki = b - INT64_C(0x4338000000000000);
+  int64_t h1 = ki >> 1;
+  int64_t h2 = ki - h1;
+  uint64_t b1 = (uint64_t) (h1 + 1023) << 52;
+  uint64_t b2 = (uint64_t) (h2 + 1023) << 52;
+  double s1, s2;
+  std::memcpy(&s1, &b1, sizeof(double));
+  std::memcpy(&s2, &b2, sizeof(double));
+
+  return p * s1 * s2;
+}
+
+// y = exp(x) for n values (x and y may be the same array)
+void exp_vec(const double *x, int n, double *y);
+
+// phase 1: outflow rate of every time step
+// param: KGmin, dKG, AG
+void glacier_kg(const double *SWE,
+                int n,
+                const double *param,
+                double *KG);
+
+// both phases for one parameter set; writes Q and SG (columns 0 and 1)
+// SWE: snow water equivalent above the glacier
+// inflow: melted snow + melted ice + rainfall
+// bal: NULL or the mass balance of the reservoir (inflow in, Q out; the
+// final storage is SG minus the Q of the last step)
+void glacier_run(const double *SWE,
+                 const double *inflow,
+                 int n,
+                 double initCond,
+                 const double *param,
+                 OutputSink &out,
+                 StoreBalance *bal = 0);
+
+// Q (n x nset) of many parameter sets over the same forcing.
+// param: nset x 3 (column-major) with KGmin, dKG and AG; initCond: one
+// per set. The SG recurrences of neighbouring sets run interleaved and
+// blocks of sets are spread over the shared pool.
+void glacier_batch(const double *SWE,
+                   const double *inflow,
+                   int n,
+                   const double *initCond,
+                   const double *param,
+                   int nset,
+                   double *Q);
+
+#endif
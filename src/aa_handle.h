@@ -0,0 +1,38 @@
+#include <Rcpp.h>
+#ifndef HBV_HANDLE_H
+#define HBV_HANDLE_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include "aa_jobs.h"
+
+// **********************************************************
+//  R side of the background jobs: the 'HBV_job' handle
+//  returned by the functions called with async = TRUE.
+// **********************************************************
+
+struct JobHandle {
+  std::shared_ptr<Job> job;
+  std::string kind;                // "calibration" or "ensemble"
+  std::function<SEXP()> collect;   // builds the result (R thread, job finished)
+
+  // a handle discarded by R cancels its job
+  ~JobHandle() { if (job) job->control.cancel(); }
+};
+
+// wraps a started job. 'collect' must not capture R objects.
+inline SEXP job_handle(std::shared_ptr<Job> job,
+                       const std::string &kind,
+                       std::function<SEXP()> collect){
+  JobHandle *h = new JobHandle;
+  h->job     = job;
+  h->kind    = kind;
+  h->collect = collect;
+
+  Rcpp::XPtr<JobHandle> out(h, true);
+  out.attr("class") = "HBV_job";
+  return out;
+}
+
+#endif
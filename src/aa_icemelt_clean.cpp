@@ -1,90 +1,64 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
+#include "aa_partition.h"
 using namespace Rcpp;
 
 
-// [[Rcpp::export]]
-NumericMatrix icemelt_clean(NumericMatrix inputData,
-                            NumericVector initCond,
-                            NumericVector param){
+SEXP icemelt_clean(NumericMatrix inputData,
+                   NumericVector initCond,
+                   NumericVector param,
+                   const OutputSpec &spec){
 
   // Genero el vector de salida
   int n = inputData.nrow(); // número filas
   int m = 9;                // número de columnas
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Prain", "Psnow", "SWE", "Msnow", "Mice", "Mtot", "Cum", "Total", "TotScal"});
 
   // Declaro variables que voy a utilizar y nombre de parámetros
-  double Prain, Psnow, SWE, Msnow, Mice, Mtot, Cum, Total, TotScal;
-  double SFCF, Tt, Tm, fm, fi;
+  double SWE, Msnow, Mice, Mtot;
+  double Tm, fi;
+  SnowForcing f;
 
-  // Asigno valores a los parámetros
-  SFCF = param[0];
-  Tt   = param[1];
+  // Asigno valores a los parámetros (SFCF, Tt, Tm, fm, fi)
+  const double *par = param.begin();
   Tm   = param[2];
-  fm   = param[3];
   fi   = param[4];
 
   // Corro rutina nivo-glaciar
+  SWE = initCond[0];
   for (int i = 0; i < n; ++i){
 
-    // Precipitación líquida o sólida
-    if (inputData(i, 0) > Tt){
-      Prain = inputData(i, 1);
-      Psnow = 0.0;
-    } else {
-      Prain = 0.0;
-      Psnow = inputData(i, 1) * SFCF;
-    }
-
-    // Nieve y hielo derretidos
-
-    if (i == 0) {SWE = initCond[0];} //me aeguro el condicional para la primer corrida
-    if (inputData(i, 0) > Tm) {//temperatura del aire MAYOR a Tmelt
-
-      if (SWE == 0.0) { //no hay nieve
-
-        Msnow   = 0.0;
-        Mice    = (inputData(i, 0) - Tm) * fi;
-        Mtot    = Msnow + Mice;
-        SWE    += Psnow - Msnow;
-        Cum     = Psnow - Mtot;
-        Total   = (Mtot + Prain);
-        TotScal = (Mtot + Prain) * initCond[2];
+    // Precipitación líquida o sólida y derretimiento potencial: no
+    // dependen de SWE
+    f = snow_partition(inputData(i, 0), inputData(i, 1), par);
 
-      } else { //hay nieve
-
-        Msnow = std::min( (inputData(i, 0) - Tm) * fm, SWE);
-        Mice    = 0.0;
-        Mtot    = Msnow + Mice;
-        SWE    += Psnow - Msnow;
-        Cum     = Psnow - Mtot;
-        Total   = (Mtot + Prain);
-        TotScal = (Mtot + Prain) * initCond[2];
-      }
-    } else { //temperatura del aire MENOR a Tmelt
-
-      Msnow   = 0.0;
-      Mice    = 0.0;
-      Mtot    = Msnow + Mice;
-      SWE    += Psnow - Msnow;
-      Cum     = Psnow - Mtot;
-      Total   = (Mtot + Prain);
-      TotScal = (Mtot + Prain) * initCond[2];
-    }
+    // Nieve y hielo derretidos: SWE es lo único que pasa de un paso al otro
+    Msnow = snow_melt(inputData(i, 0), Tm, f.Mpot, SWE);
+    Mice  = ice_melt(inputData(i, 0), Tm, fi, SWE);
+    Mtot  = Msnow + Mice;
+    SWE  += f.Psnow - Msnow;
 
     // Relleno matriz de salida
-    out(i, 0) = Prain;
-    out(i, 1) = Psnow;
+    out(i, 0) = f.Prain;
+    out(i, 1) = f.Psnow;
     out(i, 2) = SWE;
     out(i, 3) = Msnow;
     out(i, 4) = Mice;
     out(i, 5) = Mtot;
-    out(i, 6) = Cum;
-    out(i, 7) = Total;
-    out(i, 8) = TotScal;
+    out(i, 6) = f.Psnow - Mtot;
+    out(i, 7) = (Mtot + f.Prain);
+    out(i, 8) = (Mtot + f.Prain) * initCond[2];
   }
 
-  colnames(out) = CharacterVector::create("Prain", "Psnow", "SWE", "Msnow", "Mice", "Mtot", "Cum", "Total", "TotScal");
-  return out;
+  return out.result();
 
 
 }
+
+// [[Rcpp::export]]
+NumericMatrix icemelt_clean(NumericMatrix inputData,
+                            NumericVector initCond,
+                            NumericVector param){
+  return icemelt_clean(inputData, initCond, param, OutputSpec());
+}
@@ -2,6 +2,13 @@
 #ifndef ICEMELT_CLEAN
 #define ICEMELT_CLEAN
 
+#include "aa_output.h"
+
+SEXP icemelt_clean(Rcpp::NumericMatrix inputData,
+                   Rcpp::NumericVector initCond,
+                   Rcpp::NumericVector param,
+                   const OutputSpec &spec);
+
 Rcpp::NumericMatrix icemelt_clean(Rcpp::NumericMatrix inputData,
                                   Rcpp::NumericVector initCond,
                                   Rcpp::NumericVector param);
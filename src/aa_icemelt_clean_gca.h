@@ -2,6 +2,13 @@
 #ifndef ICEMELT_CLEAN_GCA
 #define ICEMELT_CLEAN_GCA
 
+#include "aa_output.h"
+
+SEXP icemelt_clean_gca(Rcpp::NumericMatrix inputData,
+                       Rcpp::NumericVector initCond,
+                       Rcpp::NumericVector param,
+                       const OutputSpec &spec);
+
 Rcpp::NumericMatrix icemelt_clean_gca(Rcpp::NumericMatrix inputData,
                                       Rcpp::NumericVector initCond,
                                       Rcpp::NumericVector param);
@@ -2,6 +2,13 @@
 #ifndef ICEMELT_DEBRIS
 #define ICEMELT_DEBRIS
 
+#include "aa_output.h"
+
+SEXP icemelt_debris(Rcpp::NumericMatrix inputData,
+                    Rcpp::NumericVector initCond,
+                    Rcpp::NumericVector param,
+                    const OutputSpec &spec);
+
 Rcpp::NumericMatrix icemelt_debris(Rcpp::NumericMatrix inputData,
                                    Rcpp::NumericVector initCond,
                                    Rcpp::NumericVector param);
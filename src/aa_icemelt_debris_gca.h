@@ -2,6 +2,13 @@
 #ifndef ICEMELT_DEBRIS_GCA
 #define ICEMELT_DEBRIS_GCA
 
+#include "aa_output.h"
+
+SEXP icemelt_debris_gca(Rcpp::NumericMatrix inputData,
+                                      Rcpp::NumericVector initCond,
+                                      Rcpp::NumericVector param,
+                        const OutputSpec &spec);
+
 Rcpp::NumericMatrix icemelt_debris_gca(Rcpp::NumericMatrix inputData,
                                       Rcpp::NumericVector initCond,
                                       Rcpp::NumericVector param);
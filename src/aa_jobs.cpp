@@ -0,0 +1,31 @@
+#include <cmath>
+#include "aa_jobs.h"
+
+
+JobControl::JobControl(int nunit, double total) :
+  stop(false), evals(0), ndone(0), nunit(nunit), total(total),
+  best_value(nunit, NAN), t0(std::chrono::steady_clock::now()) {}
+
+void JobControl::cancel(){
+  stop.store(true, std::memory_order_relaxed);
+}
+
+void JobControl::improve(int unit, double value){
+  std::lock_guard<std::mutex> lock(mtx);
+  if ( std::isnan(best_value[unit]) || value < best_value[unit] ) {
+    best_value[unit] = value;
+  }
+}
+
+std::vector<double> JobControl::best(){
+  std::lock_guard<std::mutex> lock(mtx);
+  return best_value;
+}
+
+double JobControl::seconds() const {
+  return seconds( std::chrono::steady_clock::now() );
+}
+
+double JobControl::seconds(std::chrono::steady_clock::time_point end) const {
+  return std::chrono::duration<double>(end - t0).count();
+}
@@ -0,0 +1,72 @@
+#ifndef HBV_JOBS_H
+#define HBV_JOBS_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "aa_threadpool.h"
+
+// **********************************************************
+//  Background jobs on job_pool(). A job is started from
+//  the R thread and returns at once; its tasks report progress
+//  through a JobControl and poll the cancel flag only between
+//  chunks of work (one model run, one band), never inside the
+//  time loop.
+// **********************************************************
+
+class JobControl {
+public:
+  // 'nunit' independent units (basins, members) with 'total' planned
+  // evaluations
+  JobControl(int nunit, double total);
+
+  // cancellation (the running chunks finish first)
+  void cancel();
+  bool cancelled() const { return stop.load(std::memory_order_relaxed); }
+
+  // one more evaluation of any unit
+  void count() { evals.fetch_add(1, std::memory_order_relaxed); }
+
+  // new best objective value of 'unit'
+  void improve(int unit, double value);
+
+  // the unit has finished (or was skipped after a cancellation)
+  void finish() { ndone.fetch_add(1, std::memory_order_relaxed); }
+
+  // progress snapshot (any thread)
+  double evaluations() const { return evals.load(std::memory_order_relaxed); }
+  double planned() const { return total; }
+  int finished() const { return ndone.load(std::memory_order_relaxed); }
+  int units() const { return nunit; }
+  std::vector<double> best();
+
+  // elapsed time since the job started, up to 'end' when given (the time
+  // its last task finished)
+  double seconds() const;
+  double seconds(std::chrono::steady_clock::time_point end) const;
+
+private:
+  std::atomic<bool> stop;
+  std::atomic<long long> evals;
+  std::atomic<int> ndone;
+  int nunit;
+  double total;
+
+  std::mutex mtx;
+  std::vector<double> best_value;   // NaN until the first evaluation
+
+  std::chrono::steady_clock::time_point t0;
+};
+
+// base of the jobs. The tasks keep the job alive (shared_ptr), so it can
+// be dropped by the R session while it is still running.
+struct Job {
+  Job(int nunit, double total) : control(nunit, total) {}
+  virtual ~Job() {}
+
+  JobControl control;
+  TaskGroup group;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef HBV_OUTPUT_H
+#define HBV_OUTPUT_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+// **********************************************************
+//  Output sink of the time loops. Kernels write every time
+//  step as out(i, k) = value; the sink either stores the whole
+//  n x m series, every stride-th row of it (state snapshots of
+//  long runs) or accumulates sum, min and max per period (e.g.:
+//  daily or monthly totals of an hourly run), so only what is
+//  returned is ever allocated. Columns can be dropped in every
+//  mode.
+// **********************************************************
+
+struct OutputSpec {
+  int period;              // > 0: period length [time steps]
+  std::vector<int> index;  // period (0-based) of every time step
+  int nperiod;             // number of periods (0: no aggregation)
+  int stride;              // record every stride-th time step
+  std::vector<std::string> columns;  // recorded columns (empty: all)
+  void *into;              // caller's output matrix (an R object, see
+                           // aa_stage.h); NULL: the stage allocates one
+
+  OutputSpec() : period(0), nperiod(0), stride(1), into(0) {}
+
+  bool aggregate() const { return nperiod > 0; }
+};
+
+class OutputSink {
+public:
+  // keep: output column of every kernel column (-1: dropped; empty: all),
+  // moved into the sink. 'full' (rows() x cols(), column-major) receives the
+  // series when 'spec' does not aggregate; it is not used otherwise. 'spec'
+  // must outlive the sink.
+  OutputSink(int n, int m, const OutputSpec &spec,
+             std::vector<int> keep = std::vector<int>(),
+             double *full = 0)
+    : n(n), m(m), np(spec.nperiod), period(spec.period), stride(spec.stride),
+      index(spec.index.empty() ? 0 : spec.index.data()), full(full), col(std::move(keep)) {
+    // without 'keep' every column is stored (and no map is allocated)
+    mk = col.empty() ? m : 0;
+    for (size_t k = 0; k < col.size(); ++k) {
+      if (col[k] >= 0) ++mk;
+    }
+    nr    = (np > 0) ? np : (n + stride - 1) / stride;
+    dense = (np == 0) && (stride == 1) && (mk == m);
+
+    if (np > 0) {
+      sum.assign( (size_t) np * mk, 0.0 );
+      lo.assign( (size_t) np * mk, std::numeric_limits<double>::infinity() );
+      hi.assign( (size_t) np * mk, -std::numeric_limits<double>::infinity() );
+      count.assign(np, 0);
+      for (int i = 0; i < n; ++i) ++count[ period_of(i) ];
+    }
+  }
+
+  // out(i, k) = value
+  struct Cell {
+    OutputSink *sink;
+    int i, k;
+
+    void operator=(double v){ sink->put(i, k, v); }
+  };
+
+  Cell operator()(int i, int k){
+    Cell c = {this, i, k};
+    return c;
+  }
+
+  void put(int i, int k, double v){
+    if (dense) {
+      full[i + (size_t) k * n] = v;
+      return;
+    }
+
+    int c = col.empty() ? k : col[k];
+    if (c < 0) return;
+
+    if (np == 0) {
+      if (i % stride != 0) return;
+      full[i / stride + (size_t) c * nr] = v;
+      return;
+    }
+
+    size_t j = period_of(i) + (size_t) c * np;
+    sum[j] += v;
+    if (v < lo[j]) lo[j] = v;
+    if (v > hi[j]) hi[j] = v;
+  }
+
+  int period_of(int i) const {
+    return (period > 0) ? i / period : index[i];
+  }
+
+  // dimensions of the stored series (or of the accumulators)
+  int rows() const { return nr; }
+  int cols() const { return mk; }
+  int nperiod() const { return np; }
+
+  // output column of every kernel column (empty: all are stored)
+  const std::vector<int>& keep() const { return col; }
+
+  // the whole series (n x m, column-major) when every time step of every
+  // column is stored as it is; NULL otherwise
+  double* data() const { return dense ? full : 0; }
+
+  // accumulators (nperiod x cols, column-major) and time steps per period
+  const std::vector<double>& sums() const { return sum; }
+  const std::vector<double>& mins() const { return lo; }
+  const std::vector<double>& maxs() const { return hi; }
+  const std::vector<int>& counts() const { return count; }
+
+protected:
+  void attach(double *buf){ full = buf; }
+
+private:
+  int n, m, np, period, stride;
+  int nr, mk;
+  bool dense;
+  const int *index;
+  double *full;
+  std::vector<int> col;
+  std::vector<double> sum, lo, hi;
+  std::vector<int> count;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef HBV_PARTITION_H
+#define HBV_PARTITION_H
+
+#include <algorithm>
+
+// **********************************************************
+//  Time step of the snow and ice kernels (aa_snowmelt* and
+//  aa_icemelt*) split in two parts. The rain/snow split and
+//  the potential melt depend only on the forcing and are
+//  computed without branches; the melt is the only operation
+//  that reads SWE, so the loop carries a single short
+//  dependency chain (min, subtraction and addition).
+//
+//  Both parts stay in the same pass: the forcing arithmetic
+//  runs in the shadow of that chain, while a separate pass
+//  over the series costs one more trip through memory.
+// **********************************************************
+
+struct SnowForcing {
+  double Prain;
+  double Psnow;
+  double Mpot;    // potential snow melt: (T - Tm) * fm
+};
+
+// param: SFCF, Tt, Tm, fm
+inline SnowForcing snow_partition(double airT,
+                                  double precip,
+                                  const double *param){
+  SnowForcing f;
+  f.Prain = (airT > param[1]) ? precip : 0.0;
+  f.Psnow = (airT > param[1]) ? 0.0 : precip * param[0];
+  f.Mpot  = (airT - param[2]) * param[3];
+  return f;
+}
+
+// snow melts only above Tm and while there is snow left
+inline double snow_melt(double airT,
+                        double Tm,
+                        double Mpot,
+                        double SWE){
+  return (airT > Tm && SWE != 0.0) ? std::min(Mpot, SWE) : 0.0;
+}
+
+// ice (factor fi or fic) melts only above Tm when the time step starts
+// without snow
+inline double ice_melt(double airT,
+                       double Tm,
+                       double fi,
+                       double SWE){
+  return (airT > Tm && SWE == 0.0) ? (airT - Tm) * fi : 0.0;
+}
+
+#endif
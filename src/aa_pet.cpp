@@ -0,0 +1,38 @@
+#include <algorithm>
+#include "aa_pet.h"
+
+
+PETTable::PETTable(int hemis) : phase( (hemis == 1) ? 90 : -90 ), table(367) {
+  for (int k = 0; k < (int) table.size(); ++k) {
+    double jd = k;
+    table[k] = 1 + std::sin( (360 * jd / 366 + phase) * M_PI / 180 );
+  }
+}
+
+void pet_bands(int hemis,
+               const double *jd,
+               int n,
+               double zref,
+               const double *ztopo,
+               int nband,
+               double EP,
+               double gradPET,
+               double *out){
+  PETTable season(hemis);
+
+  // término estacional una sola vez para todas las bandas
+  std::vector<double> s(n);
+  for (int i = 0; i < n; ++i) {
+    s[i] = EP * season.season(jd[i]);
+  }
+
+  for (int b = 0; b < nband; ++b) {
+    double offset = (ztopo[b] -  zref) * (gradPET / 100);
+    double *o = out + (size_t) b * n;
+
+    for (int i = 0; i < n; ++i) {
+      double v = std::max(s[i] + offset, 0.0);
+      o[i] = (jd[i] == 0.0) ? 0.0 : v;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef HBV_PET_H
+#define HBV_PET_H
+
+#include <cmath>
+#include <vector>
+
+// **********************************************************
+//  Calder's sinusoidal PET model (PET() model 1) with the
+//  seasonal term tabulated by day of year. The hemisphere is
+//  a phase offset (+90º south, -90º north).
+// **********************************************************
+
+class PETTable {
+public:
+  explicit PETTable(int hemis);
+
+  // 1 + sin( (360 * jd / 366 + phase) * pi / 180 )
+  double season(double jd) const {
+    int k = (int) jd;
+    if (k >= 0 && k < (int) table.size() && k == jd) {
+      return table[k];
+    }
+    return 1 + std::sin( (360 * jd / 366 + phase) * M_PI / 180 );
+  }
+
+private:
+  double phase;
+  std::vector<double> table;   // days 0 to 366
+};
+
+// PET() model 1 for every band. jd: julian days; out: n x nband (band-major)
+void pet_bands(int hemis,
+               const double *jd,
+               int n,
+               double zref,
+               const double *ztopo,
+               int nband,
+               double EP,
+               double gradPET,
+               double *out);
+
+#endif
@@ -0,0 +1,211 @@
+#include "aa_core.h"
+#include "aa_smooth.h"
+#include "aa_pipeline.h"
+#include "aa_chain.h"
+#include "aa_cache.h"
+#include "aa_output.h"
+#include "aa_probe.h"
+#include "aa_balance.h"
+
+
+int pipeline_nparam(int routing){
+  return 8 + route_nparam(routing);
+}
+
+int pipeline_ninit(int routing){
+  return 2 + route_nstore(routing);
+}
+
+const char* pipeline_check(int routing,
+                           const double *param){
+  if (param[4] <= 0) {
+    return "Verify: FC > 0";
+  }
+  if ( (param[5] > 1) || (param[5] <= 0) ) {
+    return "Verify: 0 < LP <= 1";
+  }
+  const char *msg = route_check(routing, param + 7);
+  if (msg != 0) {
+    return msg;
+  }
+  if (param[pipeline_nparam(routing) - 1] < 1) {
+    return "Parameter must be Bmax >= 1";
+  }
+  return 0;
+}
+
+void pipeline_run(int routing,
+                  const Forcing &f,
+                  const double *initCond,
+                  const double *param,
+                  OutputSink &out){
+  PipelineChain<> chain(routing, initCond, param);
+  SinkEmit emit(out);
+  pipeline_run(chain, f, emit);
+}
+
+void pipeline_profile(int routing,
+                      const Forcing &f,
+                      const double *initCond,
+                      const double *param,
+                      OutputSink &out,
+                      std::vector<StageProfile> &prof){
+  prof.clear();
+  prof.push_back( StageProfile("snow") );
+  prof.push_back( StageProfile("soil") );
+  prof.push_back( StageProfile("routing") );
+  prof.push_back( StageProfile("uh") );
+  PipelineChain<CountProbe> chain(routing, initCond, param,
+                                  CountProbe(prof[0]), CountProbe(prof[1]),
+                                  CountProbe(prof[2]));
+
+  // cada etapa recorre un tramo entero antes de pasar a la siguiente, así
+  // el reloj se lee una vez por tramo y etapa
+  const int chunk = 2048;
+  std::vector<double> swe(chunk), sm(chunk), total(chunk), rech(chunk), Qg(chunk);
+  count_alloc( (size_t) 5 * chunk * sizeof(double), 5 );
+
+  for (int i0 = 0; i0 < f.n; i0 += chunk) {
+    int m = std::min(chunk, f.n - i0);
+
+    {
+      StageTimer t(prof[0], m);
+      chain.snow_chunk(f, i0, m, total.data(), swe.data());
+    }
+    {
+      StageTimer t(prof[1], m);
+      chain.soil_chunk(f, i0, m, total.data(), rech.data(), sm.data());
+    }
+    {
+      StageTimer t(prof[2], m);
+      chain.route_chunk(m, rech.data(), Qg.data());
+    }
+    {
+      StageTimer t(prof[3], m);
+      chain.transfer_chunk(i0, m, swe.data(), sm.data(), rech.data(), Qg.data(), out);
+    }
+  }
+}
+
+void pipeline_audit(int routing,
+                    const Forcing &f,
+                    const double *initCond,
+                    const double *param,
+                    OutputSink &out,
+                    std::vector<StoreBalance> &bal){
+  PipelineChain<NoProbe, ChainAudit> chain(routing, initCond, param, ChainAudit(bal));
+  SinkEmit emit(out);
+  pipeline_run(chain, f, emit);
+}
+
+void pipeline_sse(int routing,
+                  const Forcing &f,
+                  const double *initCond,
+                  const double *param,
+                  double bound,
+                  Objective &res){
+  PipelineChain<> chain(routing, initCond, param);
+  SseEmit emit(f.obs, bound);
+
+  res.steps  = pipeline_run(chain, f, emit);
+  res.sse    = emit.sse;
+  res.pruned = emit.pruned;
+}
+
+void pipeline_sse_memo(int routing,
+                       const Forcing &f,
+                       uint64_t fingerprint,
+                       const double *initCond,
+                       const double *param,
+                       double bound,
+                       Objective &res,
+                       StageCache &snow_memo,
+                       StageCache &soil_memo){
+  const double *p_snow = param;
+  const double *p_soil = param + 4;
+
+  // series de las etapas superiores (SWE0 y SM0 forman parte de la llave)
+  std::string up((const char*) &fingerprint, sizeof(uint64_t));
+  std::string k_snow = stage_key(up, initCond[0], p_snow, 4);
+  std::string k_soil = stage_key(k_snow, initCond[1], p_soil, 3);
+
+  std::shared_ptr<StageSeries> snow = snow_memo.get(k_snow, initCond[0], f.n);
+  std::shared_ptr<StageSeries> soil = soil_memo.get(k_soil, std::min(initCond[1], p_soil[0]), f.n);
+  std::lock_guard<std::mutex> lock_snow(snow->mtx);
+  std::lock_guard<std::mutex> lock_soil(soil->mtx);
+
+  // reservorios y HU de la cadena; nieve y suelo vienen de las cachés
+  PipelineChain<> chain(routing, initCond, param);
+  SseEmit emit(f.obs, bound);
+
+  int i = 0;
+  while (i < f.n) {
+    if (i == snow->done) {
+      snow->out[i] = snowmelt_step(f.airT[i], f.precip[i], p_snow, snow->state);
+      ++snow->done;
+    }
+    if (i == soil->done) {
+      soil->out[i] = soil_step(snow->out[i], f.pet[i], p_soil, soil->state);
+      ++soil->done;
+    }
+
+    double Qg = chain.route(soil->out[i]);
+    double Q  = chain.transfer(Qg);
+
+    // los estados de nieve y suelo de cada paso no se guardan en la caché
+    bool more = emit(i, 0.0, 0.0, soil->out[i], Qg, Q);
+    ++i;
+    if (!more) break;
+  }
+
+  res.sse    = emit.sse;
+  res.steps  = i;
+  res.pruned = emit.pruned;
+}
+
+void pipeline_sse_grad(int routing,
+                       const Forcing &f,
+                       const double *initCond,
+                       const double *param,
+                       double k,
+                       double &sse,
+                       double *grad){
+  int np = pipeline_nparam(routing);
+
+  // cada parámetro es una variable independiente
+  std::vector<Dual> p(np);
+  for (int j = 0; j < np; ++j) {
+    p[j] = Dual::variable(param[j], j);
+  }
+  const Dual *p_snow  = &p[0];
+  const Dual *p_soil  = &p[4];
+  const Dual *p_route = &p[7];
+
+  // estados iniciales
+  Dual SWE(initCond[0]);
+  Dual SM = (initCond[1] <= param[4]) ? Dual(initCond[1]) : p_soil[0];
+  Dual S[3];
+  for (int j = 0; j < route_nstore(routing); ++j) {
+    S[j] = Dual(initCond[2 + j]);
+  }
+  UHBuffer<Dual> uh;
+  uh.reset(p[np - 1]);
+
+  Dual acc;
+  for (int i = 0; i < f.n; ++i) {
+    Dual total = snowmelt_smooth(f.airT[i], f.precip[i], p_snow, SWE, k);
+    Dual rech  = soil_smooth(total, f.pet[i], p_soil, SM, k);
+    Dual Qg    = route_smooth(routing, rech, p_route, S, k);
+    Dual Q     = uh.step(Qg);
+
+    if (!std::isnan(f.obs[i])) {
+      Dual e = Q - f.obs[i];
+      acc += e * e;
+    }
+  }
+
+  sse = acc.v;
+  for (int j = 0; j < np; ++j) {
+    grad[j] = acc.d[j];
+  }
+}
@@ -0,0 +1,126 @@
+#ifndef HBV_PIPELINE_H
+#define HBV_PIPELINE_H
+
+#include <vector>
+#include <stdint.h>
+
+class StageCache;
+class OutputSink;
+struct StageProfile;
+struct StoreBalance;
+
+// **********************************************************
+//  Lumped HBV chain (SnowGlacier_HBV model 1 over soil ->
+//  Soil_HBV model 1 -> Routing_HBV without lake -> UH model 1)
+//  evaluated in a single time loop against observed discharge.
+//
+//  param   : SFCF, Tt, Tm, fm, FC, LP, beta, <routing param>, Bmax
+//  initCond: SWE0, SM0, <routing initCond>
+// **********************************************************
+
+struct Forcing {
+  int n;                 // number of time steps
+  const double *airT;    // air temperature [ºC/deltaT]
+  const double *precip;  // precipitation [mm/deltaT]
+  const double *pet;     // potential evapotranspiration [mm/deltaT]
+  const double *obs;     // observed discharge [mm/deltaT] (NaN: missing)
+};
+
+// forcing copied into native memory (Forcing_HBV handles). It can be
+// shared by several calibrations running at the same time.
+struct ForcingData {
+  std::vector<double> airT, precip, pet, obs;
+  uint64_t fingerprint;
+
+  Forcing view() const {
+    Forcing f;
+    f.n      = airT.size();
+    f.airT   = airT.data();
+    f.precip = precip.data();
+    f.pet    = pet.data();
+    f.obs    = obs.data();
+    return f;
+  }
+};
+
+struct Objective {
+  double sse;   // sum of squared errors up to 'steps'
+  int steps;    // time steps evaluated
+  bool pruned;  // true when the loop stopped because sse > bound
+};
+
+// The entry points below step the same stages (PipelineChain, see
+// aa_chain.h); they only differ in what they do with every time step.
+
+int pipeline_nparam(int routing);
+int pipeline_ninit(int routing);
+
+// NULL when the parameter vector is valid, otherwise the error message
+const char* pipeline_check(int routing,
+                           const double *param);
+
+// simulated series: SWE, SM, Rech, Qg and Qsim of every time step are
+// written into (or aggregated by) 'out', which must have 5 columns.
+// f.obs is not used.
+void pipeline_run(int routing,
+                  const Forcing &f,
+                  const double *initCond,
+                  const double *param,
+                  OutputSink &out);
+
+// pipeline_run() with instrumentation: the stages run one after the
+// other over chunks of the series and 'prof' gets the wall time and the
+// branch counters of the snow, soil, routing and uh stages (see
+// aa_probe.h). The output is the same as the one of pipeline_run().
+void pipeline_profile(int routing,
+                      const Forcing &f,
+                      const double *initCond,
+                      const double *param,
+                      OutputSink &out,
+                      std::vector<StageProfile> &prof);
+
+// pipeline_run() with the mass balance of the snow (SWE), soil (SM) and
+// of every routing bucket (SLZ, SUZ, STZ; transfers between buckets
+// included) in 'bal' (see aa_balance.h). The output is the same as the
+// one of pipeline_run().
+void pipeline_audit(int routing,
+                    const Forcing &f,
+                    const double *initCond,
+                    const double *param,
+                    OutputSink &out,
+                    std::vector<StoreBalance> &bal);
+
+// sum of squared errors. The time loop stops as soon as the partial
+// sum exceeds 'bound' (it can only grow from there on).
+void pipeline_sse(int routing,
+                  const Forcing &f,
+                  const double *initCond,
+                  const double *param,
+                  double bound,
+                  Objective &res);
+
+// as pipeline_sse() but the SnowGlacier_HBV and Soil_HBV outputs are read
+// from (and stored into) the stage caches, so candidates that only differ
+// in downstream parameters (routing, Bmax) skip the upstream stages.
+void pipeline_sse_memo(int routing,
+                       const Forcing &f,
+                       uint64_t fingerprint,
+                       const double *initCond,
+                       const double *param,
+                       double bound,
+                       Objective &res,
+                       StageCache &snow_memo,
+                       StageCache &soil_memo);
+
+// smooth formulation (see aa_smooth.h) with sharpness k. Returns the sum
+// of squared errors and its gradient with respect to every parameter in
+// a single forward-mode pass.
+void pipeline_sse_grad(int routing,
+                       const Forcing &f,
+                       const double *initCond,
+                       const double *param,
+                       double k,
+                       double &sse,
+                       double *grad);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef HBV_PROBE_H
+#define HBV_PROBE_H
+
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+
+// **********************************************************
+//  Opt-in instrumentation of the step functions (aa_core.h).
+//  The probe is a template argument of the steps: runs with
+//  NoProbe keep the plain kernels, only the profiled runs
+//  (Pipeline_HBV and SnowBands_HBV with profile = TRUE) pay
+//  for the counters and the clock.
+// **********************************************************
+
+// counters of one stage (or elevation band)
+struct StageProfile {
+  std::string name;
+  double seconds;        // wall time spent in the stage
+  long long steps;       // time steps processed
+  long long melt;        // steps with snow (or ice) melt
+  long long nomelt;      // steps without melt
+  long long overflow;    // soil: Def > FC
+  long long uzl;         // routing: STZ >= UZL (model 1), SUZ or SLZ > UZL (models 3, 5)
+  long long perc;        // routing: storage over PERC
+
+  explicit StageProfile(const std::string &name = "") :
+    name(name), seconds(0.0), steps(0), melt(0), nomelt(0),
+    overflow(0), uzl(0), perc(0) {}
+};
+
+// probe that counts the branch events into a StageProfile
+struct CountProbe {
+  StageProfile &p;
+
+  explicit CountProbe(StageProfile &p) : p(p) {}
+
+  void melt(bool m) { if (m) ++p.melt; else ++p.nomelt; }
+  void overflow()   { ++p.overflow; }
+  void evap(double) {}
+  void uzl()        { ++p.uzl; }
+  void perc()       { ++p.perc; }
+  void flux(int, double, double) {}
+};
+
+// adds the wall time of its scope (and 'steps') to the profile
+class StageTimer {
+public:
+  StageTimer(StageProfile &p, long long steps) :
+    p(p), start(std::chrono::steady_clock::now()) {
+    p.steps += steps;
+  }
+  ~StageTimer() {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    p.seconds += d.count();
+  }
+
+private:
+  StageProfile &p;
+  std::chrono::steady_clock::time_point start;
+};
+
+// buffers allocated by the stages since the last reset: output matrices,
+// aggregation accumulators and period index and the chunk buffers of the
+// profiled and pipelined runs (see Allocations_HBV()). Only these buffers,
+// whose size grows with the series, are counted, at the count_alloc() call
+// next to each of them: it is not a heap allocation counter. Small O(m) or
+// O(MAXBAS) bookkeeping (the parsed column names, the column map, UH
+// weights) and R's own objects are not counted. Stages that write into a
+// caller's matrix ('into') allocate none of the buffers.
+struct AllocCounter {
+  std::atomic<long long> buffers;
+  std::atomic<long long> bytes;
+
+  AllocCounter() : buffers(0), bytes(0) {}
+};
+
+inline AllocCounter& alloc_counter(){
+  static AllocCounter c;
+  return c;
+}
+
+inline void count_alloc(size_t bytes, int buffers = 1){
+  AllocCounter &c = alloc_counter();
+  c.buffers.fetch_add(buffers, std::memory_order_relaxed);
+  c.bytes.fetch_add( (long long) bytes, std::memory_order_relaxed );
+}
+
+#endif
@@ -1,11 +1,66 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
+#include "aa_scan.h"
 using namespace Rcpp;
 
+// pasos del modelo para scan_run(): las mismas cuentas que el bucle de
+// route_1r_2o(), con el estado SLZ
+struct Route1r2o {
+  static const int NS = 1;
+
+  double K1, K2, PERC;
+  double r1, r2;     // 1 / K1 - 1 y 1 / K2 - 1
+  double a1, a2;     // fracción que queda en cada reservorio
+  const double *R;   // escorrentía efectiva
+  double *out;       // n x 4
+  int n;
+
+  void step(int i, double *x) const {
+    double SLZ = x[0];
+    double Q1, Q2;
+
+    if (SLZ > PERC) {
+      Q1  = (SLZ - PERC + R[i]) * K1;
+      SLZ = r1 * Q1 + PERC;
+      Q2  = SLZ * K2;
+      SLZ = SLZ - Q2;
+    } else {
+      Q1  = 0.0;
+      Q2  = (SLZ + R[i]) * K2;
+      SLZ = r2 * Q2;
+    }
 
-// [[Rcpp::export]]
-NumericMatrix route_1r_2o(NumericMatrix inputData,
-                          NumericVector initCond,
-                          NumericVector param) {
+    out[i]         = Q2 + Q1;
+    out[i + n]     = Q1;
+    out[i + 2 * n] = Q2;
+    out[i + 3 * n] = SLZ;
+
+    x[0] = SLZ;
+  }
+
+  void state(int i, double *x) const {
+    x[0] = out[i + 3 * n];
+  }
+
+  // x' = A x + b en el régimen de x
+  void affine(int i, const double *x, Affine<1> &f) const {
+
+    if (x[0] > PERC) {
+      f.A[0][0] = a1 * (1 - K2);
+      f.b[0]    = (a1 * (R[i] - PERC) + PERC) * (1 - K2);
+    } else {
+      f.A[0][0] = a2;
+      f.b[0]    = a2 * R[i];
+    }
+  }
+};
+
+
+SEXP route_1r_2o(NumericMatrix inputData,
+                 NumericVector initCond,
+                 NumericVector param,
+                 const OutputSpec &spec,
+                 int chunks) {
   // *********************
   //  conditionals
   // *********************
@@ -38,7 +93,8 @@ NumericMatrix route_1r_2o(NumericMatrix inputData,
   // CASO 4: UN RESERVORIO CON DOS SALIDAS //
   int n = inputData.nrow(); //número de filas de matriz de salida
   int m = 4;                //número de columnas de matriz de salida
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Qg", "Q1", "Q2", "SLZ"});
 
   // Defino variables
   double K1, K2, PERC;  //parámetros
@@ -52,6 +108,26 @@ NumericMatrix route_1r_2o(NumericMatrix inputData,
 
   if ( (1.0 <= K1) | (K1 <= K2) ) {
     stop("Please verify: 1 > K1 > K2");
+  } else if ( (chunks != 1) && (out.data() == 0) ) {
+    // los tramos escriben las filas en cualquier orden: hace falta la salida
+    // completa, no un sumidero agregado o submuestreado
+    stop("parallel option can not be combined with aggregate, stride or columns");
+  } else if (chunks != 1) {
+    // series largas: tramos en paralelo (ver aa_scan.h)
+    Route1r2o k;
+    k.K1   = K1;
+    k.K2   = K2;
+    k.PERC = PERC;
+    k.r1   = 1 / K1 - 1;
+    k.r2   = 1 / K2 - 1;
+    k.a1   = k.r1 * K1;
+    k.a2   = k.r2 * K2;
+    k.R    = inputData.begin();
+    k.n    = n;
+    k.out  = out.data();
+
+    double x0[1] = {initCond[0]};
+    scan_run(k, n, x0, chunks);
   } else {
     for (int i = 0; i < n; ++i) {
       // Condiciones iniciales
@@ -83,9 +159,15 @@ NumericMatrix route_1r_2o(NumericMatrix inputData,
     } //cierre loop for()
   }
 
-  colnames(out) = CharacterVector::create("Qg", "Q1", "Q2", "SLZ");
-  return out;
+  return out.result();
 
 
 
 }
+
+// [[Rcpp::export]]
+NumericMatrix route_1r_2o(NumericMatrix inputData,
+                          NumericVector initCond,
+                          NumericVector param){
+  return route_1r_2o(inputData, initCond, param, OutputSpec(), 1);
+}
@@ -2,6 +2,15 @@
 #ifndef ROUTE_1R_2O_H
 #define ROUTE_1R_2O_H
 
+#include "aa_output.h"
+
+// chunks: see route_2r_2o()
+SEXP route_1r_2o(Rcpp::NumericMatrix inputData,
+                 Rcpp::NumericVector initCond,
+                 Rcpp::NumericVector param,
+                 const OutputSpec &spec,
+                 int chunks = 1);
+
 Rcpp::NumericMatrix route_1r_2o(Rcpp::NumericMatrix inputData,
                                 Rcpp::NumericVector initCond,
                                 Rcpp::NumericVector param);
@@ -1,11 +1,12 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
 using namespace Rcpp;
 
 
-// [[Rcpp::export]]
-NumericMatrix route_1r_3o(NumericMatrix inputData,
-                          NumericVector initCond,
-                          NumericVector param) {
+SEXP route_1r_3o(NumericMatrix inputData,
+                 NumericVector initCond,
+                 NumericVector param,
+                 const OutputSpec &spec) {
   // *********************
   //  conditionals
   // *********************
@@ -38,7 +39,8 @@ NumericMatrix route_1r_3o(NumericMatrix inputData,
   // CASO 5: UN RESERVORIO CON TRES SALIDAS //
   int n = inputData.nrow(); //número de filas de matriz de salida
   int m = 5;                //número de columnas de matriz de salida
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Qg", "Q0", "Q1", "Q2", "SLZ"});
 
   // Defino variables
   double K0, K1, K2, UZL, PERC;  //parámetros
@@ -103,9 +105,14 @@ NumericMatrix route_1r_3o(NumericMatrix inputData,
 
   }
 
-  colnames(out) = CharacterVector::create("Qg", "Q0", "Q1", "Q2", "SLZ");
-  return out;
+  return out.result();
 
 
 }
 
+// [[Rcpp::export]]
+NumericMatrix route_1r_3o(NumericMatrix inputData,
+                          NumericVector initCond,
+                          NumericVector param){
+  return route_1r_3o(inputData, initCond, param, OutputSpec());
+}
@@ -2,6 +2,13 @@
 #ifndef ROUTE_1R_3O_H
 #define ROUTE_1R_3O_H
 
+#include "aa_output.h"
+
+SEXP route_1r_3o(Rcpp::NumericMatrix inputData,
+                 Rcpp::NumericVector initCond,
+                 Rcpp::NumericVector param,
+                 const OutputSpec &spec);
+
 Rcpp::NumericMatrix route_1r_3o(Rcpp::NumericMatrix inputData,
                                 Rcpp::NumericVector initCond,
                                 Rcpp::NumericVector param);
@@ -1,12 +1,90 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
+#include "aa_scan.h"
 using namespace Rcpp;
 
+// pasos del modelo para scan_run(): las mismas cuentas que el bucle de
+// route_2r_2o(), con estados SUZ y SLZ
+struct Route2r2o {
+  static const int NS = 2;
+
+  bool lake;
+  double K1, K2, PERC;
+  double r1, r2;             // 1 / K1 - 1 y 1 / K2 - 1
+  double a1, a2;             // fracción que queda en cada reservorio
+  const double *R, *P, *E;   // escorrentía efectiva, precipitación y evaporación del lago
+  double *out;               // n x 5
+  int n;
+
+  void step(int i, double *x) const {
+    double SUZ = x[0], SLZ = x[1];
+    double UpLow, Q1, Q2;
+
+    if (SUZ >= PERC) {
+      UpLow = PERC;
+      Q1    = (SUZ + R[i] - UpLow) * K1;
+      SUZ   = r1 * Q1;
+    } else {
+      UpLow = SUZ;
+      Q1    = 0.0;
+      SUZ   = R[i];
+    }
 
-// [[Rcpp::export]]
-NumericMatrix route_2r_2o(bool lake,
-                          NumericMatrix inputData,
-                          NumericVector initCond,
-                          NumericVector param) {
+    if (lake == false) {
+      Q2  = (SLZ + UpLow) * K2;
+      SLZ = r2 * Q2;
+    } else if (SLZ + P[i] >= E[i]) {
+      Q2  = (SLZ + P[i] - E[i] + UpLow) * K2;
+      SLZ = r2 * Q2;
+    } else {
+      Q2  = 0.0;
+      SLZ = UpLow;
+    }
+
+    out[i]         = Q2 + Q1;
+    out[i + n]     = Q1;
+    out[i + 2 * n] = Q2;
+    out[i + 3 * n] = SUZ;
+    out[i + 4 * n] = SLZ;
+
+    x[0] = SUZ;
+    x[1] = SLZ;
+  }
+
+  void state(int i, double *x) const {
+    x[0] = out[i + 3 * n];
+    x[1] = out[i + 4 * n];
+  }
+
+  // x' = A x + b en el régimen de x
+  void affine(int i, const double *x, Affine<2> &f) const {
+    double up[2];                // UpLow = up[0] * SUZ + up[1]
+
+    if (x[0] >= PERC) {
+      f.A[0][0] = a1;  f.A[0][1] = 0.0;  f.b[0] = a1 * (R[i] - PERC);
+      up[0] = 0.0;     up[1] = PERC;
+    } else {
+      f.A[0][0] = 0.0; f.A[0][1] = 0.0;  f.b[0] = R[i];
+      up[0] = 1.0;     up[1] = 0.0;
+    }
+
+    if (lake == false) {
+      f.A[1][0] = a2 * up[0];  f.A[1][1] = a2;   f.b[1] = a2 * up[1];
+    } else if (x[1] + P[i] >= E[i]) {
+      f.A[1][0] = a2 * up[0];  f.A[1][1] = a2;   f.b[1] = a2 * (P[i] - E[i] + up[1]);
+    } else {
+      f.A[1][0] = up[0];       f.A[1][1] = 0.0;  f.b[1] = up[1];
+    }
+  }
+};
+
+
+SEXP route_2r_2o(bool lake,
+                 NumericMatrix inputData,
+                 NumericVector initCond,
+                 NumericVector param,
+                 const OutputSpec &spec,
+                 int chunks) {
   // *********************
   //  conditionals
   // *********************
@@ -53,7 +131,8 @@ NumericMatrix route_2r_2o(bool lake,
   // CASO 2: DOS RESERVORIOS EN SERIE //
   int n = inputData.nrow(); //número de filas de matriz de salida
   int m = 5;                //número de columnas de matriz de salida
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Qg", "Q1", "Q2", "SUZ", "SLZ"});
 
   // Defino variables
   double K1, K2, PERC; //parámetros
@@ -68,6 +147,29 @@ NumericMatrix route_2r_2o(bool lake,
 
   if ( (1.0 <= K1) | (K1 <= K2) ) {
     stop("Please verify: 1 > K1 > K2");
+  } else if ( (chunks != 1) && (out.data() == 0) ) {
+    // los tramos escriben las filas en cualquier orden: hace falta la salida
+    // completa, no un sumidero agregado o submuestreado
+    stop("parallel option can not be combined with aggregate, stride or columns");
+  } else if (chunks != 1) {
+    // series largas: tramos en paralelo (ver aa_scan.h)
+    Route2r2o k;
+    k.lake = lake;
+    k.K1   = K1;
+    k.K2   = K2;
+    k.PERC = PERC;
+    k.r1   = 1 / K1 - 1;
+    k.r2   = 1 / K2 - 1;
+    k.a1   = k.r1 * K1;
+    k.a2   = k.r2 * K2;
+    k.R    = inputData.begin();
+    k.P    = lake ? inputData.begin() + n : 0;
+    k.E    = lake ? inputData.begin() + 2 * n : 0;
+    k.n    = n;
+    k.out  = out.data();
+
+    double x0[2] = {initCond[1], initCond[0]};
+    scan_run(k, n, x0, chunks);
   } else {
     for (int i = 0; i < n; ++i){
 
@@ -122,9 +224,16 @@ NumericMatrix route_2r_2o(bool lake,
     } //cierre loop for()
   }
 
-  colnames(out) = CharacterVector::create("Qg", "Q1", "Q2", "SUZ", "SLZ");
-  return(out);
+  return out.result();
 
 
 
 }
+
+// [[Rcpp::export]]
+NumericMatrix route_2r_2o(bool lake,
+                          NumericMatrix inputData,
+                          NumericVector initCond,
+                          NumericVector param){
+  return route_2r_2o(lake, inputData, initCond, param, OutputSpec(), 1);
+}
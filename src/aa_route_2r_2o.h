@@ -2,6 +2,18 @@
 #ifndef ROUTE_2R_2O_H
 #define ROUTE_2R_2O_H
 
+#include "aa_output.h"
+
+// chunks: 1 runs the sequential loop; otherwise the series is split in
+// that many chunks (<= 0: one per worker of the shared pool), see
+// aa_scan.h. Both give the same output.
+SEXP route_2r_2o(bool lake,
+                 Rcpp::NumericMatrix inputData,
+                 Rcpp::NumericVector initCond,
+                 Rcpp::NumericVector param,
+                 const OutputSpec &spec,
+                 int chunks = 1);
+
 Rcpp::NumericMatrix route_2r_2o(bool lake,
                                 Rcpp::NumericMatrix inputData,
                                 Rcpp::NumericVector initCond,
@@ -1,12 +1,13 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
 using namespace Rcpp;
 
 
-// [[Rcpp::export]]
-NumericMatrix route_2r_3o(bool lake,
+SEXP route_2r_3o(bool lake,
                          NumericMatrix inputData,
                          NumericVector initCond,
-                         NumericVector param) {
+                         NumericVector param,
+                 const OutputSpec &spec) {
   // *********************
   //  conditionals
   // *********************
@@ -53,7 +54,8 @@ NumericMatrix route_2r_3o(bool lake,
   // CASO 3: DOS RESERVORIOS EN SERIE CON TRES SALIDAS //
   int n = inputData.nrow(); //número de filas de matriz de salida
   int m = 6;                //número de columnas de matriz de salida
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Qg", "Q0", "Q1", "Q2", "SUZ", "SLZ"});
 
   // Defino variables
   double K0, K1, K2, UZL, PERC; //parámetros
@@ -148,8 +150,15 @@ NumericMatrix route_2r_3o(bool lake,
 
   }
 
-  colnames(out) = CharacterVector::create("Qg", "Q0", "Q1", "Q2", "SUZ", "SLZ");
-  return out;
+  return out.result();
 
 
 }
+
+// [[Rcpp::export]]
+NumericMatrix route_2r_3o(bool lake,
+                         NumericMatrix inputData,
+                         NumericVector initCond,
+                         NumericVector param){
+  return route_2r_3o(lake, inputData, initCond, param, OutputSpec());
+}
@@ -2,6 +2,14 @@
 #ifndef ROUTE_2R_3O_H
 #define ROUTE_2R_3O_H
 
+#include "aa_output.h"
+
+SEXP route_2r_3o(bool lake,
+                 Rcpp::NumericMatrix inputData,
+                 Rcpp::NumericVector initCond,
+                 Rcpp::NumericVector param,
+                 const OutputSpec &spec);
+
 Rcpp::NumericMatrix route_2r_3o(bool lake,
                                 Rcpp::NumericMatrix inputData,
                                 Rcpp::NumericVector initCond,
@@ -1,12 +1,13 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
 using namespace Rcpp;
 
 
-// [[Rcpp::export]]
-NumericMatrix route_3r_3o(bool lake,
-                          NumericMatrix inputData,
-                          NumericVector initCond,
-                          NumericVector param) {
+SEXP route_3r_3o(bool lake,
+                 NumericMatrix inputData,
+                 NumericVector initCond,
+                 NumericVector param,
+                 const OutputSpec &spec) {
   // *********************
   //  conditionals
   // *********************
@@ -57,7 +58,8 @@ NumericMatrix route_3r_3o(bool lake,
   // CASO 1: TRES RESERVORIOS EN SERIE //
   int n = inputData.nrow(); //número de filas de matriz de salida
   int m = 7;                //número de columnas de matriz de salida
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Qg", "Q0", "Q1", "Q2", "STZ", "SUZ", "SLZ"});
 
   // Defino variables
   double K0, K1, K2, UZL, PERC; //parámetros
@@ -142,8 +144,15 @@ NumericMatrix route_3r_3o(bool lake,
 
   }
 
-  colnames(out) = CharacterVector::create("Qg", "Q0", "Q1", "Q2", "STZ", "SUZ", "SLZ");
-  return out;
+  return out.result();
+
 
+}
 
+// [[Rcpp::export]]
+NumericMatrix route_3r_3o(bool lake,
+                          NumericMatrix inputData,
+                          NumericVector initCond,
+                          NumericVector param){
+  return route_3r_3o(lake, inputData, initCond, param, OutputSpec());
 }
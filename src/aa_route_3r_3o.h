@@ -2,6 +2,14 @@
 #ifndef ROUTE_3R_3O_H
 #define ROUTE_3R_3O_H
 
+#include "aa_output.h"
+
+SEXP route_3r_3o(bool lake,
+                 Rcpp::NumericMatrix inputData,
+                 Rcpp::NumericVector initCond,
+                 Rcpp::NumericVector param,
+                 const OutputSpec &spec);
+
 Rcpp::NumericMatrix route_3r_3o(bool lake,
                                 Rcpp::NumericMatrix inputData,
                                 Rcpp::NumericVector initCond,
@@ -0,0 +1,178 @@
+#ifndef HBV_SCAN_H
+#define HBV_SCAN_H
+
+#include <cmath>
+#include <cfloat>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include "aa_threadpool.h"
+
+// **********************************************************
+//  Chunked evaluation of a piecewise affine state recurrence
+//  (the routing reservoirs). Within one regime (threshold not
+//  crossed) a step is x' = A x + b, and affine maps compose
+//  associatively, so:
+//
+//   1. every chunk composes its step maps (parallel), choosing
+//      the regimes from a guessed start state;
+//   2. the chunk maps are scanned to estimate the start state
+//      of every chunk;
+//   3. every chunk runs the original step from its estimate
+//      (parallel);
+//   4. chunk by chunk, the true end state of the previous one is
+//      compared with the estimate: when they differ (a regime
+//      switch the guess missed, or rounding) the chunk is run
+//      again sequentially until its states meet the stored ones.
+//
+//  Step 4 makes the result identical to the sequential loop;
+//  it is short because the estimates are usually exact or one
+//  rounding away, and the reservoirs forget their start state.
+//
+//  A Kernel provides:
+//    NS                number of states
+//    affine(i, x, f)   map of step i in the regime of state x
+//    step(i, x)        original step i: updates x and writes
+//                      output row i
+//    state(i, x)       states after step i, read from the output
+// **********************************************************
+
+template <int NS>
+struct Affine {
+  double A[NS][NS];
+  double b[NS];
+
+  void identity(){
+    for (int r = 0; r < NS; ++r) {
+      for (int c = 0; c < NS; ++c) A[r][c] = (r == c) ? 1.0 : 0.0;
+      b[r] = 0.0;
+    }
+  }
+
+  // f(x) does not depend on x
+  bool constant() const {
+    for (int r = 0; r < NS; ++r) {
+      for (int c = 0; c < NS; ++c) {
+        if (A[r][c] != 0.0) return false;
+      }
+    }
+    return true;
+  }
+
+  // y = f(x)
+  void apply(const double *x, double *y) const {
+    for (int r = 0; r < NS; ++r) {
+      double v = b[r];
+      for (int c = 0; c < NS; ++c) v += A[r][c] * x[c];
+      y[r] = v;
+    }
+  }
+
+  // this = f o this
+  void then(const Affine &f){
+    Affine g;
+    for (int r = 0; r < NS; ++r) {
+      g.b[r] = f.b[r];
+      for (int c = 0; c < NS; ++c) {
+        g.A[r][c] = 0.0;
+        for (int k = 0; k < NS; ++k) g.A[r][c] += f.A[r][k] * A[k][c];
+        // un reservorio olvida su inicio: los coeficientes subnormales
+        // (lentísimos) se llevan a cero, la estimación no los necesita
+        if (std::fabs(g.A[r][c]) < DBL_MIN) g.A[r][c] = 0.0;
+        g.b[r] += f.A[r][c] * b[c];
+      }
+    }
+    *this = g;
+  }
+};
+
+// shortest chunk worth a task [time steps]
+#define HBV_SCAN_MIN 16384
+
+// runs the n steps of 'k' from the states x0 with up to 'nchunk' chunks on
+// the shared pool (<= 0: one per worker). Must not be called from a pool
+// task.
+template <class Kernel>
+void scan_run(const Kernel &k,
+              int n,
+              const double *x0,
+              int nchunk){
+  const int NS = Kernel::NS;
+
+  if (nchunk <= 0) {
+    nchunk = shared_pool().size();
+  }
+  nchunk = std::max(1, std::min(nchunk, n / HBV_SCAN_MIN));
+
+  if (nchunk == 1) {
+    double x[NS];
+    std::copy(x0, x0 + NS, x);
+    for (int i = 0; i < n; ++i) k.step(i, x);
+    return;
+  }
+
+  // límites de los tramos
+  std::vector<int> lo(nchunk + 1);
+  for (int j = 0; j <= nchunk; ++j) lo[j] = (int) ( (double) n * j / nchunk );
+
+  // 1. mapa compuesto de cada tramo, con los regímenes que resultan de
+  //    empezar en x0 (el último no hace falta)
+  std::vector< Affine<NS> > F(nchunk);
+  TaskGroup group;
+  for (int j = 0; j < nchunk - 1; ++j) {
+    shared_pool().submit([&k, &F, &lo, x0, j](){
+      double s[NS], t[NS];
+      std::copy(x0, x0 + NS, s);
+      Affine<NS> f, acc;
+      acc.identity();
+      bool forgot = false;
+      for (int i = lo[j]; i < lo[j + 1]; ++i) {
+        k.affine(i, s, f);
+        f.apply(s, t);
+        std::copy(t, t + NS, s);
+        // una vez que el tramo olvidó su inicio el mapa es constante (s)
+        if (!forgot) {
+          acc.then(f);
+          forgot = acc.constant();
+        }
+      }
+      if (forgot) {
+        std::copy(s, s + NS, acc.b);
+      }
+      F[j] = acc;
+    }, group);
+  }
+  group.wait();
+
+  // 2. inicio estimado de cada tramo
+  std::vector<double> start( (size_t) nchunk * NS );
+  std::copy(x0, x0 + NS, start.begin());
+  for (int j = 1; j < nchunk; ++j) {
+    F[j - 1].apply(&start[(size_t) (j - 1) * NS], &start[(size_t) j * NS]);
+  }
+
+  // 3. todos los tramos desde su inicio estimado
+  for (int j = 0; j < nchunk; ++j) {
+    shared_pool().submit([&k, &lo, &start, j](){
+      double s[NS];
+      std::copy(&start[(size_t) j * NS], &start[(size_t) j * NS] + NS, s);
+      for (int i = lo[j]; i < lo[j + 1]; ++i) k.step(i, s);
+    }, group);
+  }
+  group.wait();
+
+  // 4. reparo en orden hasta que los estados coinciden con los guardados
+  for (int j = 1; j < nchunk; ++j) {
+    double s[NS], spec[NS];
+    k.state(lo[j] - 1, s);
+    if (std::memcmp(s, &start[(size_t) j * NS], sizeof(s)) == 0) continue;
+
+    for (int i = lo[j]; i < lo[j + 1]; ++i) {
+      k.state(i, spec);
+      k.step(i, s);
+      if (std::memcmp(s, spec, sizeof(s)) == 0) break;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef HBV_SMOOTH_H
+#define HBV_SMOOTH_H
+
+#include <cmath>
+#include <algorithm>
+#include "aa_core.h"
+
+// **********************************************************
+//  Smooth (differentiable) formulation of the lumped chain
+//  and forward-mode dual numbers to carry its gradient.
+//
+//  Every threshold of the original kernels (rain/snow split,
+//  melt temperature, SWE == 0, soil clamping, reservoir
+//  switches) is replaced by a sigmoid blend or a softplus of
+//  sharpness k [1/ºC or 1/mm]. The original model is the
+//  limit k -> Inf.
+// **********************************************************
+
+// maximum number of parameters carried by a dual number
+#define HBV_NDUAL 16
+
+struct Dual {
+  double v;                // value
+  double d[HBV_NDUAL];     // partial derivatives
+
+  Dual() : v(0.0) { zero(); }
+  Dual(double x) : v(x) { zero(); }
+
+  void zero(){
+    for (int k = 0; k < HBV_NDUAL; ++k) d[k] = 0.0;
+  }
+
+  // independent variable number 'k'
+  static Dual variable(double x, int k){
+    Dual out(x);
+    out.d[k] = 1.0;
+    return out;
+  }
+
+  Dual& operator+=(const Dual &b){
+    v += b.v;
+    for (int k = 0; k < HBV_NDUAL; ++k) d[k] += b.d[k];
+    return *this;
+  }
+};
+
+inline double value(const Dual &x){
+  return x.v;
+}
+
+// f(x) given f and f'(x)
+inline Dual chain(const Dual &x, double f, double df){
+  Dual out;
+  out.v = f;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = df * x.d[k];
+  return out;
+}
+
+inline Dual operator+(const Dual &a, const Dual &b){
+  Dual out;
+  out.v = a.v + b.v;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = a.d[k] + b.d[k];
+  return out;
+}
+
+inline Dual operator-(const Dual &a, const Dual &b){
+  Dual out;
+  out.v = a.v - b.v;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = a.d[k] - b.d[k];
+  return out;
+}
+
+inline Dual operator*(const Dual &a, const Dual &b){
+  Dual out;
+  out.v = a.v * b.v;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = a.d[k] * b.v + a.v * b.d[k];
+  return out;
+}
+
+inline Dual operator/(const Dual &a, const Dual &b){
+  Dual out;
+  out.v = a.v / b.v;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = (a.d[k] - out.v * b.d[k]) / b.v;
+  return out;
+}
+
+inline Dual operator+(const Dual &a, double b){ return chain(a, a.v + b, 1.0); }
+inline Dual operator+(double a, const Dual &b){ return chain(b, a + b.v, 1.0); }
+inline Dual operator-(const Dual &a, double b){ return chain(a, a.v - b, 1.0); }
+inline Dual operator-(double a, const Dual &b){ return chain(b, a - b.v, -1.0); }
+inline Dual operator*(const Dual &a, double b){ return chain(a, a.v * b, b); }
+inline Dual operator*(double a, const Dual &b){ return chain(b, a * b.v, a); }
+inline Dual operator/(const Dual &a, double b){ return chain(a, a.v / b, 1.0 / b); }
+inline Dual operator/(double a, const Dual &b){ return chain(b, a / b.v, -a / (b.v * b.v)); }
+inline Dual operator-(const Dual &a){ return chain(a, -a.v, -1.0); }
+
+inline Dual abs(const Dual &x){
+  return chain(x, std::abs(x.v), (x.v < 0.0) ? -1.0 : 1.0);
+}
+
+inline Dual exp(const Dual &x){
+  double e = std::exp(x.v);
+  return chain(x, e, e);
+}
+
+// x^b for x >= 0 (0 when x <= 0)
+inline double pow_pos(double x, double b){
+  return (x > 0.0) ? std::pow(x, b) : 0.0;
+}
+
+inline Dual pow_pos(const Dual &x, const Dual &b){
+  Dual out;
+  if (x.v <= 0.0) return out;
+
+  double p  = std::pow(x.v, b.v);
+  double dx = b.v * p / x.v;
+  double db = p * std::log(x.v);
+
+  out.v = p;
+  for (int k = 0; k < HBV_NDUAL; ++k) out.d[k] = dx * x.d[k] + db * b.d[k];
+  return out;
+}
+
+// logistic function 1 / (1 + exp(-k x))
+inline double sigmoid(double x, double k){
+  double z = k * x;
+  if (z >= 0.0) {
+    return 1.0 / (1.0 + std::exp(-z));
+  }
+  double e = std::exp(z);
+  return e / (1.0 + e);
+}
+
+inline Dual sigmoid(const Dual &x, double k){
+  double s = sigmoid(x.v, k);
+  return chain(x, s, k * s * (1.0 - s));
+}
+
+// smooth max(x, 0): log(1 + exp(k x)) / k
+inline double softplus(double x, double k){
+  double z = k * x;
+  return ( std::max(z, 0.0) + std::log1p(std::exp(-std::abs(z))) ) / k;
+}
+
+inline Dual softplus(const Dual &x, double k){
+  return chain(x, softplus(x.v, k), sigmoid(x.v, k));
+}
+
+// smooth min(a, b)
+template <class T>
+inline T softmin(const T &a, const T &b, double k){
+  return a - softplus(a - b, k);
+}
+
+// s * a + (1 - s) * b
+template <class T>
+inline T blend(const T &s, const T &a, const T &b){
+  return b + s * (a - b);
+}
+
+// snowmelt_step() counterpart. param: SFCF, Tt, Tm, fm
+template <class T>
+inline T snowmelt_smooth(double airT,
+                         double precip,
+                         const T *param,
+                         T &SWE,
+                         double k){
+  T fr    = sigmoid(airT - param[1], k);   // rainfall fraction
+  T Prain = precip * fr;
+  T Psnow = precip * (1.0 - fr) * param[0];
+  T Mpot  = softplus(airT - param[2], k) * param[3];
+  // softmin() alone gives about -log(2)/k when Mpot and SWE are both near
+  // zero (cold, snow-free steps), i.e. negative melt. The softplus keeps
+  // melt and Total non-negative; SWE may then undershoot zero by O(1/k).
+  T Msnow = softplus(softmin(Mpot, SWE, k), k);
+
+  SWE = SWE + Psnow - Msnow;
+
+  return (Msnow + Prain);
+}
+
+// soil_step() counterpart. param: FC, LP, beta
+template <class T>
+inline T soil_smooth(const T &total,
+                     double pet,
+                     const T *param,
+                     T &SM,
+                     double k){
+  T FC   = param[0];
+  T FCLP = param[0] * param[1];
+
+  T Eac  = pet * softmin(SM, FCLP, k) / FCLP;
+  T Ieff = total * pow_pos(SM / FC, param[2]);
+  T Def  = SM + total - Ieff - Eac;
+
+  // 0 <= SM <= FC; the excess over FC goes to recharge
+  T SMp  = softplus(Def, k);
+  T SMn  = FC - softplus(FC - SMp, k);
+
+  SM = SMn;
+
+  return (Ieff + (SMp - SMn));
+}
+
+// route_step() counterpart: both sides of every switch are evaluated
+// and blended, so each branch keeps its own mass balance.
+template <class T>
+inline T route_smooth(int model,
+                      const T &rech,
+                      const T *param,
+                      T *S,
+                      double k){
+  if (model == 1) {
+    // K0, K1, K2, UZL, PERC
+    T s0    = sigmoid(S[2] - param[3], k);
+    T Q0    = s0 * (S[2] + rech - param[3]) * param[0];
+    T TopUp = blend(s0, param[3], S[2]);
+    S[2]    = blend(s0, (1.0 - param[0]) * (S[2] + rech - param[3]), rech);
+
+    T s1    = sigmoid(S[1] - param[4], k);
+    T Q1    = s1 * (S[1] + TopUp - param[4]) * param[1];
+    T UpLow = blend(s1, param[4], S[1]);
+    S[1]    = blend(s1, (1.0 - param[1]) * (S[1] + TopUp - param[4]), TopUp);
+
+    T Q2 = (S[0] + UpLow) * param[2];
+    S[0] = (1.0 / param[2] - 1.0) * Q2;
+
+    return (Q2 + Q1 + Q0);
+
+  } else if (model == 2) {
+    // K1, K2, PERC
+    T s1    = sigmoid(S[1] - param[2], k);
+    T Q1    = s1 * (S[1] + rech - param[2]) * param[0];
+    T UpLow = blend(s1, param[2], S[1]);
+    S[1]    = blend(s1, (1.0 - param[0]) * (S[1] + rech - param[2]), rech);
+
+    T Q2 = (S[0] + UpLow) * param[1];
+    S[0] = (1.0 / param[1] - 1.0) * Q2;
+
+    return (Q2 + Q1);
+
+  } else if (model == 3) {
+    // K0, K1, K2, UZL, PERC
+    // SUZ > UZL
+    T s0    = sigmoid(S[1] - param[3], k);
+    T Q0a   = (S[1] - param[3] + rech) * param[0];
+    T SUZa  = (1.0 / param[0] - 1.0) * Q0a + param[3];
+    T sa    = sigmoid(SUZa - param[4], k);
+    T Q1a   = sa * (SUZa - param[4]) * param[1];
+    T ULa   = blend(sa, param[4], SUZa);
+    SUZa    = sa * (1.0 - param[1]) * (SUZa - param[4]);
+
+    // SUZ <= UZL
+    T sb    = sigmoid(S[1] - param[4], k);
+    T Q1b   = sb * (S[1] + rech - param[4]) * param[1];
+    T ULb   = blend(sb, param[4], S[1]);
+    T SUZb  = blend(sb, (1.0 - param[1]) * (S[1] + rech - param[4]), rech);
+
+    T Q0    = s0 * Q0a;
+    T Q1    = blend(s0, Q1a, Q1b);
+    T UpLow = blend(s0, ULa, ULb);
+    S[1]    = blend(s0, SUZa, SUZb);
+
+    T Q2 = (S[0] + UpLow) * param[2];
+    S[0] = (1.0 / param[2] - 1.0) * Q2;
+
+    return (Q2 + Q1 + Q0);
+
+  } else if (model == 4) {
+    // K1, K2, PERC
+    T s1  = sigmoid(S[0] - param[2], k);
+
+    T Q1a = (S[0] - param[2] + rech) * param[0];
+    T Sa  = (1.0 / param[0] - 1.0) * Q1a + param[2];
+    T Q2a = Sa * param[1];
+    Sa    = Sa - Q2a;
+
+    T Q2b = (S[0] + rech) * param[1];
+    T Sb  = (1.0 / param[1] - 1.0) * Q2b;
+
+    S[0] = blend(s1, Sa, Sb);
+
+    return (s1 * Q1a + blend(s1, Q2a, Q2b));
+
+  } else {
+    // K0, K1, K2, UZL, PERC
+    T sU  = sigmoid(S[0] - param[3], k);
+    T sP  = sigmoid(S[0] - param[4], k);
+
+    // SLZ > UZL
+    T Q0a = (S[0] - param[3] + rech) * param[0];
+    T Sa  = (1.0 / param[0] - 1.0) * Q0a + param[3];
+    T Q1a = (Sa - param[4]) * param[1];
+    Sa    = (1.0 / param[1] - 1.0) * Q1a + param[4];
+    T Q2a = Sa * param[2];
+    Sa    = Sa - Q2a;
+
+    // PERC < SLZ <= UZL
+    T Q1b = (S[0] - param[4] + rech) * param[1];
+    T Sb  = (1.0 / param[1] - 1.0) * Q1b + param[4];
+    T Q2b = Sb * param[2];
+    Sb    = Sb - Q2b;
+
+    // SLZ <= PERC
+    T Q2c = (S[0] + rech) * param[2];
+    T Sc  = (1.0 / param[2] - 1.0) * Q2c;
+
+    T Qa = Q0a + Q1a + Q2a;
+    T Qb = Q1b + Q2b;
+
+    S[0] = blend(sU, Sa, blend(sP, Sb, Sc));
+
+    return blend(sU, Qa, blend(sP, Qb, Q2c));
+  }
+}
+
+#endif
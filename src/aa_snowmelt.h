@@ -2,6 +2,13 @@
 #ifndef SNOWMELT
 #define SNOWMELT
 
+#include "aa_output.h"
+
+SEXP snowmelt(Rcpp::NumericMatrix inputData,
+              Rcpp::NumericVector initCond,
+              Rcpp::NumericVector param,
+              const OutputSpec &spec);
+
 Rcpp::NumericMatrix snowmelt(Rcpp::NumericMatrix inputData,
                              Rcpp::NumericVector initCond,
                              Rcpp::NumericVector param);
@@ -1,30 +1,33 @@
 #include <Rcpp.h>
+#include "aa_stage.h"
+#include "aa_partition.h"
 using namespace Rcpp;
 
 
-// [[Rcpp::export]]
-NumericMatrix snowmelt_sca(NumericMatrix inputData,
-                           NumericVector initCond,
-                           NumericVector param){
+SEXP snowmelt_sca(NumericMatrix inputData,
+                  NumericVector initCond,
+                  NumericVector param,
+                  const OutputSpec &spec){
 
   // Genero el vector de salida
   int n = inputData.nrow(); // número filas
   int m = 6;                // número de columnas
-  NumericMatrix out(n, m);
+  StageOutput out(n, m, spec,
+                  {"Prain", "Psnow", "SWE", "Msnow", "Total", "TotScal"});
 
   // Declaro variables que voy a utilizar y nombre de parámetros
-  double Prain, Psnow, SWE, Msnow, Total, TotScal;
+  double SWE, Msnow;
   double SCA;
   bool flag;
-  double SFCF, Tt, Tm, fm;
+  double Tm;
+  SnowForcing f;
 
-  // Asigno valores a los parámetros
-  SFCF = param[0];
-  Tt   = param[1];
+  // Asigno valores a los parámetros (SFCF, Tt, Tm, fm)
+  const double *par = param.begin();
   Tm   = param[2];
-  fm   = param[3];
 
   // Corro rutina nival
+  SWE = initCond[0];
   for (int i = 0; i < n; ++i){
 
     // Verifico si SCA[i] == NA (true) o no (false)
@@ -43,53 +46,30 @@ NumericMatrix snowmelt_sca(NumericMatrix inputData,
       }
     }
 
-    // Precipitación líquida o sólida
-    if (inputData(i, 0) > Tt){
-      Prain = inputData(i, 1);
-      Psnow = 0.0;
-    } else {
-      Prain = 0.0;
-      Psnow = inputData(i, 1) * SFCF;
-    }
+    // Precipitación líquida o sólida y derretimiento potencial: no
+    // dependen de SWE
+    f = snow_partition(inputData(i, 0), inputData(i, 1), par);
 
-    // Nieve derretida
-    if (i == 0) {SWE = initCond[0];} //me aeguro el condicional para la primer corrida
-    if (inputData(i, 0) > Tm) {//temperatura del aire MAYOR a Tmelt
-
-      if (SWE == 0.0) { //no hay nieve
-
-        Msnow   = 0.0;
-        SWE    += Psnow - Msnow;
-        Total   = (Msnow + Prain);
-        TotScal = (Msnow * SCA + Prain);
-
-      } else { //hay nieve
-
-        Msnow = std::min( (inputData(i, 0) - Tm) * fm, SWE);
-        SWE  += Psnow - Msnow;
-        Total = (Msnow + Prain);
-        TotScal = (Msnow * SCA + Prain);
-      }
-    } else {//temperatura del aire MENOR a Tmelt
-
-      Msnow = 0.0;
-      SWE  += Psnow - Msnow;
-      Total = (Msnow + Prain);
-      TotScal = (Msnow * SCA + Prain);
-
-    }
+    // Nieve derretida: SWE es lo único que pasa de un paso al otro
+    Msnow = snow_melt(inputData(i, 0), Tm, f.Mpot, SWE);
+    SWE  += f.Psnow - Msnow;
 
     // Relleno matriz de salida
-    out(i, 0) = Prain;
-    out(i, 1) = Psnow;
+    out(i, 0) = f.Prain;
+    out(i, 1) = f.Psnow;
     out(i, 2) = SWE;
     out(i, 3) = Msnow;
-    out(i, 4) = Total;
-    out(i, 5) = TotScal;
-
+    out(i, 4) = (Msnow + f.Prain);
+    out(i, 5) = (Msnow * SCA + f.Prain);
   }
 
-  colnames(out) = CharacterVector::create("Prain", "Psnow", "SWE", "Msnow", "Total", "TotScal");
-  return out;
+  return out.result();
+
+}
 
+// [[Rcpp::export]]
+NumericMatrix snowmelt_sca(NumericMatrix inputData,
+                           NumericVector initCond,
+                           NumericVector param){
+  return snowmelt_sca(inputData, initCond, param, OutputSpec());
 }
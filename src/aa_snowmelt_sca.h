@@ -2,6 +2,13 @@
 #ifndef SNOWMELT_SCA
 #define SNOWMELT_SCA
 
+#include "aa_output.h"
+
+SEXP snowmelt_sca(Rcpp::NumericMatrix inputData,
+                  Rcpp::NumericVector initCond,
+                  Rcpp::NumericVector param,
+                  const OutputSpec &spec);
+
 Rcpp::NumericMatrix snowmelt_sca(Rcpp::NumericMatrix inputData,
                                  Rcpp::NumericVector initCond,
                                  Rcpp::NumericVector param);
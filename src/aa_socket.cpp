@@ -0,0 +1,243 @@
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "aa_socket.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+typedef int socklen_t;
+#define CLOSE_SOCKET closesocket
+#else
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+typedef int socket_t;
+#define CLOSE_SOCKET ::close
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+// Winsock se inicia una sola vez por proceso
+static void socket_init(){
+#if defined(_WIN32)
+  static std::once_flag once;
+  std::call_once(once, [](){
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+  });
+#endif
+}
+
+static sockaddr_in socket_address(const std::string &host, int port){
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port   = htons( (unsigned short) port );
+
+  if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+    // nombre de equipo (p.ej.: localhost)
+    addrinfo hints, *res = 0;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), 0, &hints, &res) != 0 || res == 0) {
+      throw std::runtime_error("unknown host: " + host);
+    }
+    addr.sin_addr = ((sockaddr_in*) res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+  }
+
+  return addr;
+}
+
+// sin retardo de Nagle y sin SIGPIPE (macOS)
+static void socket_options(socket_t s){
+  int one = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*) &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+  setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, (const char*) &one, sizeof(one));
+#endif
+}
+
+Socket::~Socket(){
+  close();
+}
+
+Socket& Socket::operator=(Socket &&other){
+  if (this != &other) {
+    close();
+    fd = other.fd;
+    other.fd = -1;
+  }
+  return *this;
+}
+
+void Socket::close(){
+  if (fd != -1) {
+    CLOSE_SOCKET( (socket_t) fd );
+    fd = -1;
+  }
+}
+
+Socket Socket::listen(const std::string &host, int port){
+  socket_init();
+
+  sockaddr_in addr = socket_address(host, port);
+  socket_t s = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (s == (socket_t) -1) {
+    throw std::runtime_error("cannot create a socket");
+  }
+  Socket out( (intptr_t) s );
+
+  int one = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*) &one, sizeof(one));
+
+  if (::bind(s, (sockaddr*) &addr, sizeof(addr)) != 0 || ::listen(s, 64) != 0) {
+    throw std::runtime_error("cannot listen on " + host + ":" + std::to_string(port));
+  }
+
+  return out;
+}
+
+Socket Socket::connect(const std::string &host, int port, double timeout){
+  socket_init();
+
+  sockaddr_in addr = socket_address(host, port);
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+  // el coordinador puede no estar escuchando todavía
+  for (;;) {
+    socket_t s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s == (socket_t) -1) {
+      throw std::runtime_error("cannot create a socket");
+    }
+    if (::connect(s, (sockaddr*) &addr, sizeof(addr)) == 0) {
+      socket_options(s);
+      return Socket( (intptr_t) s );
+    }
+    CLOSE_SOCKET(s);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (elapsed > timeout) {
+      throw std::runtime_error("cannot connect to " + host + ":" + std::to_string(port));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+Socket Socket::accept(double timeout){
+  std::vector<Socket*> self(1, this);
+  if (wait(self, timeout) < 0) {
+    return Socket();
+  }
+
+  socket_t s = ::accept( (socket_t) fd, 0, 0 );
+  if (s == (socket_t) -1) {
+    return Socket();
+  }
+  socket_options(s);
+
+  return Socket( (intptr_t) s );
+}
+
+int Socket::port() const {
+  sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (getsockname( (socket_t) fd, (sockaddr*) &addr, &len ) != 0) {
+    return -1;
+  }
+  return ntohs(addr.sin_port);
+}
+
+void Socket::send_all(const void *data, size_t size){
+  const char *p = (const char*) data;
+  while (size > 0) {
+    int chunk = (int) std::min(size, (size_t) 1 << 30);
+    int sent  = ::send( (socket_t) fd, p, chunk, MSG_NOSIGNAL );
+    if (sent <= 0) {
+      throw std::runtime_error("connection lost while sending");
+    }
+    p    += sent;
+    size -= sent;
+  }
+}
+
+bool Socket::recv_all(void *data, size_t size){
+  char *p = (char*) data;
+  size_t got = 0;
+  while (got < size) {
+    int chunk = (int) std::min(size - got, (size_t) 1 << 30);
+    int r     = ::recv( (socket_t) fd, p + got, chunk, 0 );
+    if (r <= 0) {
+      if (got == 0) return false;
+      throw std::runtime_error("connection lost while receiving");
+    }
+    got += r;
+  }
+  return true;
+}
+
+int Socket::wait(const std::vector<Socket*> &sockets, double timeout){
+#if defined(_WIN32)
+  // en Winsock fd_set es una lista de sockets (no un mapa de bits indexado
+  // por descriptor), así que select no tiene límite en el valor del socket
+  fd_set set;
+  FD_ZERO(&set);
+  for (size_t k = 0; k < sockets.size(); ++k) {
+    if (!sockets[k]->valid()) continue;
+    FD_SET( (socket_t) sockets[k]->fd, &set );
+  }
+
+  timeval tv;
+  tv.tv_sec  = (long) timeout;
+  tv.tv_usec = (long) ( (timeout - (long) timeout) * 1e6 );
+
+  if (::select( 0, &set, 0, 0, &tv ) <= 0) {
+    return -1;
+  }
+  for (size_t k = 0; k < sockets.size(); ++k) {
+    if (sockets[k]->valid() && FD_ISSET( (socket_t) sockets[k]->fd, &set )) {
+      return k;
+    }
+  }
+  return -1;
+#else
+  // poll no tiene el límite de FD_SETSIZE en el número de descriptor
+  std::vector<pollfd> set;
+  std::vector<int> index;
+  for (size_t k = 0; k < sockets.size(); ++k) {
+    if (!sockets[k]->valid()) continue;
+    pollfd p;
+    p.fd      = (socket_t) sockets[k]->fd;
+    p.events  = POLLIN;
+    p.revents = 0;
+    set.push_back(p);
+    index.push_back(k);
+  }
+
+  int ms = (int) std::min(timeout * 1000.0, 2147483647.0);
+  if (::poll( set.data(), set.size(), std::max(ms, 0) ) <= 0) {
+    return -1;
+  }
+  // también el cierre o un error del otro extremo: la lectura lo reporta
+  for (size_t k = 0; k < set.size(); ++k) {
+    if (set[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+      return index[k];
+    }
+  }
+  return -1;
+#endif
+}
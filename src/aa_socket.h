@@ -0,0 +1,53 @@
+#ifndef HBV_SOCKET_H
+#define HBV_SOCKET_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// **********************************************************
+//  Minimal blocking TCP sockets (POSIX and Winsock) for the
+//  coordinator and the workers of Cluster_HBV. Errors are
+//  thrown as std::runtime_error.
+// **********************************************************
+
+class Socket {
+public:
+  Socket() : fd(-1) {}
+  ~Socket();
+
+  Socket(Socket &&other) : fd(other.fd) { other.fd = -1; }
+  Socket& operator=(Socket &&other);
+
+  // listening socket on host:port (port 0: any free port)
+  static Socket listen(const std::string &host, int port);
+
+  // connection to host:port, retried until 'timeout' [s]
+  static Socket connect(const std::string &host, int port, double timeout);
+
+  // next pending connection; an invalid socket after 'timeout' [s]
+  Socket accept(double timeout);
+
+  bool valid() const { return fd != -1; }
+  int port() const;
+  void close();
+
+  // the whole buffer or an exception
+  void send_all(const void *data, size_t size);
+
+  // false when the peer closed the connection before the first byte
+  bool recv_all(void *data, size_t size);
+
+  // index of the first socket with data to read, -1 after 'timeout' [s]
+  static int wait(const std::vector<Socket*> &sockets, double timeout);
+
+private:
+  explicit Socket(intptr_t fd) : fd(fd) {}
+  Socket(const Socket&);
+  Socket& operator=(const Socket&);
+
+  intptr_t fd;
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include <Rcpp.h>
+#include "aa_stage.h"
+using namespace Rcpp;
+
+
+OutputSpec output_spec(Nullable<IntegerVector> aggregate,
+                       int stride,
+                       Nullable<CharacterVector> columns,
+                       int n,
+                       SEXP into){
+  OutputSpec spec;
+
+  if (into != R_NilValue) {
+    // se escribe directo en la memoria del objeto: no se admite una copia
+    // convertida (p.ej.: una matriz de enteros). No se verifica
+    // MAYBE_SHARED(): el argumento llega a .Call() desde la función de
+    // R, así que la variable del usuario y la promesa ya lo comparten y se
+    // rechazaría todo uso. El aliasing está documentado en cada etapa.
+    if ( (TYPEOF(into) != REALSXP) || !Rf_isMatrix(into) ) {
+      stop("into must be a numeric (double) matrix");
+    }
+    if (aggregate.isNotNull()) {
+      stop("into and aggregate options can not be combined");
+    }
+    spec.into = (void*) into;
+  }
+
+  if (stride < 1) {
+    stop("stride must be at least one time step");
+  }
+  spec.stride = stride;
+
+  if (columns.isNotNull()) {
+    CharacterVector cols(columns.get());
+    if (cols.size() == 0) {
+      stop("columns must name at least one output column");
+    }
+    for (int k = 0; k < cols.size(); ++k) {
+      spec.columns.push_back( std::string(cols[k]) );
+    }
+  }
+
+  if (aggregate.isNull()) return spec;
+
+  if (stride != 1) {
+    stop("aggregate and stride options can not be combined");
+  }
+
+  IntegerVector agg(aggregate.get());
+
+  int chk_1 = sum( is_na(agg) );
+  if(chk_1 != 0){
+
+    stop("aggregate argument should not contain NA values!");
+
+  }
+
+  if (agg.size() == 1) {
+    // largo del período
+    if (agg[0] < 1) {
+      stop("The aggregation period must be at least one time step");
+    }
+    spec.period  = agg[0];
+    spec.nperiod = (n + agg[0] - 1) / agg[0];
+
+  } else if (agg.size() == n) {
+    // número de período de cada paso de tiempo
+    spec.index.resize(n);
+    count_alloc( (size_t) n * sizeof(int) );
+    for (int i = 0; i < n; ++i) {
+      if (agg[i] < 1) {
+        stop("Period numbers in aggregate must be >= 1");
+      }
+      spec.index[i] = agg[i] - 1;
+      spec.nperiod  = std::max(spec.nperiod, agg[i]);
+    }
+
+  } else {
+    stop("aggregate must be a period length or a vector with one period number per time step");
+  }
+
+  return spec;
+}
+
+// columna de salida de cada columna del módulo (-1: no se guarda)
+static std::vector<int> keep_columns(const OutputSpec &spec,
+                                     std::initializer_list<const char*> names){
+  std::vector<int> keep;
+  if (spec.columns.empty()) return keep;
+
+  keep.assign(names.size(), -1);
+  for (size_t j = 0; j < spec.columns.size(); ++j) {
+    bool found = false;
+    int k = 0;
+    for (const char *name : names) {
+      if (spec.columns[j] == name) {
+        keep[k] = 0;
+        found   = true;
+      }
+      ++k;
+    }
+    if (!found) {
+      stop("Unknown output column: " + spec.columns[j]);
+    }
+  }
+
+  // las columnas conservan el orden del módulo
+  int c = 0;
+  for (size_t k = 0; k < keep.size(); ++k) {
+    if (keep[k] == 0) keep[k] = c++;
+  }
+  return keep;
+}
+
+StageOutput::StageOutput(int n, int m, const OutputSpec &spec,
+                         std::initializer_list<const char*> names)
+  : OutputSink(n, m, spec, keep_columns(spec, names)), m(m),
+    into( (SEXP) spec.into ) {
+  if (m > STAGE_MAXCOL) {
+    stop("Too many output columns");
+  }
+  int k = 0;
+  for (const char *name : names) this->names[k++] = name;
+
+  if (into != R_NilValue) {
+    // matriz del usuario: se reutiliza entre llamadas
+    if ( (Rf_nrows(into) != rows()) || (Rf_ncols(into) != cols()) ) {
+      stop("into must be a " + std::to_string(rows()) + " x " +
+           std::to_string(cols()) + " matrix");
+    }
+    attach( REAL(into) );
+
+  } else if (!spec.aggregate()) {
+    NumericMatrix mat(rows(), cols());
+    attach( mat.begin() );
+    full = mat;
+    count_alloc( (size_t) rows() * cols() * sizeof(double) );
+
+  } else {
+    // acumuladores de OutputSink (suma, mínimo, máximo y pasos por período)
+    count_alloc( (size_t) nperiod() * (3 * cols() * sizeof(double) + sizeof(int)), 4 );
+  }
+}
+
+CharacterVector StageOutput::labels() const {
+  const std::vector<int> &keep = this->keep();
+  CharacterVector out(cols());
+  for (int k = 0; k < m; ++k) {
+    if (keep.empty()) {
+      out[k] = names[k];
+    } else if (keep[k] >= 0) {
+      out[ keep[k] ] = names[k];
+    }
+  }
+  return out;
+}
+
+SEXP StageOutput::result(){
+  if (into != R_NilValue) {
+    // matriz del usuario: sólo se escriben los valores, nunca sus atributos
+    // (otras variables pueden compartirla)
+    return into;
+  }
+
+  if (nperiod() == 0) {
+    NumericMatrix mat(full);
+    colnames(mat) = labels();
+    return mat;
+  }
+
+  int np = nperiod(), m = cols();
+  NumericMatrix s(np, m), mean(np, m), lo(np, m), hi(np, m);
+  IntegerVector count(np);
+  count_alloc( (size_t) np * (4 * m * sizeof(double) + sizeof(int)), 5 );
+
+  for (int p = 0; p < np; ++p) {
+    count[p] = counts()[p];
+  }
+
+  for (int k = 0; k < m; ++k) {
+    for (int p = 0; p < np; ++p) {
+      size_t j = p + (size_t) k * np;
+
+      if (count[p] == 0) {
+        // período sin pasos de tiempo
+        s(p, k)    = NA_REAL;
+        mean(p, k) = NA_REAL;
+        lo(p, k)   = NA_REAL;
+        hi(p, k)   = NA_REAL;
+      } else {
+        s(p, k)    = sums()[j];
+        mean(p, k) = sums()[j] / count[p];
+        lo(p, k)   = mins()[j];
+        hi(p, k)   = maxs()[j];
+      }
+    }
+  }
+
+  CharacterVector labels = this->labels();
+  colnames(s)    = labels;
+  colnames(mean) = labels;
+  colnames(lo)   = labels;
+  colnames(hi)   = labels;
+
+  return List::create(Named("sum")  = s,
+                      Named("mean") = mean,
+                      Named("min")  = lo,
+                      Named("max")  = hi,
+                      Named("n")    = count);
+}
+
+DataFrame profile_frame(const std::vector<StageProfile> &prof,
+                        const char *key){
+  int m = prof.size();
+  CharacterVector name(m);
+  NumericVector seconds(m), steps(m), melt(m), nomelt(m), overflow(m), uzl(m), perc(m);
+
+  // los contadores pueden superar un entero de R
+  for (int k = 0; k < m; ++k) {
+    name[k]     = prof[k].name;
+    seconds[k]  = prof[k].seconds;
+    steps[k]    = prof[k].steps;
+    melt[k]     = prof[k].melt;
+    nomelt[k]   = prof[k].nomelt;
+    overflow[k] = prof[k].overflow;
+    uzl[k]      = prof[k].uzl;
+    perc[k]     = prof[k].perc;
+  }
+
+  DataFrame out = DataFrame::create(Named(key)        = name,
+                                    Named("seconds")  = seconds,
+                                    Named("steps")    = steps,
+                                    Named("melt")     = melt,
+                                    Named("nomelt")   = nomelt,
+                                    Named("overflow") = overflow,
+                                    Named("uzl")      = uzl,
+                                    Named("perc")     = perc,
+                                    Named("stringsAsFactors") = false);
+  return out;
+}
+
+DataFrame balance_frame(const std::vector<StoreBalance> &bal){
+  int m = bal.size();
+  CharacterVector store(m);
+  NumericVector input(m), output(m), initial(m), final(m), error(m);
+
+  for (int k = 0; k < m; ++k) {
+    store[k]   = bal[k].name;
+    input[k]   = bal[k].input;
+    output[k]  = bal[k].output;
+    initial[k] = bal[k].initial;
+    final[k]   = bal[k].final;
+    error[k]   = bal[k].error();
+  }
+
+  DataFrame out = DataFrame::create(Named("store")   = store,
+                                    Named("input")   = input,
+                                    Named("output")  = output,
+                                    Named("initial") = initial,
+                                    Named("final")   = final,
+                                    Named("error")   = error,
+                                    Named("stringsAsFactors") = false);
+  return out;
+}
@@ -0,0 +1,64 @@
+#include <Rcpp.h>
+#ifndef HBV_STAGE_H
+#define HBV_STAGE_H
+
+#include <vector>
+#include <initializer_list>
+#include "aa_output.h"
+#include "aa_probe.h"
+#include "aa_balance.h"
+
+// **********************************************************
+//  R side of the output sink: the 'aggregate', 'stride',
+//  'columns' and 'into' arguments of the stage functions and
+//  the object they return.
+// **********************************************************
+
+// aggregate: NULL (whole series), the period length [time steps] or the
+// period number (1, 2, ...) of every one of the 'n' time steps.
+// stride   : record every stride-th time step (not with aggregate).
+// columns  : names of the recorded columns (NULL: all).
+// into     : NULL or a double matrix that receives the output in place
+//            (not with aggregate).
+OutputSpec output_spec(Rcpp::Nullable<Rcpp::IntegerVector> aggregate,
+                       int stride,
+                       Rcpp::Nullable<Rcpp::CharacterVector> columns,
+                       int n,
+                       SEXP into = R_NilValue);
+
+// columns of the widest kernel (icemelt_*)
+#define STAGE_MAXCOL 9
+
+class StageOutput : public OutputSink {
+public:
+  // names: the m column names of the kernel (string literals). With
+  // spec.into the rows() x cols() matrix of the caller is filled and no R
+  // object is allocated.
+  StageOutput(int n, int m, const OutputSpec &spec,
+              std::initializer_list<const char*> names);
+
+  // output matrix (every stride-th time step of the recorded columns; the
+  // caller's one with 'into', attributes untouched) or, when aggregating, a
+  // list with the 'sum', 'mean', 'min' and 'max' matrices (one row per
+  // period) and the number of time steps 'n' of every period
+  SEXP result();
+
+private:
+  Rcpp::CharacterVector labels() const;
+
+  int m;
+  const char *names[STAGE_MAXCOL];
+  Rcpp::RObject full;
+  SEXP into;
+};
+
+// data.frame with one row per stage (or band): 'key' (the name of the
+// first column), seconds, steps, melt, nomelt, overflow, uzl and perc
+Rcpp::DataFrame profile_frame(const std::vector<StageProfile> &prof,
+                              const char *key);
+
+// data.frame with one row per storage: store, input, output, initial,
+// final and error (the closure error)
+Rcpp::DataFrame balance_frame(const std::vector<StoreBalance> &bal);
+
+#endif
@@ -0,0 +1,131 @@
+#include <memory>
+#include <algorithm>
+#include "aa_stream.h"
+#include "aa_chain.h"
+#include "aa_output.h"
+#include "aa_probe.h"
+#include "aa_threadpool.h"
+
+// chunks en circulación entre las etapas
+#define STREAM_BUFFERS 8
+
+struct StreamChunk {
+  int i0, len;
+  std::vector<double> SWE, SM, total, rech, Qg;
+
+  explicit StreamChunk(int chunk) :
+    i0(0), len(0), SWE(chunk), SM(chunk), total(chunk), rech(chunk), Qg(chunk) {}
+};
+
+typedef SpscRing<StreamChunk*> ChunkRing;
+
+// hilos de las etapas nieve, suelo y reservorios. Se crean una vez y no se
+// destruyen (como el pool compartido); las tres etapas se esperan entre sí,
+// así que una corrida encadenada a la vez los usa (stage_mtx).
+static std::mutex stage_mtx;
+
+static ThreadPool& stage_pool(){
+  static ThreadPool *pool = new ThreadPool(3);
+  return *pool;
+}
+
+void pipeline_stream(int routing,
+                     const Forcing &f,
+                     const double *initCond,
+                     const double *param,
+                     OutputSink &out,
+                     int chunk){
+  if (chunk <= 0) {
+    chunk = STREAM_CHUNK;
+  }
+  int n      = f.n;
+  int nchunk = (n + chunk - 1) / chunk;
+
+  // con pocos chunks no hay solapamiento entre las etapas
+  if (nchunk < 8) {
+    pipeline_run(routing, f, initCond, param, out);
+    return;
+  }
+
+  std::vector< std::unique_ptr<StreamChunk> > buffers;
+  ChunkRing free_ring(STREAM_BUFFERS), to_soil(STREAM_BUFFERS),
+            to_route(STREAM_BUFFERS), to_uh(STREAM_BUFFERS);
+  for (int k = 0; k < STREAM_BUFFERS; ++k) {
+    buffers.push_back( std::unique_ptr<StreamChunk>(new StreamChunk(chunk)) );
+    free_ring.push(buffers.back().get());
+  }
+  count_alloc( (size_t) STREAM_BUFFERS * 5 * chunk * sizeof(double),
+               STREAM_BUFFERS * 5 );
+  std::atomic<bool> stop(false);
+
+  // cada hilo lleva su propia copia de la cadena (aa_chain.h) y avanza
+  // sólo su etapa, así los estados no comparten líneas de caché
+
+  // etapa nieve: toma chunks libres y arranca cada tramo de la serie
+  auto snow = [&](){
+    PipelineChain<> chain(routing, initCond, param);
+    for (int c = 0; c < nchunk; ++c) {
+      StreamChunk *k;
+      if (!free_ring.pop_wait(k, stop)) return;
+
+      k->i0  = c * chunk;
+      k->len = std::min(chunk, n - k->i0);
+      chain.snow_chunk(f, k->i0, k->len, k->total.data(), k->SWE.data());
+      to_soil.push(k);
+    }
+  };
+
+  // etapa suelo
+  auto soil = [&](){
+    PipelineChain<> chain(routing, initCond, param);
+    for (int c = 0; c < nchunk; ++c) {
+      StreamChunk *k;
+      if (!to_soil.pop_wait(k, stop)) return;
+
+      chain.soil_chunk(f, k->i0, k->len, k->total.data(), k->rech.data(), k->SM.data());
+      to_route.push(k);
+    }
+  };
+
+  // etapa reservorios
+  auto route = [&](){
+    PipelineChain<> chain(routing, initCond, param);
+    for (int c = 0; c < nchunk; ++c) {
+      StreamChunk *k;
+      if (!to_route.pop_wait(k, stop)) return;
+
+      chain.route_chunk(k->len, k->rech.data(), k->Qg.data());
+      to_uh.push(k);
+    }
+  };
+
+  std::lock_guard<std::mutex> lock(stage_mtx);
+  ThreadPool &pool = stage_pool();
+  TaskGroup group;
+  pool.submit(snow, group);
+  pool.submit(soil, group);
+  pool.submit(route, group);
+
+  // etapa HU en este hilo: es la única que escribe en 'out'
+  PipelineChain<> chain(routing, initCond, param);
+  for (int c = 0; c < nchunk; ++c) {
+    // Ctrl-C: detengo las etapas y espero que salgan antes de terminar
+    if ( (c % 16 == 15) && interrupt_pending() ) {
+      stop = true;
+      free_ring.wake();
+      to_soil.wake();
+      to_route.wake();
+      group.wait();
+      throw Interrupted();
+    }
+
+    StreamChunk *k;
+    if (!to_uh.pop_wait(k, stop)) break;
+
+    chain.transfer_chunk(k->i0, k->len, k->SWE.data(), k->SM.data(),
+                         k->rech.data(), k->Qg.data(), out);
+    free_ring.push(k);
+  }
+
+  group.wait();
+}
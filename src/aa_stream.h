@@ -0,0 +1,115 @@
+#ifndef HBV_STREAM_H
+#define HBV_STREAM_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <cstddef>
+#include "aa_pipeline.h"
+
+// **********************************************************
+//  Stage-pipelined run of the lumped chain (pipeline_run()).
+//  The snow, soil and routing stages run on a persistent pool
+//  of three threads (created on the first pipelined run) and
+//  the UH stage (which also fills the output) on the caller. Consecutive chunks of the series travel from one
+//  stage to the next through lock-free single-producer /
+//  single-consumer rings, so the four stages work on
+//  different chunks at the same time. Every stage carries its
+//  own state and runs its time steps in order, therefore the
+//  output equals the one of pipeline_run().
+// **********************************************************
+
+// bounded lock-free queue for exactly one producer thread and one
+// consumer thread. A consumer that finds it empty spins briefly and then
+// sleeps until the producer pushes (or wake() is called).
+template<class T>
+class SpscRing {
+public:
+  explicit SpscRing(int capacity) : buf(capacity + 1), head(0), tail(0), sleeping(false) {}
+
+  // false when the ring is full
+  bool push(const T &x){
+    size_t t  = tail.load(std::memory_order_relaxed);
+    size_t nx = next(t);
+    if (nx == head.load(std::memory_order_acquire)) return false;
+    buf[t] = x;
+    tail.store(nx, std::memory_order_release);
+
+    // pairs with the fence of pop_wait(): either the consumer sees the new
+    // tail or this thread sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) wake();
+    return true;
+  }
+
+  // false when the ring is empty
+  bool pop(T &x){
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    x = buf[h];
+    head.store(next(h), std::memory_order_release);
+    return true;
+  }
+
+  // waits (a short spin, then asleep) until an element arrives; false
+  // when 'stop' was raised first (call wake() after raising it)
+  bool pop_wait(T &x, const std::atomic<bool> &stop){
+    for (int k = 0; k < 64; ++k) {
+      if (pop(x)) return true;
+      if (stop.load(std::memory_order_relaxed)) return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+      sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (pop(x)) break;
+      if (stop.load(std::memory_order_relaxed)) {
+        sleeping.store(false, std::memory_order_relaxed);
+        return false;
+      }
+      cv.wait(lock);
+    }
+    sleeping.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+  // wakes a sleeping consumer
+  void wake(){
+    std::lock_guard<std::mutex> lock(mtx);
+    cv.notify_all();
+  }
+
+private:
+  size_t next(size_t i) const { return (i + 1 == buf.size()) ? 0 : i + 1; }
+
+  std::vector<T> buf;
+  // head and tail are written by different threads: keep them on
+  // different cache lines
+  char pad0[64];
+  std::atomic<size_t> head;   // next element to pop (consumer)
+  char pad1[64];
+  std::atomic<size_t> tail;   // next free slot (producer)
+  char pad2[64];
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::atomic<bool> sleeping;  // the consumer waits on 'cv'
+};
+
+// time steps per chunk
+#define STREAM_CHUNK 2048
+
+// same arguments and output as pipeline_run(). Short series (less than
+// two chunks per stage) run in the caller with pipeline_run(). Throws
+// Interrupted when the user interrupts the R session.
+void pipeline_stream(int routing,
+                     const Forcing &f,
+                     const double *initCond,
+                     const double *param,
+                     OutputSink &out,
+                     int chunk = STREAM_CHUNK);
+
+#endif
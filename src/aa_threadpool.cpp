@@ -0,0 +1,387 @@
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <algorithm>
+#include "aa_threadpool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+int hardware_threads(){
+  int n = std::thread::hardware_concurrency();
+  return (n > 0) ? n : 1;
+}
+
+void TaskGroup::add(){
+  std::lock_guard<std::mutex> lock(mtx);
+  ++pending;
+}
+
+void TaskGroup::done(){
+  std::lock_guard<std::mutex> lock(mtx);
+  if (--pending == 0) {
+    last = std::chrono::steady_clock::now();
+    cv.notify_all();
+  }
+}
+
+void TaskGroup::drain(){
+  std::unique_lock<std::mutex> lock(mtx);
+  cv.wait(lock, [this]{ return pending == 0; });
+}
+
+void TaskGroup::wait(){
+  if ( !interrupt_here() ) {
+    drain();
+    return;
+  }
+
+  // en el hilo de R espero en intervalos cortos para atender Ctrl-C; las
+  // tareas en curso pueden usar la pila de quien espera, así que termino
+  // de esperarlas antes de salir
+  while ( !wait_for(0.1) ) {
+    if ( interrupt_pending() ) {
+      cancel();
+      drain();
+      throw Interrupted();
+    }
+  }
+}
+
+bool TaskGroup::wait_for(double seconds){
+  std::unique_lock<std::mutex> lock(mtx);
+  return cv.wait_for(lock, std::chrono::duration<double>(seconds),
+                     [this]{ return pending == 0; });
+}
+
+bool TaskGroup::finished(){
+  std::lock_guard<std::mutex> lock(mtx);
+  return pending == 0;
+}
+
+bool TaskGroup::finished(std::chrono::steady_clock::time_point &at){
+  std::lock_guard<std::mutex> lock(mtx);
+  at = last;
+  return pending == 0;
+}
+
+// revisión de interrupciones del lado de R (ver set_interrupt_check)
+static bool (*interrupt_fn)() = 0;
+static std::thread::id interrupt_thread;
+
+void set_interrupt_check(bool (*check)()){
+  interrupt_fn     = check;
+  interrupt_thread = std::this_thread::get_id();
+}
+
+bool interrupt_here(){
+  return interrupt_fn != 0 && std::this_thread::get_id() == interrupt_thread;
+}
+
+bool interrupt_pending(){
+  return interrupt_here() && interrupt_fn();
+}
+
+// fijo el hilo a un núcleo
+static void pin_thread(std::thread &t, int core){
+#if defined(_WIN32)
+  SetThreadAffinityMask(t.native_handle(), (DWORD_PTR) 1 << (core % 64));
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % CPU_SETSIZE, &set);
+  pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &set);
+#else
+  (void) t;
+  (void) core;
+#endif
+}
+
+ThreadPool::ThreadPool(int nthreads, bool pin) : queued(0), pending(0), next(0), done(false), pin(false) {
+  start(nthreads, pin);
+}
+
+ThreadPool::~ThreadPool(){
+  stop();
+}
+
+void ThreadPool::start(int nthreads, bool pin_threads){
+  if (nthreads <= 0) {
+    nthreads = hardware_threads();
+  }
+
+  done = false;
+  pin  = pin_threads;
+  for (int i = 0; i < nthreads; ++i) {
+    queues.push_back( std::unique_ptr<Queue>(new Queue) );
+  }
+  for (int i = 0; i < nthreads; ++i) {
+    threads.push_back( std::thread(&ThreadPool::worker, this, i) );
+    if (pin) {
+      pin_thread(threads.back(), i % hardware_threads());
+    }
+  }
+}
+
+void ThreadPool::stop(){
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    done = true;
+  }
+  cv_task.notify_all();
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+  threads.clear();
+  queues.clear();
+}
+
+void ThreadPool::resize(int nthreads, bool pin_threads){
+  wait();
+  stop();
+  start(nthreads, pin_threads);
+}
+
+int ThreadPool::size() const {
+  return threads.size();
+}
+
+bool ThreadPool::pinned() const {
+  return pin;
+}
+
+void ThreadPool::submit(const std::function<void()> &task){
+  Queue &q = *queues[next++ % queues.size()];
+  // los contadores suben antes de publicar la tarea: un worker que la tome
+  // enseguida no puede bajar 'pending' antes de tiempo
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    ++pending;
+    ++queued;
+  }
+  {
+    std::lock_guard<std::mutex> lock(q.mtx);
+    q.tasks.push_back(task);
+  }
+  cv_task.notify_one();
+}
+
+void ThreadPool::submit(const std::function<void()> &task,
+                        TaskGroup &group){
+  group.add();
+  TaskGroup *g = &group;
+  submit([task, g](){
+    try {
+      if ( !g->cancelled() ) task();
+    } catch (...) {
+      // las tareas reportan sus propios errores
+    }
+    g->done();
+  });
+}
+
+void ThreadPool::submit_batch(const std::vector< std::function<void()> > &tasks,
+                              const std::vector<double> &cost,
+                              TaskGroup &group){
+  int nt = tasks.size();
+  int nq = queues.size();
+
+  // de mayor a menor costo
+  std::vector<int> order(nt);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&cost](int a, int b){
+    return cost[a] > cost[b];
+  });
+
+  // cada tarea va a la cola con menos carga
+  std::vector<double> load(nq, 0.0);
+  std::vector< std::vector<int> > plan(nq);
+  for (int k = 0; k < nt; ++k) {
+    int q = std::min_element(load.begin(), load.end()) - load.begin();
+    plan[q].push_back(order[k]);
+    load[q] += cost[order[k]];
+  }
+
+  TaskGroup *g = &group;
+  for (int q = 0; q < nq; ++q) {
+    if (plan[q].empty()) continue;
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      pending += plan[q].size();
+      queued  += plan[q].size();
+    }
+
+    // la tarea más costosa queda al final (la toma primero el dueño)
+    {
+      std::lock_guard<std::mutex> lock(queues[q]->mtx);
+      for (int k = plan[q].size() - 1; k >= 0; --k) {
+        const std::function<void()> &task = tasks[ plan[q][k] ];
+        g->add();
+        queues[q]->tasks.push_back([task, g](){
+          try {
+            if ( !g->cancelled() ) task();
+          } catch (...) {
+            // las tareas reportan sus propios errores
+          }
+          g->done();
+        });
+      }
+    }
+  }
+  cv_task.notify_all();
+}
+
+void ThreadPool::wait(){
+  std::unique_lock<std::mutex> lock(mtx);
+  cv_done.wait(lock, [this]{ return pending == 0; });
+}
+
+bool ThreadPool::idle(){
+  std::lock_guard<std::mutex> lock(mtx);
+  return pending == 0;
+}
+
+bool ThreadPool::pop(int id, std::function<void()> &task){
+  int n = queues.size();
+
+  // cola propia (LIFO)
+  {
+    Queue &q = *queues[id];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (!q.tasks.empty()) {
+      task = q.tasks.back();
+      q.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+
+  // robo desde el frente de las otras colas
+  for (int k = 1; k < n; ++k) {
+    Queue &q = *queues[(id + k) % n];
+    std::lock_guard<std::mutex> lock(q.mtx);
+    if (!q.tasks.empty()) {
+      task = q.tasks.front();
+      q.tasks.pop_front();
+      --queued;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::worker(int id){
+  for (;;) {
+    std::function<void()> task;
+
+    if (pop(id, task)) {
+      try {
+        task();
+      } catch (...) {
+        // las tareas reportan sus propios errores
+      }
+
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--pending == 0) {
+        cv_done.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_task.wait(lock, [this]{ return done || queued > 0; });
+    if (done && queued == 0) {
+      return;
+    }
+  }
+}
+
+// pools del proceso: uno para las funciones que esperan su resultado y otro
+// para los trabajos en segundo plano, con el mismo tamaño. No se destruyen
+// nunca: unir hilos mientras se descarga la librería puede colgar la sesión.
+struct LazyPool {
+  LazyPool() : pool(0), resize(false) {}
+  ThreadPool *pool;
+  bool resize;          // tamaño nuevo pendiente
+};
+
+static std::mutex shared_mtx;
+static LazyPool shared, jobs;
+static int shared_n       = 0;
+static bool shared_pin    = false;
+
+static int default_threads(){
+  const char *env = std::getenv("HBV_THREADS");
+  if (env != 0) {
+    int n = std::atoi(env);
+    if (n > 0) return n;
+  }
+  return hardware_threads();
+}
+
+// aplica el tamaño pendiente si el pool está libre (con shared_mtx tomado).
+// Las tareas se envían sólo desde el hilo de R, el mismo que llama aquí, así
+// que nada entra al pool entre la consulta y el reinicio.
+static void lazy_apply(LazyPool &p){
+  if (p.resize && p.pool != 0 && p.pool->idle()) {
+    p.pool->resize( (shared_n > 0) ? shared_n : default_threads(), shared_pin );
+    p.resize = false;
+  }
+}
+
+static ThreadPool& lazy_get(LazyPool &p){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  if (p.pool == 0) {
+    p.pool   = new ThreadPool( (shared_n > 0) ? shared_n : default_threads(), shared_pin );
+    p.resize = false;
+  }
+  lazy_apply(p);
+  return *p.pool;
+}
+
+ThreadPool& shared_pool(){
+  return lazy_get(shared);
+}
+
+ThreadPool& job_pool(){
+  return lazy_get(jobs);
+}
+
+void shared_pool_configure(int nthreads, bool pin){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  if (nthreads >= 0) shared_n = nthreads;
+  shared_pin    = pin;
+  shared.resize = true;
+  jobs.resize   = true;
+  lazy_apply(shared);
+  lazy_apply(jobs);
+}
+
+int shared_pool_size(){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  if (shared.pool != 0) return shared.pool->size();
+  return (shared_n > 0) ? shared_n : default_threads();
+}
+
+bool shared_pool_pinned(){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  return (shared.pool != 0) ? shared.pool->pinned() : shared_pin;
+}
+
+bool shared_pool_started(){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  return shared.pool != 0;
+}
+
+bool shared_pool_resize_pending(){
+  std::lock_guard<std::mutex> lock(shared_mtx);
+  return (shared.resize && shared.pool != 0) || (jobs.resize && jobs.pool != 0);
+}
@@ -0,0 +1,163 @@
+#ifndef HBV_THREADPOOL_H
+#define HBV_THREADPOOL_H
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <stdexcept>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// **********************************************************
+//  Work-stealing thread pool. Every worker owns a queue: it
+//  takes tasks from the back of its own queue and, when it is
+//  empty, steals from the front of the others. Tasks must not
+//  touch R objects.
+//
+//  The package keeps one pool for the whole process (see
+//  shared_pool()), so repeated calls from R do not pay for
+//  thread creation, and a second one of the same size for the
+//  background jobs (see job_pool()).
+// **********************************************************
+
+// thrown by TaskGroup::wait() when the user interrupts the R session
+struct Interrupted : public std::runtime_error {
+  Interrupted() : std::runtime_error("interrupted by the user") {}
+};
+
+// installs the interrupt check of the calling thread (the R thread).
+// 'check' returns true when the user asked for an interruption.
+void set_interrupt_check(bool (*check)());
+
+// true on the thread that installed the check
+bool interrupt_here();
+
+// runs the check (false on any other thread)
+bool interrupt_pending();
+
+// tasks submitted together; wait() only waits for them, so callers
+// sharing one pool do not wait for each other. Do not wait on a group
+// from inside a pool task.
+class TaskGroup {
+public:
+  TaskGroup() : pending(0), stop(false), last(std::chrono::steady_clock::now()) {}
+
+  // blocks until every task of the group has finished. On the R thread it
+  // polls the interrupt check: after an interruption the tasks that did
+  // not start are skipped, the running ones are waited for and
+  // Interrupted is thrown.
+  void wait();
+
+  // waits at most 'seconds'; true when every task has finished
+  bool wait_for(double seconds);
+
+  // true when every task of the group has finished (does not block)
+  bool finished();
+
+  // as finished(); 'at' gets the time the last task finished
+  bool finished(std::chrono::steady_clock::time_point &at);
+
+  // the tasks that did not start yet are skipped
+  void cancel() { stop.store(true, std::memory_order_relaxed); }
+  bool cancelled() const { return stop.load(std::memory_order_relaxed); }
+
+private:
+  friend class ThreadPool;
+  void add();
+  void done();
+  void drain();
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  int pending;
+  std::atomic<bool> stop;
+  std::chrono::steady_clock::time_point last;   // the group became idle
+};
+
+class ThreadPool {
+public:
+  // nthreads <= 0 uses all the available cores. With 'pin' every worker
+  // is bound to one core (Linux and Windows).
+  explicit ThreadPool(int nthreads, bool pin = false);
+  ~ThreadPool();
+
+  void submit(const std::function<void()> &task);
+  void submit(const std::function<void()> &task,
+              TaskGroup &group);
+
+  // tasks with a relative cost hint. They are dealt (most expensive
+  // first) to the least loaded queue; each worker runs its own queue from
+  // the most expensive task down and idle workers steal the cheapest
+  // ones, which evens out the tail of the batch.
+  void submit_batch(const std::vector< std::function<void()> > &tasks,
+                    const std::vector<double> &cost,
+                    TaskGroup &group);
+
+  // blocks until every submitted task has finished
+  void wait();
+
+  // true when no task is queued or running
+  bool idle();
+
+  // waits for the running tasks and restarts with 'nthreads' workers (call
+  // it when idle(), it blocks otherwise)
+  void resize(int nthreads, bool pin);
+
+  int size() const;
+  bool pinned() const;
+
+private:
+  struct Queue {
+    std::mutex mtx;
+    std::deque< std::function<void()> > tasks;
+  };
+
+  void start(int nthreads, bool pin);
+  void stop();
+  void worker(int id);
+  bool pop(int id, std::function<void()> &task);
+
+  std::vector< std::unique_ptr<Queue> > queues;
+  std::vector<std::thread> threads;
+
+  std::mutex mtx;
+  std::condition_variable cv_task, cv_done;
+  std::atomic<int> queued;
+  int pending;
+  unsigned next;
+  bool done;
+  bool pin;
+};
+
+int hardware_threads();
+
+// process-wide pool shared by every parallel function of the package. It
+// is created on first use with the configured size or, when none was set,
+// the HBV_THREADS environment variable or all the available cores.
+ThreadPool& shared_pool();
+
+// pool of the background jobs (async = TRUE), with the size and pinning of
+// the shared pool. A running job never holds the workers of the functions
+// that wait for their result.
+ThreadPool& job_pool();
+
+// sets the size of both pools (0: default size, < 0: keep the
+// configured size, e.g.: to change 'pin' only). It never blocks:
+// an idle pool is resized at once, a busy one (e.g.: running a background
+// job) by the first shared_pool() or job_pool() call that finds it idle.
+void shared_pool_configure(int nthreads, bool pin);
+
+// number of workers of the shared pool (configured size when it has not
+// been started yet) and whether they are pinned
+int shared_pool_size();
+bool shared_pool_pinned();
+bool shared_pool_started();
+
+// true while a new size waits for a pool to be idle
+bool shared_pool_resize_pending();
+
+#endif